@@ -0,0 +1,218 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+//The renderer sets the workgroup size through the specialization constant
+layout (local_size_x = 64) in;
+layout (local_size_x_id = 0) in;
+
+struct MeshDrawData
+{
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint instanceCount;
+
+    vec4 boundingSphere;
+};
+
+struct DrawRecord
+{
+    uint meshIndex;
+    uint transformIndex;
+    uint materialIndex;
+    uint padding;
+};
+
+struct IndirectDrawCommand
+{
+    uint drawRecordIndex;
+
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout (buffer_reference, std430) readonly buffer MeshDrawDataBuffer
+{
+    MeshDrawData meshes[];
+};
+
+layout (buffer_reference, std430) readonly buffer DrawRecordBuffer
+{
+    DrawRecord records[];
+};
+
+layout (buffer_reference, std430) readonly buffer TransformBuffer
+{
+    mat4 transforms[];
+};
+
+layout (buffer_reference, std430) readonly buffer CameraBuffer
+{
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+};
+
+layout (buffer_reference, std430) writeonly buffer IndirectDrawBuffer
+{
+    IndirectDrawCommand commands[];
+};
+
+//One count for each slice of the draw records
+layout (buffer_reference, std430) buffer DrawCountBuffer
+{
+    uint drawCounts[];
+};
+
+layout (buffer_reference, std430) buffer VisibilityBuffer
+{
+    uint visibility[];
+};
+
+//Sampled with a max reduction sampler, so one sample is the farthest depth of a 2x2 footprint
+layout (set = 0, binding = 0) uniform sampler2D depthPyramid;
+
+//Needs to match VulkanCullingPhase
+#define CULLING_PHASE_EARLY 0
+#define CULLING_PHASE_LATE 1
+
+layout (push_constant) uniform constants
+{
+    MeshDrawDataBuffer meshDrawDataBuffer;
+    DrawRecordBuffer drawRecordBuffer;
+    TransformBuffer transformBuffer;
+    CameraBuffer cameraBuffer;
+    IndirectDrawBuffer indirectDrawBuffer;
+    DrawCountBuffer drawCountBuffer;
+    VisibilityBuffer visibilityBuffer;
+    uint drawRecordCount;
+    uint cullingPhase;
+    vec2 depthPyramidExtent;
+    uint drawSliceSize;
+}PushConstants;
+
+//True if any part of the sphere is on the inner side of every frustum plane
+bool IsSphereInFrustum(vec3 center, float radius)
+{
+    for(int i = 0; i < 6; ++i)
+    {
+        if(dot(PushConstants.cameraBuffer.frustumPlanes[i].xyz, center) + 
+            PushConstants.cameraBuffer.frustumPlanes[i].w < -radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+True if the sphere is behind the depth that the early phase drew. The box around the sphere
+is projected to the screen, and the pyramid level where the box covers at most one texel is
+sampled, which gives the farthest depth of everything drawn in the box
+*/
+bool IsSphereOccluded(vec3 center, float radius)
+{
+    mat4 viewProjection = PushConstants.cameraBuffer.viewProjection;
+
+    vec2 minUV = vec2(1.0f);
+    vec2 maxUV = vec2(0.0f);
+    float nearestDepth = 1.0f;
+    for(int i = 0; i < 8; ++i)
+    {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0f : -1.0f, 
+            (i & 2) != 0 ? 1.0f : -1.0f, (i & 4) != 0 ? 1.0f : -1.0f);
+        vec4 clip = viewProjection * vec4(corner, 1.0f);
+
+        //Boxes that reach behind the camera can not be projected, so they are never occluded
+        if(clip.w <= 0.0f)
+        {
+            return false;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = clamp(ndc.xy * 0.5f + 0.5f, vec2(0.0f), vec2(1.0f));
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        nearestDepth = min(nearestDepth, ndc.z);
+    }
+
+    vec2 boxExtent = (maxUV - minUV) * PushConstants.depthPyramidExtent;
+    float level = ceil(log2(max(max(boxExtent.x, boxExtent.y), 1.0f)));
+
+    float occluderDepth = textureLod(depthPyramid, (minUV + maxUV) * 0.5f, level).x;
+
+    return nearestDepth > occluderDepth;
+}
+
+void main()
+{
+    //Dispatches that are too big for one dimension continue on the second
+    uint recordIndex = (gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x) * 
+        gl_WorkGroupSize.x + gl_LocalInvocationID.x;
+    if(recordIndex >= PushConstants.drawRecordCount)
+    {
+        return;
+    }
+
+    //The early phase only looks at what was visible last frame
+    uint wasVisible = PushConstants.visibilityBuffer.visibility[recordIndex];
+    if(PushConstants.cullingPhase == CULLING_PHASE_EARLY && wasVisible == 0)
+    {
+        return;
+    }
+
+    DrawRecord record = PushConstants.drawRecordBuffer.records[recordIndex];
+    MeshDrawData mesh = PushConstants.meshDrawDataBuffer.meshes[record.meshIndex];
+
+    //Meshes that did not fit in the geometry arena have nothing to draw
+    if(mesh.indexCount == 0)
+    {
+        return;
+    }
+
+    //The sphere is moved to world space, its radius grows with the largest scale of the transform
+    mat4 model = PushConstants.transformBuffer.transforms[record.transformIndex];
+    vec3 center = (model * vec4(mesh.boundingSphere.xyz, 1.0f)).xyz;
+    float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+    float radius = mesh.boundingSphere.w * scale;
+    bool bVisible = IsSphereInFrustum(center, radius);
+
+    /*
+    The late phase tests against the pyramid of what the early phase drew and saves the result 
+    for the next frame. Objects that the early phase already drew are not drawn again
+    */
+    if(PushConstants.cullingPhase == CULLING_PHASE_LATE)
+    {
+        bVisible = bVisible && !IsSphereOccluded(center, radius);
+        PushConstants.visibilityBuffer.visibility[recordIndex] = bVisible ? 1 : 0;
+        if(wasVisible != 0)
+        {
+            return;
+        }
+    }
+
+    if(!bVisible)
+    {
+        return;
+    }
+
+    /*
+    Visible commands are packed at the start of their slice's part of the buffer, 
+    and each slice's count is what the draw call of that slice reads
+    */
+    uint sliceIndex = recordIndex / PushConstants.drawSliceSize;
+    uint commandIndex = sliceIndex * PushConstants.drawSliceSize + 
+        atomicAdd(PushConstants.drawCountBuffer.drawCounts[sliceIndex], 1);
+
+    IndirectDrawCommand command;
+    command.drawRecordIndex = recordIndex;
+    command.indexCount = mesh.indexCount;
+    command.instanceCount = mesh.instanceCount;
+    command.firstIndex = mesh.firstIndex;
+    command.vertexOffset = mesh.vertexOffset;
+    command.firstInstance = 0;
+    PushConstants.indirectDrawBuffer.commands[commandIndex] = command;
+}
\ No newline at end of file
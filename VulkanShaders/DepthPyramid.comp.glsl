@@ -0,0 +1,59 @@
+#version 460
+
+//The renderer tunes the workgroup size per device through the specialization constants
+layout (local_size_x = 16, local_size_y = 16) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
+
+//Sampled with a max reduction sampler, so one sample is the farthest depth of a 2x2 footprint, when that is what a texel covers
+layout (set = 0, binding = 0) uniform sampler2D inputImage;
+
+layout (set = 0, binding = 1, r32f) uniform writeonly image2D outputImage;
+
+layout (push_constant) uniform constants
+{
+    vec2 mipExtent;
+
+    //The part of the input that was drawn, less than 1 for the depth image under dynamic resolution
+    vec2 sourceScale;
+}PushConstants;
+
+void main()
+{
+    uvec2 texelCoord = gl_GlobalInvocationID.xy;
+    if(texelCoord.x >= uint(PushConstants.mipExtent.x) || texelCoord.y >= uint(PushConstants.mipExtent.y))
+    {
+        return;
+    }
+
+    vec2 sourceExtent = vec2(textureSize(inputImage, 0)) * PushConstants.sourceScale;
+    vec2 sourceTexelsPerTexel = sourceExtent / PushConstants.mipExtent;
+
+    float depth;
+    if(sourceTexelsPerTexel == vec2(2.f))
+    {
+        //The center of the texel lands between the 2x2 texels of the level above that it covers
+        vec2 uv = (vec2(texelCoord) + vec2(0.5f)) / PushConstants.mipExtent * PushConstants.sourceScale;
+        depth = texture(inputImage, uv).x;
+    }
+    else
+    {
+        /*
+        Level 0 is a power of two that the drawn part of the depth image is not twice as large as, so a texel
+        can cover up to 3 texels of it on each axis, and the 2x2 footprint of one sample would miss some of them.
+        Every texel that the texel covers a part of is read instead. Rounding can only add a texel to the range
+        */
+        ivec2 firstTexel = ivec2(floor(vec2(texelCoord) * sourceTexelsPerTexel));
+        ivec2 lastTexel = min(ivec2(ceil(vec2(texelCoord + uvec2(1)) * sourceTexelsPerTexel)) - 1, 
+            textureSize(inputImage, 0) - 1);
+        depth = 0.f;
+        for(int y = firstTexel.y; y <= lastTexel.y; ++y)
+        {
+            for(int x = firstTexel.x; x <= lastTexel.x; ++x)
+            {
+                depth = max(depth, texelFetch(inputImage, ivec2(x, y), 0).x);
+            }
+        }
+    }
+
+    imageStore(outputImage, ivec2(texelCoord), vec4(depth));
+}
@@ -13,22 +13,73 @@ struct Vertex
     vec4 color;
 };
 
+struct DrawRecord
+{
+    uint meshIndex;
+    uint transformIndex;
+    uint materialIndex;
+    uint padding;
+};
+
+struct IndirectDrawCommand
+{
+    uint drawRecordIndex;
+
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
 layout (buffer_reference, std430) readonly buffer VertexBuffer
 {
     Vertex vertices[];
 };
 
+layout (buffer_reference, std430) readonly buffer DrawRecordBuffer
+{
+    DrawRecord records[];
+};
+
+layout (buffer_reference, std430) readonly buffer TransformBuffer
+{
+    mat4 transforms[];
+};
+
+layout (buffer_reference, std430) readonly buffer IndirectDrawBuffer
+{
+    IndirectDrawCommand commands[];
+};
+
+layout (buffer_reference, std430) readonly buffer CameraBuffer
+{
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+};
+
 layout (push_constant) uniform constants
 {
-    mat4 model;
     VertexBuffer vertexBuffer;
+    DrawRecordBuffer drawRecordBuffer;
+    TransformBuffer transformBuffer;
+    IndirectDrawBuffer indirectDrawBuffer;
+    CameraBuffer cameraBuffer;
+    uint drawCommandOffset;
 }PushConstants;
 
 void main()
 {
+    //The draw command that this vertex belongs to leads to the object that is drawn
+    uint drawRecordIndex = PushConstants.indirectDrawBuffer.commands[
+        PushConstants.drawCommandOffset + gl_DrawID].drawRecordIndex;
+    DrawRecord record = PushConstants.drawRecordBuffer.records[drawRecordIndex];
+    mat4 model = PushConstants.transformBuffer.transforms[record.transformIndex];
+
+    //gl_VertexIndex already includes the vertex offset of the mesh in the geometry arena
     Vertex vertex = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
 
-    gl_Position = vec4(vertex.position, 1.0f);
+    gl_Position = PushConstants.cameraBuffer.viewProjection * model * vec4(vertex.position, 1.0f);
     outColor = vertex.color;
     uvMap.x = vertex.uv_x;
     uvMap.y = vertex.uv_y;
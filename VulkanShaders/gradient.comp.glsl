@@ -1,8 +1,9 @@
 //GLSL version to use
 #version 460
 
-//size of a workgroup for compute
+//size of a workgroup for compute, the renderer tunes it per device through the specialization constants
 layout (local_size_x = 16, local_size_y = 16) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
 //descriptor bindings for the pipeline
 layout(rgba16f,set = 0, binding = 0) uniform image2D image;
@@ -19,7 +20,8 @@ layout( push_constant ) uniform constant
 void main() 
 {
     ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
-	ivec2 size = imageSize(image);
+	//Only the draw extent of the image is used, which the renderer passes after the colors
+	ivec2 size = ivec2(pushConstants.data3.xy);
 
     vec4 topColor = pushConstants.data1;
     vec4 bottomColor = pushConstants.data2;
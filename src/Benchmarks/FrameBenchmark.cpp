@@ -0,0 +1,500 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+
+#include "Rendering/Vulkan/VulkanRenderer/VulkanRenderer.h"
+
+#include "Engine/GameObjects/Mesh.h"
+
+#include "Engine/Jobs/JobSystem.h"
+
+//How many meshes one job of the scene generation creates
+#define BLITZEN_BENCHMARK_SCENE_JOB_BATCH_SIZE		16
+
+
+
+
+/*----------------------------------------------------------------------
+Drives the VulkanRenderer for a fixed number of frames over a generated
+scene and reports how long each stage of DrawFrame took. Usage:
+FrameBenchmark [--meshes N] [--triangles N] [--instances N] [--frames N]
+	[--warmup N] [--zoom factor] [--threads N] [--json filepath] [--trace filepath] [--windowed]
+	[--cold-pipeline-cache] [--packed-shaders] [--tune-workgroups] [--frames-in-flight N]
+-----------------------------------------------------------------------*/
+
+struct FrameBenchmarkSettings
+{
+	uint32_t meshCount = 1;
+	uint32_t trianglesPerMesh = 2;
+	uint32_t instancesPerMesh = 1;
+
+	uint32_t frameCount = 1000;
+	//Frames that are drawn before measurements start, so that startup costs are left out
+	uint32_t warmupFrameCount = 60;
+
+	//Scales the camera, so that above 1 only the center of the grid is visible and the rest gets culled
+	float zoom = 1.f;
+
+	//Threads of the job system, which generates the scene and records the geometry passes. 0 uses every hardware thread
+	uint32_t jobThreadCount = 0;
+
+	//How many frames the renderer keeps in flight
+	uint32_t framesInFlight = BLITZEN_VULKAN_DEFAULT_FRAMES_IN_FLIGHT;
+
+	const char* jsonFilepath = nullptr;
+	//Cpu zones of the measured frames are written here as a Chrome trace
+	const char* traceFilepath = nullptr;
+
+	bool bHeadless = true;
+
+	//Deletes the pipeline cache file before the renderer starts, so that startup compiles every pipeline
+	bool bColdPipelineCache = false;
+
+	//Reads the library that the build packed even when the shaders could be compiled at runtime
+	bool bPackedShaders = false;
+
+	//Tunes the workgroup sizes of the compute kernels again, instead of using the ones an earlier run found
+	bool bRetuneWorkgroups = false;
+};
+
+//Holds the percentiles of one of the timings that the benchmark measures
+struct FrameTimingSummary
+{
+	double average = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+void ParseBenchmarkArguments(int argc, char* argv[], FrameBenchmarkSettings& settings)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		bool bHasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--meshes") && bHasValue)
+		{
+			settings.meshCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--triangles") && bHasValue)
+		{
+			settings.trianglesPerMesh = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--instances") && bHasValue)
+		{
+			settings.instancesPerMesh = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--frames") && bHasValue)
+		{
+			settings.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--warmup") && bHasValue)
+		{
+			settings.warmupFrameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--zoom") && bHasValue)
+		{
+			settings.zoom = std::stof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--threads") && bHasValue)
+		{
+			settings.jobThreadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--frames-in-flight") && bHasValue)
+		{
+			settings.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--json") && bHasValue)
+		{
+			settings.jsonFilepath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--trace") && bHasValue)
+		{
+			settings.traceFilepath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--cold-pipeline-cache"))
+		{
+			settings.bColdPipelineCache = true;
+		}
+		else if (!strcmp(argv[i], "--packed-shaders"))
+		{
+			settings.bPackedShaders = true;
+		}
+		else if (!strcmp(argv[i], "--tune-workgroups"))
+		{
+			settings.bRetuneWorkgroups = true;
+		}
+		else if (!strcmp(argv[i], "--windowed"))
+		{
+			settings.bHeadless = false;
+		}
+	}
+
+	//The renderer always needs something to draw
+	settings.meshCount = std::max(settings.meshCount, 1u);
+	settings.trianglesPerMesh = std::max(settings.trianglesPerMesh, 1u);
+	settings.instancesPerMesh = std::max(settings.instancesPerMesh, 1u);
+	settings.frameCount = std::max(settings.frameCount, 1u);
+	settings.framesInFlight = std::clamp(settings.framesInFlight, 1u, BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT);
+	if (settings.zoom <= 0.f)
+	{
+		settings.zoom = 1.f;
+	}
+}
+
+/*
+Places the meshes on a square grid that covers the screen. Each mesh fills its
+cell with a strip of small triangles, so that triangle count scales the vertex
+work without changing the covered area too much
+*/
+void GenerateBenchmarkScene(const FrameBenchmarkSettings& settings,
+	std::vector<BlitzenEngine::VulkanMesh>& meshes)
+{
+	meshes.resize(settings.meshCount);
+
+	uint32_t gridSize = 1;
+	while (gridSize * gridSize < settings.meshCount)
+	{
+		++gridSize;
+	}
+	float cellSize = 2.f / static_cast<float>(gridSize);
+	float triangleWidth = cellSize / static_cast<float>(settings.trianglesPerMesh);
+
+	//Each mesh only writes its own vectors, so large scenes are generated on the job threads
+	BlitzenEngine::JobSystem::ParallelFor(settings.meshCount, BLITZEN_BENCHMARK_SCENE_JOB_BATCH_SIZE,
+		[&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				BlitzenEngine::VulkanMesh& mesh = meshes[i];
+				mesh.modelMatrix = glm::mat4(1.f);
+				mesh.instanceCount = settings.instancesPerMesh;
+
+				float cellX = -1.f + cellSize * static_cast<float>(i % gridSize);
+				float cellY = -1.f + cellSize * static_cast<float>(i / gridSize);
+				glm::vec4 color(static_cast<float>(i % 7) / 7.f, static_cast<float>(i % 11) / 11.f,
+					static_cast<float>(i % 13) / 13.f, 1.f);
+
+				mesh.vertices.resize(settings.trianglesPerMesh * 3);
+				mesh.indices.resize(settings.trianglesPerMesh * 3);
+				for (uint32_t t = 0; t < settings.trianglesPerMesh; ++t)
+				{
+					float left = cellX + triangleWidth * static_cast<float>(t);
+					mesh.vertices[t * 3].position = glm::vec3(left, cellY, 0.f);
+					mesh.vertices[t * 3 + 1].position = glm::vec3(left + triangleWidth, cellY, 0.f);
+					mesh.vertices[t * 3 + 2].position = glm::vec3(left, cellY + cellSize, 0.f);
+					for (uint32_t v = 0; v < 3; ++v)
+					{
+						mesh.vertices[t * 3 + v].color = color;
+						mesh.indices[t * 3 + v] = t * 3 + v;
+					}
+				}
+			}
+		});
+}
+
+//Sorts the samples and finds the nearest rank percentiles
+void SummarizeTimings(std::vector<double>& samples, FrameTimingSummary& summary)
+{
+	if (samples.empty())
+	{
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0.0;
+	for (double sample : samples)
+	{
+		total += sample;
+	}
+	summary.average = total / static_cast<double>(samples.size());
+
+	auto percentile = [&samples](double p)
+	{
+		size_t rank = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+		return samples[rank];
+	};
+	summary.p50 = percentile(0.50);
+	summary.p95 = percentile(0.95);
+	summary.p99 = percentile(0.99);
+	summary.max = samples.back();
+}
+
+void PrintTimingSummary(const char* name, const FrameTimingSummary& summary)
+{
+	std::cout << name << ": avg " << summary.average << "ms, p50 " << summary.p50
+		<< "ms, p95 " << summary.p95 << "ms, p99 " << summary.p99 << "ms, max "
+		<< summary.max << "ms" << '\n';
+}
+
+void WriteTimingSummaryJson(std::ofstream& file, const char* name,
+	const FrameTimingSummary& summary, bool bLast)
+{
+	file << "\t\t\"" << name << "\": { \"avg\": " << summary.average << ", \"p50\": "
+		<< summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+		<< ", \"max\": " << summary.max << " }" << (bLast ? "" : ",") << '\n';
+}
+
+/*
+Creates the renderer, draws the frames and reports their timings. The renderer is destroyed when this returns,
+while the job system still runs the jobs that it waits for
+*/
+int RunFrameBenchmark(const FrameBenchmarkSettings& settings)
+{
+	std::vector<BlitzenEngine::VulkanMesh> meshes;
+	GenerateBenchmarkScene(settings, meshes);
+
+	VulkanRendererSettings rendererSettings;
+	rendererSettings.bHeadless = settings.bHeadless;
+	rendererSettings.bCompileShadersAtRuntime = rendererSettings.bCompileShadersAtRuntime && 
+		!settings.bPackedShaders;
+	rendererSettings.bRetuneWorkgroups = settings.bRetuneWorkgroups;
+	rendererSettings.framesInFlight = settings.framesInFlight;
+	if (settings.bColdPipelineCache)
+	{
+		std::remove(rendererSettings.pipelineCacheFilepath);
+	}
+	VulkanRenderer vulkanRenderer(meshes.data(), static_cast<uint32_t>(meshes.size()),
+		rendererSettings);
+	//Joins the pipeline jobs here, so that the wait is part of the startup time and not of the first frame
+	if (!vulkanRenderer.WaitForPipelines())
+	{
+		std::cout << "Failed to create the pipelines" << '\n' 
+			<< vulkanRenderer.GetStartupStats().shaderErrorLog;
+		return 1;
+	}
+	vulkanRenderer.SetViewProjection(glm::mat4(glm::vec4(settings.zoom, 0.f, 0.f, 0.f),
+		glm::vec4(0.f, settings.zoom, 0.f, 0.f), glm::vec4(0.f, 0.f, 1.f, 0.f),
+		glm::vec4(0.f, 0.f, 0.f, 1.f)));
+
+	std::vector<double> frameWaitTimes;
+	std::vector<double> recordTimes;
+	std::vector<double> submitTimes;
+	std::vector<double> gpuTimes;
+	std::vector<double> drawnObjectCounts;
+	std::vector<double> culledObjectCounts;
+	//The gpu time of each pass that the renderer profiles, by pass name
+	std::map<std::string, std::vector<double>> gpuZoneTimes;
+	frameWaitTimes.reserve(settings.frameCount);
+	recordTimes.reserve(settings.frameCount);
+	submitTimes.reserve(settings.frameCount);
+	gpuTimes.reserve(settings.frameCount);
+
+	uint32_t totalFrameCount = settings.warmupFrameCount + settings.frameCount;
+	uint32_t skippedFrameCount = 0;
+	for (uint32_t i = 0; i < totalFrameCount; ++i)
+	{
+		if (!settings.bHeadless)
+		{
+			glfwPollEvents();
+		}
+
+		//The capture starts with the first measured frame, so that warmup zones stay out of the trace
+		if (settings.traceFilepath && i == settings.warmupFrameCount)
+		{
+			BlitzenEngine::CpuProfiler::StartCapture();
+		}
+
+		vulkanRenderer.DrawFrame();
+
+		if (i < settings.warmupFrameCount)
+		{
+			continue;
+		}
+
+		//A skipped frame has no timings of its own, and a submitted one only has gpu results if they were ready
+		const VulkanFrameStats& frameStats = vulkanRenderer.GetLastFrameStats();
+		if (!frameStats.bSubmitted)
+		{
+			++skippedFrameCount;
+			continue;
+		}
+		frameWaitTimes.push_back(frameStats.frameWaitTime);
+		recordTimes.push_back(frameStats.recordTime);
+		submitTimes.push_back(frameStats.submitTime);
+		if (frameStats.bGpuTimeValid)
+		{
+			gpuTimes.push_back(frameStats.gpuTime);
+			for (const VulkanGpuZoneTiming& zoneTiming : vulkanRenderer.GetGpuZoneTimings())
+			{
+				gpuZoneTimes[zoneTiming.name].push_back(zoneTiming.gpuTime);
+			}
+		}
+		if (frameStats.bCullingStatsValid)
+		{
+			drawnObjectCounts.push_back(static_cast<double>(frameStats.drawnObjectCount));
+			culledObjectCounts.push_back(static_cast<double>(frameStats.culledObjectCount));
+		}
+	}
+
+	if (settings.traceFilepath)
+	{
+		BlitzenEngine::CpuProfiler::StopCapture();
+		BlitzenEngine::CpuProfiler::ExportChromeTrace(settings.traceFilepath);
+	}
+
+	FrameTimingSummary frameWaitSummary;
+	FrameTimingSummary recordSummary;
+	FrameTimingSummary submitSummary;
+	FrameTimingSummary gpuSummary;
+	SummarizeTimings(frameWaitTimes, frameWaitSummary);
+	SummarizeTimings(recordTimes, recordSummary);
+	SummarizeTimings(submitTimes, submitSummary);
+	SummarizeTimings(gpuTimes, gpuSummary);
+
+	//The object counts use the same summary, only their averages are reported
+	FrameTimingSummary drawnObjectSummary;
+	FrameTimingSummary culledObjectSummary;
+	SummarizeTimings(drawnObjectCounts, drawnObjectSummary);
+	SummarizeTimings(culledObjectCounts, culledObjectSummary);
+
+	std::map<std::string, FrameTimingSummary> gpuZoneSummaries;
+	for (auto& zoneTimes : gpuZoneTimes)
+	{
+		SummarizeTimings(zoneTimes.second, gpuZoneSummaries[zoneTimes.first]);
+	}
+
+	std::cout << "Meshes: " << settings.meshCount << ", triangles per mesh: "
+		<< settings.trianglesPerMesh << ", instances per mesh: " << settings.instancesPerMesh
+		<< ", frames: " << settings.frameCount << " (" << skippedFrameCount << " skipped), zoom: " << settings.zoom 
+		<< ", job threads: " << BlitzenEngine::JobSystem::GetThreadCount() 
+		<< ", frames in flight: " << settings.framesInFlight << '\n';
+	std::cout << "Objects drawn: " << drawnObjectSummary.average << ", culled: "
+		<< culledObjectSummary.average << '\n';
+	//Every frame records the same passes, so the last one has the same barriers as the others
+	const VulkanFrameStats& lastFrameStats = vulkanRenderer.GetLastFrameStats();
+	std::cout << "Barriers per frame: " << lastFrameStats.barrierCount << ", in " 
+		<< lastFrameStats.barrierBatchCount << " batches" << '\n';
+	std::cout << "Render graph passes: " << lastFrameStats.renderGraphPassCount << ", culled: " 
+		<< lastFrameStats.culledPassCount << ", async compute candidates: " 
+		<< lastFrameStats.asyncComputePassCount << '\n';
+	const VulkanStartupStats& startupStats = vulkanRenderer.GetStartupStats();
+	std::cout << "Startup: " << startupStats.totalTime << "ms, pipelines: " << startupStats.pipelineTime
+		<< "ms, pipeline cache: " << (startupStats.bPipelineCacheWarm ? "warm (" : "cold (")
+		<< startupStats.pipelineCacheLoadedSize << " bytes), waited for pipelines: "
+		<< startupStats.pipelineWaitTime << "ms" << '\n';
+	std::cout << "Shaders: " << startupStats.shaderTime << "ms, ";
+	if (startupStats.bShadersCompiledAtRuntime)
+	{
+		std::cout << startupStats.shaderCompileCount << " compiled, " << startupStats.shaderCacheHitCount
+			<< " from the shader cache" << '\n';
+	}
+	else
+	{
+		std::cout << "packed library" << '\n';
+	}
+	for (const VulkanPipelineCompileTiming& timing : startupStats.pipelineTimings)
+	{
+		std::cout << "Pipeline " << timing.pipelineName << ": " << timing.compileTime << "ms, started at "
+			<< timing.startTime << "ms on job thread " << timing.jobThreadIndex << '\n';
+	}
+	std::cout << "Workgroup tuning: " << startupStats.workgroupTuningTime << "ms" << '\n';
+	for (const VulkanWorkgroupTuningStats& tuning : startupStats.workgroupTuning)
+	{
+		std::cout << "Kernel " << tuning.kernelName << ": " << tuning.workgroupSize.x << "x" 
+			<< tuning.workgroupSize.y << "x" << tuning.workgroupSize.z;
+		if (tuning.bTuned)
+		{
+			std::cout << ", tuned at " << tuning.dispatchTime << "ms per dispatch";
+		}
+		std::cout << '\n';
+	}
+	PrintTimingSummary("Frame wait", frameWaitSummary);
+	PrintTimingSummary("Record", recordSummary);
+	PrintTimingSummary("Submit", submitSummary);
+	PrintTimingSummary("GPU", gpuSummary);
+	for (auto& zoneSummary : gpuZoneSummaries)
+	{
+		PrintTimingSummary(("GPU " + zoneSummary.first).c_str(), zoneSummary.second);
+	}
+
+	if (settings.jsonFilepath)
+	{
+		std::ofstream file(settings.jsonFilepath);
+		if (!file.is_open())
+		{
+			std::cout << "Failed to open " << settings.jsonFilepath << '\n';
+			return 1;
+		}
+
+		file << "{\n";
+		file << "\t\"meshes\": " << settings.meshCount << ",\n";
+		file << "\t\"trianglesPerMesh\": " << settings.trianglesPerMesh << ",\n";
+		file << "\t\"instancesPerMesh\": " << settings.instancesPerMesh << ",\n";
+		file << "\t\"frames\": " << settings.frameCount << ",\n";
+		file << "\t\"skippedFrames\": " << skippedFrameCount << ",\n";
+		file << "\t\"zoom\": " << settings.zoom << ",\n";
+		file << "\t\"jobThreads\": " << BlitzenEngine::JobSystem::GetThreadCount() << ",\n";
+		file << "\t\"framesInFlight\": " << settings.framesInFlight << ",\n";
+		file << "\t\"objectsDrawn\": " << drawnObjectSummary.average << ",\n";
+		file << "\t\"objectsCulled\": " << culledObjectSummary.average << ",\n";
+		file << "\t\"barriersPerFrame\": " << lastFrameStats.barrierCount << ",\n";
+		file << "\t\"barrierBatchesPerFrame\": " << lastFrameStats.barrierBatchCount << ",\n";
+		file << "\t\"renderGraphPasses\": " << lastFrameStats.renderGraphPassCount << ",\n";
+		file << "\t\"culledPasses\": " << lastFrameStats.culledPassCount << ",\n";
+		file << "\t\"asyncComputePasses\": " << lastFrameStats.asyncComputePassCount << ",\n";
+		file << "\t\"headless\": " << (settings.bHeadless ? "true" : "false") << ",\n";
+		file << "\t\"startupMs\": " << startupStats.totalTime << ",\n";
+		file << "\t\"pipelineStartupMs\": " << startupStats.pipelineTime << ",\n";
+		file << "\t\"pipelineCacheWarm\": " << (startupStats.bPipelineCacheWarm ? "true" : "false") << ",\n";
+		file << "\t\"pipelineWaitMs\": " << startupStats.pipelineWaitTime << ",\n";
+		file << "\t\"shaderStartupMs\": " << startupStats.shaderTime << ",\n";
+		file << "\t\"shadersCompiledAtRuntime\": " << (startupStats.bShadersCompiledAtRuntime ? "true" : "false") << ",\n";
+		file << "\t\"shadersCompiled\": " << startupStats.shaderCompileCount << ",\n";
+		file << "\t\"shaderCacheHits\": " << startupStats.shaderCacheHitCount << ",\n";
+		file << "\t\"workgroupTuningMs\": " << startupStats.workgroupTuningTime << ",\n";
+		file << "\t\"workgroupSizes\": {\n";
+		for (size_t i = 0; i < startupStats.workgroupTuning.size(); ++i)
+		{
+			const VulkanWorkgroupTuningStats& tuning = startupStats.workgroupTuning[i];
+			file << "\t\t\"" << tuning.kernelName << "\": [" << tuning.workgroupSize.x << ", "
+				<< tuning.workgroupSize.y << ", " << tuning.workgroupSize.z << "]"
+				<< (i + 1 == startupStats.workgroupTuning.size() ? "" : ",") << '\n';
+		}
+		file << "\t},\n";
+		file << "\t\"pipelineCompileMs\": {\n";
+		for (size_t i = 0; i < startupStats.pipelineTimings.size(); ++i)
+		{
+			file << "\t\t\"" << startupStats.pipelineTimings[i].pipelineName << "\": "
+				<< startupStats.pipelineTimings[i].compileTime
+				<< (i + 1 == startupStats.pipelineTimings.size() ? "" : ",") << '\n';
+		}
+		file << "\t},\n";
+		file << "\t\"timingsMs\": {\n";
+		WriteTimingSummaryJson(file, "frameWait", frameWaitSummary, false);
+		WriteTimingSummaryJson(file, "record", recordSummary, false);
+		WriteTimingSummaryJson(file, "submit", submitSummary, false);
+		WriteTimingSummaryJson(file, "gpu", gpuSummary, true);
+		file << "\t},\n";
+		file << "\t\"gpuPassTimingsMs\": {\n";
+		size_t zoneIndex = 0;
+		for (auto& zoneSummary : gpuZoneSummaries)
+		{
+			WriteTimingSummaryJson(file, zoneSummary.first.c_str(), zoneSummary.second,
+				++zoneIndex == gpuZoneSummaries.size());
+		}
+		file << "\t}\n";
+		file << "}\n";
+	}
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	FrameBenchmarkSettings settings;
+	ParseBenchmarkArguments(argc, argv, settings);
+
+	BlitzenEngine::JobSystem::Init(settings.jobThreadCount);
+
+	int result = RunFrameBenchmark(settings);
+
+	BlitzenEngine::JobSystem::Shutdown();
+	return result;
+}
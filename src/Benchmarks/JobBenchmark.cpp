@@ -0,0 +1,356 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <future>
+#include <cmath>
+#include <algorithm>
+
+#include "Engine/Jobs/JobSystem.h"
+
+
+
+
+/*----------------------------------------------------------------------
+Compares the job system with std::async on fine-grained tasks that look
+like the per-frame work of the engine. Each workload is split into
+batches of the same size for both, and std::async gets one task per
+batch. Usage:
+JobBenchmark [--objects N] [--iterations N] [--threads N] [--json filepath]
+-----------------------------------------------------------------------*/
+
+//The batch sizes that every workload is measured with
+static const uint32_t benchmarkBatchSizes[] = { 16, 64, 256, 1024 };
+
+struct JobBenchmarkSettings
+{
+	uint32_t objectCount = 65536;
+	uint32_t iterationCount = 50;
+
+	//Threads of the job system, 0 uses every hardware thread
+	uint32_t threadCount = 0;
+
+	const char* jsonFilepath = nullptr;
+};
+
+//A bounding sphere and what is needed to turn a visible object into a draw command
+struct BenchmarkObject
+{
+	float center[3];
+	float radius;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	uint32_t instanceCount;
+};
+
+//Same layout as VkDrawIndexedIndirectCommand, with the object it draws in front
+struct BenchmarkDrawCommand
+{
+	uint32_t objectIndex;
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+};
+
+struct BenchmarkScene
+{
+	std::vector<BenchmarkObject> objects;
+	float frustumPlanes[6][4];
+
+	std::vector<uint32_t> visibility;
+	std::vector<BenchmarkDrawCommand> commands;
+};
+
+struct WorkloadResult
+{
+	std::string name;
+	uint32_t batchSize = 0;
+	double serialTime = 0.0;
+	double jobSystemTime = 0.0;
+	double asyncTime = 0.0;
+	//Sums of what each version wrote, so that a version that skipped work shows up
+	uint64_t serialChecksum = 0;
+	uint64_t jobSystemChecksum = 0;
+	uint64_t asyncChecksum = 0;
+};
+
+void ParseBenchmarkArguments(int argc, char* argv[], JobBenchmarkSettings& settings)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		bool bHasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--objects") && bHasValue)
+		{
+			settings.objectCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--iterations") && bHasValue)
+		{
+			settings.iterationCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--threads") && bHasValue)
+		{
+			settings.threadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--json") && bHasValue)
+		{
+			settings.jsonFilepath = argv[++i];
+		}
+	}
+
+	settings.objectCount = std::max(settings.objectCount, 1u);
+	settings.iterationCount = std::max(settings.iterationCount, 1u);
+}
+
+/*
+Scatters the objects in a cube twice the size of the frustum, which is the clip space box
+of an identity camera, so that roughly one in eight of them is visible
+*/
+void GenerateBenchmarkScene(const JobBenchmarkSettings& settings, BenchmarkScene& scene)
+{
+	scene.objects.resize(settings.objectCount);
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+	};
+
+	for (uint32_t i = 0; i < settings.objectCount; ++i)
+	{
+		BenchmarkObject& object = scene.objects[i];
+		for (float& coordinate : object.center)
+		{
+			coordinate = random() * 4.f - 2.f;
+		}
+		object.radius = random() * 0.05f;
+		object.firstIndex = i * 36;
+		object.indexCount = 36;
+		object.vertexOffset = static_cast<int32_t>(i * 24);
+		object.instanceCount = 1;
+	}
+
+	const float planes[6][4] = {
+		{ 1.f, 0.f, 0.f, 1.f }, { -1.f, 0.f, 0.f, 1.f },
+		{ 0.f, 1.f, 0.f, 1.f }, { 0.f, -1.f, 0.f, 1.f },
+		{ 0.f, 0.f, 1.f, 0.f }, { 0.f, 0.f, -1.f, 1.f } };
+	memcpy(scene.frustumPlanes, planes, sizeof(planes));
+
+	scene.visibility.resize(settings.objectCount);
+	scene.commands.resize(settings.objectCount);
+}
+
+//The same sphere test as the culling compute shader
+void CullObjects(BenchmarkScene& scene, uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		const BenchmarkObject& object = scene.objects[i];
+		uint32_t bVisible = 1;
+		for (const float* plane : scene.frustumPlanes)
+		{
+			float distance = plane[0] * object.center[0] + plane[1] * object.center[1] +
+				plane[2] * object.center[2] + plane[3];
+			if (distance < -object.radius)
+			{
+				bVisible = 0;
+				break;
+			}
+		}
+		scene.visibility[i] = bVisible;
+	}
+}
+
+//Writes a draw command for every visible object, hidden objects get an empty one
+void GenerateDrawCommands(BenchmarkScene& scene, uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		const BenchmarkObject& object = scene.objects[i];
+		BenchmarkDrawCommand& command = scene.commands[i];
+		command.objectIndex = i;
+		command.indexCount = object.indexCount;
+		command.instanceCount = scene.visibility[i] ? object.instanceCount : 0;
+		command.firstIndex = object.firstIndex;
+		command.vertexOffset = object.vertexOffset;
+		command.firstInstance = 0;
+	}
+}
+
+uint64_t VisibilityChecksum(const BenchmarkScene& scene)
+{
+	uint64_t checksum = 0;
+	for (uint32_t visible : scene.visibility)
+	{
+		checksum += visible;
+	}
+	return checksum;
+}
+
+uint64_t CommandChecksum(const BenchmarkScene& scene)
+{
+	uint64_t checksum = 0;
+	for (const BenchmarkDrawCommand& command : scene.commands)
+	{
+		checksum += static_cast<uint64_t>(command.instanceCount) * command.indexCount;
+	}
+	return checksum;
+}
+
+//Runs the function on each batch and returns the average milliseconds of one iteration
+template<typename Function>
+double TimeJobSystem(const JobBenchmarkSettings& settings, uint32_t batchSize, const Function& function)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < settings.iterationCount; ++i)
+	{
+		BlitzenEngine::JobSystem::ParallelFor(settings.objectCount, batchSize, function);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / settings.iterationCount;
+}
+
+template<typename Function>
+double TimeAsync(const JobBenchmarkSettings& settings, uint32_t batchSize, const Function& function)
+{
+	std::vector<std::future<void>> futures;
+	futures.reserve((settings.objectCount + batchSize - 1) / batchSize);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < settings.iterationCount; ++i)
+	{
+		futures.clear();
+		for (uint32_t begin = 0; begin < settings.objectCount; begin += batchSize)
+		{
+			uint32_t end = std::min(begin + batchSize, settings.objectCount);
+			futures.push_back(std::async(std::launch::async, [&function, begin, end]()
+				{ function(begin, end); }));
+		}
+		for (std::future<void>& future : futures)
+		{
+			future.wait();
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / settings.iterationCount;
+}
+
+template<typename Function>
+double TimeSerial(const JobBenchmarkSettings& settings, const Function& function)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < settings.iterationCount; ++i)
+	{
+		function(0, settings.objectCount);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / settings.iterationCount;
+}
+
+/*
+Measures one workload with the three schedulers. The outputs are cleared before each run,
+and the checksum is taken after it, so that all three have to produce the same result
+*/
+template<typename Function, typename Checksum>
+void RunWorkload(const JobBenchmarkSettings& settings, BenchmarkScene& scene, const char* name,
+	uint32_t batchSize, const Function& function, const Checksum& checksum,
+	std::vector<WorkloadResult>& results)
+{
+	WorkloadResult result;
+	result.name = name;
+	result.batchSize = batchSize;
+
+	auto clearOutputs = [&scene]()
+	{
+		std::fill(scene.commands.begin(), scene.commands.end(), BenchmarkDrawCommand{});
+	};
+
+	clearOutputs();
+	result.serialTime = TimeSerial(settings, function);
+	result.serialChecksum = checksum(scene);
+
+	clearOutputs();
+	result.jobSystemTime = TimeJobSystem(settings, batchSize, function);
+	result.jobSystemChecksum = checksum(scene);
+
+	clearOutputs();
+	result.asyncTime = TimeAsync(settings, batchSize, function);
+	result.asyncChecksum = checksum(scene);
+
+	results.push_back(result);
+}
+
+int main(int argc, char* argv[])
+{
+	JobBenchmarkSettings settings;
+	ParseBenchmarkArguments(argc, argv, settings);
+
+	BlitzenEngine::JobSystem::Init(settings.threadCount);
+
+	BenchmarkScene scene;
+	GenerateBenchmarkScene(settings, scene);
+
+	auto cull = [&scene](uint32_t begin, uint32_t end) { CullObjects(scene, begin, end); };
+	auto generateCommands = [&scene](uint32_t begin, uint32_t end)
+		{ GenerateDrawCommands(scene, begin, end); };
+
+	std::vector<WorkloadResult> results;
+	for (uint32_t batchSize : benchmarkBatchSizes)
+	{
+		std::fill(scene.visibility.begin(), scene.visibility.end(), 0u);
+		RunWorkload(settings, scene, "cullObjects", batchSize, cull, VisibilityChecksum, results);
+
+		//Command generation reads the visibility that the culling runs left behind
+		RunWorkload(settings, scene, "generateDrawCommands", batchSize, generateCommands,
+			CommandChecksum, results);
+	}
+
+	std::cout << "Objects: " << settings.objectCount << ", iterations: " << settings.iterationCount
+		<< ", job threads: " << BlitzenEngine::JobSystem::GetThreadCount() << '\n';
+	bool bChecksumsMatch = true;
+	for (const WorkloadResult& result : results)
+	{
+		std::cout << result.name << " (batch " << result.batchSize << "): serial " << result.serialTime
+			<< "ms, job system " << result.jobSystemTime << "ms, std::async " << result.asyncTime << "ms";
+		if (result.jobSystemChecksum != result.serialChecksum ||
+			result.asyncChecksum != result.serialChecksum)
+		{
+			std::cout << ", results do not match";
+			bChecksumsMatch = false;
+		}
+		std::cout << '\n';
+	}
+
+	if (settings.jsonFilepath)
+	{
+		std::ofstream file(settings.jsonFilepath);
+		if (!file.is_open())
+		{
+			std::cout << "Failed to open " << settings.jsonFilepath << '\n';
+			BlitzenEngine::JobSystem::Shutdown();
+			return 1;
+		}
+
+		file << "{\n";
+		file << "\t\"objects\": " << settings.objectCount << ",\n";
+		file << "\t\"iterations\": " << settings.iterationCount << ",\n";
+		file << "\t\"jobThreads\": " << BlitzenEngine::JobSystem::GetThreadCount() << ",\n";
+		file << "\t\"timingsMs\": [\n";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			file << "\t\t{ \"workload\": \"" << results[i].name << "\", \"batchSize\": "
+				<< results[i].batchSize << ", \"serial\": " << results[i].serialTime
+				<< ", \"jobSystem\": " << results[i].jobSystemTime << ", \"async\": "
+				<< results[i].asyncTime << " }" << (i + 1 == results.size() ? "" : ",") << '\n';
+		}
+		file << "\t]\n";
+		file << "}\n";
+	}
+
+	BlitzenEngine::JobSystem::Shutdown();
+	return bChecksumsMatch ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+#include "FileWatcher.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace BlitzenEngine
+{
+#if defined(_WIN32)
+
+	//Starts the read that the next poll checks for, the buffer has to stay alive until it completes
+	static bool IssueDirectoryRead(HANDLE directory, OVERLAPPED* pOverlapped, std::vector<uint8_t>& buffer)
+	{
+		return ReadDirectoryChangesW(directory, buffer.data(), static_cast<DWORD>(buffer.size()), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, pOverlapped, nullptr);
+	}
+
+	bool FileWatcher::Init(const char* directory)
+	{
+		Cleanup();
+
+		HANDLE directoryHandle = CreateFileA(directory, FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (directoryHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		OVERLAPPED* pDirectoryOverlapped = new OVERLAPPED{};
+		pDirectoryOverlapped->hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		buffer.resize(BLITZEN_FILE_WATCHER_BUFFER_SIZE);
+		if (!pDirectoryOverlapped->hEvent ||
+			!IssueDirectoryRead(directoryHandle, pDirectoryOverlapped, buffer))
+		{
+			if (pDirectoryOverlapped->hEvent)
+			{
+				CloseHandle(pDirectoryOverlapped->hEvent);
+			}
+			delete pDirectoryOverlapped;
+			CloseHandle(directoryHandle);
+			return false;
+		}
+
+		pDirectoryHandle = directoryHandle;
+		pOverlapped = pDirectoryOverlapped;
+		bWatching = true;
+		return true;
+	}
+
+	void FileWatcher::Cleanup()
+	{
+		if (bWatching)
+		{
+			OVERLAPPED* pDirectoryOverlapped = reinterpret_cast<OVERLAPPED*>(pOverlapped);
+
+			//The read has to finish before its buffer and OVERLAPPED can be freed
+			CancelIoEx(pDirectoryHandle, pDirectoryOverlapped);
+			DWORD byteCount = 0;
+			GetOverlappedResult(pDirectoryHandle, pDirectoryOverlapped, &byteCount, TRUE);
+
+			CloseHandle(pDirectoryOverlapped->hEvent);
+			delete pDirectoryOverlapped;
+			CloseHandle(pDirectoryHandle);
+		}
+
+		bWatching = false;
+		pDirectoryHandle = nullptr;
+		pOverlapped = nullptr;
+		buffer.clear();
+	}
+
+	bool FileWatcher::PollChanges(std::vector<std::string>& filenames)
+	{
+		if (!bWatching)
+		{
+			return false;
+		}
+
+		OVERLAPPED* pDirectoryOverlapped = reinterpret_cast<OVERLAPPED*>(pOverlapped);
+		DWORD byteCount = 0;
+		if (!GetOverlappedResult(pDirectoryHandle, pDirectoryOverlapped, &byteCount, FALSE))
+		{
+			//Nothing has changed yet
+			return false;
+		}
+
+		//0 bytes means that more changed than the buffer could hold, which still counts as a change
+		DWORD offset = 0;
+		while (byteCount)
+		{
+			const FILE_NOTIFY_INFORMATION* pInfo =
+				reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer.data() + offset);
+
+			int wideLength = static_cast<int>(pInfo->FileNameLength / sizeof(WCHAR));
+			int length = WideCharToMultiByte(CP_UTF8, 0, pInfo->FileName, wideLength, nullptr, 0, nullptr, nullptr);
+			std::string filename(static_cast<size_t>(length), '\0');
+			WideCharToMultiByte(CP_UTF8, 0, pInfo->FileName, wideLength, &filename[0], length, nullptr, nullptr);
+			filenames.push_back(filename);
+
+			if (!pInfo->NextEntryOffset)
+			{
+				break;
+			}
+			offset += pInfo->NextEntryOffset;
+		}
+
+		ResetEvent(pDirectoryOverlapped->hEvent);
+		if (!IssueDirectoryRead(pDirectoryHandle, pDirectoryOverlapped, buffer))
+		{
+			//The directory is gone, so there is nothing left to watch
+			CloseHandle(pDirectoryOverlapped->hEvent);
+			delete pDirectoryOverlapped;
+			CloseHandle(pDirectoryHandle);
+			bWatching = false;
+			pDirectoryHandle = nullptr;
+			pOverlapped = nullptr;
+		}
+		return true;
+	}
+
+#else
+
+	bool FileWatcher::Init(const char* directory)
+	{
+		Cleanup();
+
+		int descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (descriptor < 0)
+		{
+			return false;
+		}
+
+		//Editors either write the file in place or write a new one and rename it over the old one
+		if (inotify_add_watch(descriptor, directory,
+			IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0)
+		{
+			close(descriptor);
+			return false;
+		}
+
+		notifyDescriptor = descriptor;
+		buffer.resize(BLITZEN_FILE_WATCHER_BUFFER_SIZE);
+		bWatching = true;
+		return true;
+	}
+
+	void FileWatcher::Cleanup()
+	{
+		if (bWatching)
+		{
+			//Closing the descriptor removes its watches
+			close(notifyDescriptor);
+		}
+
+		bWatching = false;
+		notifyDescriptor = -1;
+		buffer.clear();
+	}
+
+	bool FileWatcher::PollChanges(std::vector<std::string>& filenames)
+	{
+		if (!bWatching)
+		{
+			return false;
+		}
+
+		bool bChanged = false;
+		for (;;)
+		{
+			ssize_t byteCount = read(notifyDescriptor, buffer.data(), buffer.size());
+			if (byteCount <= 0)
+			{
+				//EAGAIN once every queued event has been read
+				if (byteCount < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				break;
+			}
+
+			size_t offset = 0;
+			while (offset < static_cast<size_t>(byteCount))
+			{
+				const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+				offset += sizeof(inotify_event) + pEvent->len;
+
+				//An overflowed queue lost events, which still counts as a change
+				if (pEvent->mask & IN_Q_OVERFLOW)
+				{
+					bChanged = true;
+					continue;
+				}
+				if ((pEvent->mask & IN_ISDIR) || !pEvent->len)
+				{
+					continue;
+				}
+
+				//The name is padded with zeros
+				filenames.push_back(std::string(pEvent->name));
+				bChanged = true;
+			}
+		}
+		return bChanged;
+	}
+
+#endif
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+
+
+//The most bytes of change notifications that one poll reads
+#define BLITZEN_FILE_WATCHER_BUFFER_SIZE		16384
+
+
+
+
+namespace BlitzenEngine
+{
+	/*-----------------------------------------------------------------------------
+	Watches one directory, without its subdirectories, for files that are written,
+	created, renamed into it or removed. Uses inotify on Linux and
+	ReadDirectoryChangesW on Windows. Nothing runs in the background, each poll
+	reads the notifications that arrived since the last one and never blocks, so
+	it can be called every frame
+	------------------------------------------------------------------------------*/
+	class FileWatcher
+	{
+	public:
+
+		FileWatcher() = default;
+
+		//The watch belongs to one object, so it can not be copied
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		inline ~FileWatcher() { Cleanup(); }
+
+		//Returns false if the directory can not be watched
+		bool Init(const char* directory);
+
+		void Cleanup();
+
+		inline bool IsWatching() const { return bWatching; }
+
+		/*
+		Adds the names of the files that changed since the last poll to the list, relative to the
+		directory. A file that changed more than once can be added more than once.
+		Returns true if anything changed
+		*/
+		bool PollChanges(std::vector<std::string>& filenames);
+
+	private:
+
+		bool bWatching = false;
+
+		//The directory handle and the OVERLAPPED of the pending read on Windows
+		void* pDirectoryHandle = nullptr;
+		void* pOverlapped = nullptr;
+
+		//The inotify descriptor elsewhere
+		int notifyDescriptor = -1;
+
+		std::vector<uint8_t> buffer;
+	};
+}
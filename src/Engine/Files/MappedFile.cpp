@@ -0,0 +1,119 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BlitzenEngine
+{
+#if defined(_WIN32)
+
+	bool MappedFile::Open(const char* filepath)
+	{
+		Close();
+
+		HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		void* pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!pView)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		pData = reinterpret_cast<const uint8_t*>(pView);
+		size = static_cast<size_t>(fileSize.QuadPart);
+		pFileHandle = file;
+		pMappingHandle = mapping;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (pData)
+		{
+			UnmapViewOfFile(pData);
+			CloseHandle(pMappingHandle);
+			CloseHandle(pFileHandle);
+		}
+
+		pData = nullptr;
+		size = 0;
+		pFileHandle = nullptr;
+		pMappingHandle = nullptr;
+	}
+
+#else
+
+	bool MappedFile::Open(const char* filepath)
+	{
+		Close();
+
+		int file = open(filepath, O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+
+		struct stat fileStats{};
+		if (fstat(file, &fileStats) != 0 || fileStats.st_size <= 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void* pView = mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		//The mapping keeps its own reference to the file
+		close(file);
+		if (pView == MAP_FAILED)
+		{
+			return false;
+		}
+
+		pData = reinterpret_cast<const uint8_t*>(pView);
+		size = static_cast<size_t>(fileStats.st_size);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (pData)
+		{
+			munmap(const_cast<uint8_t*>(pData), size);
+		}
+
+		pData = nullptr;
+		size = 0;
+	}
+
+#endif
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+
+
+namespace BlitzenEngine
+{
+	/*-----------------------------------------------------------------------------
+	A file that is mapped read only into the address space of the process. Reading
+	it does not copy anything, the pages are loaded by the OS when they are first
+	touched, and a file that many readers use stays in memory only once. The data
+	is aligned to the page size of the OS
+	------------------------------------------------------------------------------*/
+	class MappedFile
+	{
+	public:
+
+		MappedFile() = default;
+
+		//The mapping belongs to one object, so it can not be copied
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		inline ~MappedFile() { Close(); }
+
+		//Returns false if the file could not be opened or mapped, or if it is empty
+		bool Open(const char* filepath);
+
+		void Close();
+
+		inline bool IsOpen() const { return pData != nullptr; }
+
+		inline const uint8_t* GetData() const { return pData; }
+		inline size_t GetSize() const { return size; }
+
+	private:
+
+		const uint8_t* pData = nullptr;
+		size_t size = 0;
+
+		//The file and mapping handles on Windows, the file descriptor is closed right after mapping elsewhere
+		void* pFileHandle = nullptr;
+		void* pMappingHandle = nullptr;
+	};
+}
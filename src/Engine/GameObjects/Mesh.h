@@ -17,6 +17,9 @@ namespace BlitzenEngine
 
 		std::vector<uint32_t> indices;
 
-		glm::mat4 modelMatrix;
+		glm::mat4 modelMatrix = glm::mat4(1.f);
+
+		//How many times the mesh is going to be drawn with a single draw call
+		uint32_t instanceCount = 1;
 	};
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 void glfwInputs::LoadRenderingWindowInputs(GLFWwindow* pWindow)
 {
 	glfwSetWindowCloseCallback(pWindow, glfwInputs::WindowCloseCallback);
+	glfwSetFramebufferSizeCallback(pWindow, glfwInputs::FramebufferSizeCallback);
 }
 
 void glfwInputs::WindowCloseCallback(GLFWwindow* pWindow)
@@ -11,4 +12,14 @@ void glfwInputs::WindowCloseCallback(GLFWwindow* pWindow)
 		(glfwGetWindowUserPointer(pWindow));
 
 	windowData->bWindowShouldEndApplication = true;
+}
+
+void glfwInputs::FramebufferSizeCallback(GLFWwindow* pWindow, int width, int height)
+{
+	WindowData* windowData = reinterpret_cast<WindowData*>
+		(glfwGetWindowUserPointer(pWindow));
+
+	windowData->width = width;
+	windowData->height = height;
+	windowData->bWindowResized = true;
 }
\ No newline at end of file
@@ -7,11 +7,14 @@
 struct WindowData
 {
 	GLFWwindow* pWindow{ nullptr };
-	const int width = 720;
-	const int height = 560;
+	//The size of the framebuffer, updated when the window is resized
+	int width = 720;
+	int height = 560;
 	const char* title = "Blitzen Engine";
 	bool bWindowShouldStopRendering = false;
 	bool bWindowShouldEndApplication = false;
+	//Set when the framebuffer changes size. VulkanRenderer::DrawFrame() clears it right away and only sets bFramebufferResized
+	bool bWindowResized = false;
 };
 
 namespace glfwInputs
@@ -19,4 +22,7 @@ namespace glfwInputs
 	void LoadRenderingWindowInputs(GLFWwindow* pWindow);
 
 	void WindowCloseCallback(GLFWwindow* pWindow);
+
+	//Also called when the window is minimized, with a size of 0
+	void FramebufferSizeCallback(GLFWwindow* pWindow, int width, int height);
 }
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//Workers show up with their own names in captured traces
+#include "Engine/Profiling/CpuProfiler.h"
+
+//How many times an idle worker looks for jobs before it goes to sleep
+#define BLITZEN_JOB_SYSTEM_IDLE_SPIN_COUNT		64
+
+namespace BlitzenEngine
+{
+	inline void JobDeque::WriteSlot(int64_t index, const Job& job)
+	{
+		Slot& slot = slots[index & (BLITZEN_JOB_SYSTEM_DEQUE_CAPACITY - 1)];
+		slot.function.store(job.function, std::memory_order_relaxed);
+		slot.pData.store(job.pData, std::memory_order_relaxed);
+		slot.pCounter.store(job.pCounter, std::memory_order_relaxed);
+	}
+
+	inline void JobDeque::ReadSlot(int64_t index, Job& job)
+	{
+		Slot& slot = slots[index & (BLITZEN_JOB_SYSTEM_DEQUE_CAPACITY - 1)];
+		job.function = slot.function.load(std::memory_order_relaxed);
+		job.pData = slot.pData.load(std::memory_order_relaxed);
+		job.pCounter = slot.pCounter.load(std::memory_order_relaxed);
+	}
+
+	/*
+	The orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al.).
+	The release store of bottom in Push pairs with the acquire load of bottom in Steal, so a thief
+	that sees the new bottom also sees the slot
+	*/
+	bool JobDeque::Push(const Job& job)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= BLITZEN_JOB_SYSTEM_DEQUE_CAPACITY)
+		{
+			return false;
+		}
+
+		WriteSlot(b, job);
+		bottom.store(b + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool JobDeque::Pop(Job& job)
+	{
+		//Claims the bottom slot first, so thieves that come after this see it as taken
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			//Empty
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		ReadSlot(b, job);
+		if (t != b)
+		{
+			return true;
+		}
+
+		//The last job, which a thief might be taking at the same time
+		bool bWon = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+			std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return bWon;
+	}
+
+	bool JobDeque::Steal(Job& job)
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+		{
+			return false;
+		}
+
+		//If the owner reused the slot, top has moved past t and the exchange fails
+		ReadSlot(t, job);
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+			std::memory_order_relaxed);
+	}
+
+
+
+
+	namespace JobSystem
+	{
+		static uint32_t threadCount = 1;
+		static std::unique_ptr<JobDeque[]> deques;
+		static std::vector<std::thread> workers;
+
+		static thread_local uint32_t threadIndex = 0;
+
+		//External threads come after the workers, this is the first index that was not reserved yet
+		static std::atomic<uint32_t> nextExternalThreadIndex{ 1 };
+
+		//Jobs that are in a deque or in the background queue and have not been taken yet, idle workers sleep while it is 0
+		static std::atomic<int32_t> queuedJobCount{ 0 };
+		static std::atomic<uint32_t> sleepingWorkerCount{ 0 };
+		static std::atomic<bool> bShutdown{ false };
+		static std::mutex sleepMutex;
+		static std::condition_variable wakeCondition;
+
+		//Jobs of RunInBackground, oldest first. They are part of the queued count, so they wake the workers too
+		static std::mutex backgroundMutex;
+		static std::deque<JobDeque::Job> backgroundJobs;
+		static std::atomic<uint32_t> backgroundJobCount{ 0 };
+
+		//Takes the newest job of the calling thread, or steals the oldest of another thread
+		static bool FindJob(JobDeque::Job& job)
+		{
+			if (deques[threadIndex].Pop(job))
+			{
+				queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+
+			for (uint32_t i = 1; i < threadCount; ++i)
+			{
+				uint32_t victim = (threadIndex + i) % threadCount;
+				if (deques[victim].Steal(job))
+				{
+					queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		//Takes the oldest background job, or the oldest one that was started with the counter when it is not null
+		static bool FindBackgroundJob(JobDeque::Job& job, const JobCounter* pCounter)
+		{
+			if (backgroundJobCount.load(std::memory_order_relaxed) == 0)
+			{
+				return false;
+			}
+
+			std::lock_guard<std::mutex> lock(backgroundMutex);
+			auto jobIt = std::find_if(backgroundJobs.begin(), backgroundJobs.end(),
+				[pCounter](const JobDeque::Job& queuedJob)
+				{
+					return !pCounter || queuedJob.pCounter == pCounter;
+				});
+			if (jobIt == backgroundJobs.end())
+			{
+				return false;
+			}
+
+			job = *jobIt;
+			backgroundJobs.erase(jobIt);
+			backgroundJobCount.fetch_sub(1, std::memory_order_relaxed);
+			queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		static void Execute(const JobDeque::Job& job)
+		{
+			job.function(job.pData);
+
+			//Release, so that the thread that waits on the counter sees what the job wrote
+			if (job.pCounter)
+			{
+				job.pCounter->pendingJobCount.fetch_sub(1, std::memory_order_release);
+			}
+		}
+
+		static void WorkerLoop(uint32_t index)
+		{
+			threadIndex = index;
+			CpuProfiler::SetThreadName("JobWorker");
+
+			uint32_t idleCount = 0;
+			while (!bShutdown.load(std::memory_order_relaxed))
+			{
+				JobDeque::Job job;
+				if (FindJob(job) || FindBackgroundJob(job, nullptr))
+				{
+					Execute(job);
+					idleCount = 0;
+					continue;
+				}
+
+				if (++idleCount < BLITZEN_JOB_SYSTEM_IDLE_SPIN_COUNT)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				/*
+				The sleeping count goes up before the queued count is checked, and Run raises the
+				queued count before it checks the sleeping count, so one of them always sees the other
+				*/
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleepingWorkerCount.fetch_add(1, std::memory_order_seq_cst);
+				wakeCondition.wait(lock, []()
+					{
+						return bShutdown.load(std::memory_order_relaxed) ||
+							queuedJobCount.load(std::memory_order_seq_cst) > 0;
+					});
+				sleepingWorkerCount.fetch_sub(1, std::memory_order_relaxed);
+				idleCount = 0;
+			}
+		}
+
+		void Init(uint32_t requestedThreadCount /* =0 */, uint32_t externalThreadCount /* =0 */)
+		{
+			uint32_t workerThreadCount = requestedThreadCount ? requestedThreadCount :
+				static_cast<uint32_t>(std::thread::hardware_concurrency());
+			workerThreadCount = std::min(std::max(workerThreadCount, 1u),
+				static_cast<uint32_t>(BLITZEN_JOB_SYSTEM_MAX_THREADS));
+			threadCount = std::min(workerThreadCount + externalThreadCount, 
+				static_cast<uint32_t>(BLITZEN_JOB_SYSTEM_MAX_THREADS));
+			//Workers give up their place to external threads when the maximum is reached
+			workerThreadCount = std::min(workerThreadCount, std::max(threadCount - externalThreadCount, 1u));
+
+			deques = std::make_unique<JobDeque[]>(threadCount);
+			threadIndex = 0;
+			bShutdown.store(false, std::memory_order_relaxed);
+			nextExternalThreadIndex.store(workerThreadCount, std::memory_order_relaxed);
+
+			for (uint32_t i = 1; i < workerThreadCount; ++i)
+			{
+				workers.emplace_back(WorkerLoop, i);
+			}
+		}
+
+		void Shutdown()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				bShutdown.store(true, std::memory_order_relaxed);
+			}
+			wakeCondition.notify_all();
+
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+			workers.clear();
+
+			deques.reset();
+			backgroundJobs.clear();
+			backgroundJobCount.store(0, std::memory_order_relaxed);
+			queuedJobCount.store(0, std::memory_order_relaxed);
+			threadCount = 1;
+			nextExternalThreadIndex.store(1, std::memory_order_relaxed);
+		}
+
+		uint32_t GetThreadCount()
+		{
+			return threadCount;
+		}
+
+		uint32_t GetThreadIndex()
+		{
+			return threadIndex;
+		}
+
+		bool ReserveExternalThread(uint32_t& reservedThreadIndex)
+		{
+			uint32_t nextIndex = nextExternalThreadIndex.fetch_add(1, std::memory_order_relaxed);
+			if (nextIndex >= threadCount)
+			{
+				return false;
+			}
+
+			reservedThreadIndex = nextIndex;
+			return true;
+		}
+
+		void AttachThread(uint32_t reservedThreadIndex)
+		{
+			threadIndex = reservedThreadIndex;
+		}
+
+		void Run(JobFunction function, void* pData, JobCounter* pCounter)
+		{
+			if (pCounter)
+			{
+				pCounter->pendingJobCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			JobDeque::Job job;
+			job.function = function;
+			job.pData = pData;
+			job.pCounter = pCounter;
+
+			//Without Init there is nowhere to queue the job
+			if (!deques)
+			{
+				Execute(job);
+				return;
+			}
+
+			queuedJobCount.fetch_add(1, std::memory_order_seq_cst);
+			if (!deques[threadIndex].Push(job))
+			{
+				queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+				Execute(job);
+				return;
+			}
+
+			if (sleepingWorkerCount.load(std::memory_order_seq_cst) > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				wakeCondition.notify_one();
+			}
+		}
+
+		void RunInBackground(JobFunction function, void* pData, JobCounter* pCounter)
+		{
+			if (pCounter)
+			{
+				pCounter->pendingJobCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			JobDeque::Job job;
+			job.function = function;
+			job.pData = pData;
+			job.pCounter = pCounter;
+
+			//Nothing else would ever take the job
+			if (!deques || workers.empty())
+			{
+				Execute(job);
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(backgroundMutex);
+				backgroundJobs.push_back(job);
+				backgroundJobCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			queuedJobCount.fetch_add(1, std::memory_order_seq_cst);
+
+			if (sleepingWorkerCount.load(std::memory_order_seq_cst) > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				wakeCondition.notify_one();
+			}
+		}
+
+		void Wait(JobCounter& counter)
+		{
+			while (counter.pendingJobCount.load(std::memory_order_acquire) != 0)
+			{
+				//The background jobs of other counters are left to the workers
+				JobDeque::Job job;
+				if (deques && (FindJob(job) || FindBackgroundJob(job, &counter)))
+				{
+					Execute(job);
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+
+
+
+//The most threads the job system runs jobs on, including the thread that calls Init
+#define BLITZEN_JOB_SYSTEM_MAX_THREADS			32
+
+//How many jobs each thread's deque can hold before Run executes new jobs inline, needs to be a power of 2
+#define BLITZEN_JOB_SYSTEM_DEQUE_CAPACITY		4096
+
+
+
+
+namespace BlitzenEngine
+{
+	typedef void(*JobFunction)(void* pData);
+
+	/*
+	Counts the jobs of a fork that have not finished yet. Run adds to it before the job is queued
+	and the job's thread subtracts from it when the job returns, so JobSystem::Wait on a counter
+	joins everything that was started with it. A counter can be reused once it reaches 0 again
+	*/
+	struct JobCounter
+	{
+		std::atomic<uint32_t> pendingJobCount{ 0 };
+	};
+
+	/*--------------------------------------------------------------------------------------
+	Chase-Lev work-stealing deque. The owning thread pushes and pops at the bottom, and the
+	other threads steal from the top, so the owner takes its newest jobs and thieves take the
+	oldest, which tend to be the biggest. Each field of a slot is atomic, so that a thief that
+	reads a slot the owner is overwriting only loses its race on top instead of reading a
+	torn job. The capacity is fixed, Push fails when the deque is full
+	---------------------------------------------------------------------------------------*/
+	class JobDeque
+	{
+	public:
+
+		struct Job
+		{
+			JobFunction function = nullptr;
+			void* pData = nullptr;
+			JobCounter* pCounter = nullptr;
+		};
+
+		//Owner only
+		bool Push(const Job& job);
+
+		//Owner only
+		bool Pop(Job& job);
+
+		//Any thread
+		bool Steal(Job& job);
+
+	private:
+
+		struct Slot
+		{
+			std::atomic<JobFunction> function{ nullptr };
+			std::atomic<void*> pData{ nullptr };
+			std::atomic<JobCounter*> pCounter{ nullptr };
+		};
+
+		inline void WriteSlot(int64_t index, const Job& job);
+		inline void ReadSlot(int64_t index, Job& job);
+
+	private:
+
+		//On their own cache lines, since thieves hammer top while the owner works on bottom
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+
+		alignas(64) Slot slots[BLITZEN_JOB_SYSTEM_DEQUE_CAPACITY];
+	};
+
+
+
+
+	/*-----------------------------------------------------------------------------------
+	A fixed pool of worker threads that run small jobs. Every thread, including the one
+	that called Init, has its own deque. Jobs are pushed to the deque of the thread that
+	runs them and idle threads steal from the others. Wait does not block while there is
+	work, the waiting thread runs jobs until its counter reaches 0, so forks can be nested.
+	Long jobs that are polled instead of waited for go to a background queue that only the
+	workers take from, so that they never stall a thread that waits for something else.
+
+	Jobs can only be started from the thread that called Init, from attached threads or from 
+	inside other jobs. Workers that find nothing to do sleep until a new job is started
+	------------------------------------------------------------------------------------*/
+	namespace JobSystem
+	{
+		/*
+		A thread count of 0 uses the number of hardware threads. External threads are created by the
+		application, each one gets a deque and a thread index of its own once it is attached, so that 
+		it can start and wait for jobs too. They are part of the thread count but run no worker loop
+		*/
+		void Init(uint32_t requestedThreadCount = 0, uint32_t externalThreadCount = 0);
+
+		//Waits for the workers to finish the jobs that are running and joins them, queued jobs are dropped
+		void Shutdown();
+
+		//How many threads run jobs, including the thread that called Init. 1 before Init
+		uint32_t GetThreadCount();
+
+		//Index of the calling thread between 0 and GetThreadCount() - 1, the thread that called Init is 0
+		uint32_t GetThreadIndex();
+
+		/*
+		Claims one of the external thread indices for a thread that is about to be created, so that 
+		whoever creates it knows right away whether it can use jobs. Returns false if none is left
+		*/
+		bool ReserveExternalThread(uint32_t& threadIndex);
+
+		//Called by the external thread itself, with the index that was reserved for it
+		void AttachThread(uint32_t threadIndex);
+
+		//Queues a job on the calling thread's deque, or runs it right away if the deque is full
+		void Run(JobFunction function, void* pData, JobCounter* pCounter);
+
+		/*
+		Queues a job that only the worker threads take, after the jobs in the deques. A thread that waits
+		only runs it if it waits for the job's counter. Without worker threads it runs right away
+		*/
+		void RunInBackground(JobFunction function, void* pData, JobCounter* pCounter);
+
+		//Runs jobs on the calling thread until every job that was started with the counter has finished
+		void Wait(JobCounter& counter);
+
+		//Used by ParallelFor, holds one batch of the range
+		template<typename Function>
+		struct ParallelForBatch
+		{
+			const Function* pFunction;
+			uint32_t begin;
+			uint32_t end;
+
+			static void Execute(void* pData)
+			{
+				ParallelForBatch* pBatch = reinterpret_cast<ParallelForBatch*>(pData);
+				(*(pBatch->pFunction))(pBatch->begin, pBatch->end);
+			}
+		};
+
+		/*
+		Splits [0, count) into batches of batchSize and calls function(begin, end) for each of them
+		on whatever threads are free. Returns when every batch is done. The calling thread runs the last
+		batch itself, so a range that fits in one batch never touches the queues
+		*/
+		template<typename Function>
+		void ParallelFor(uint32_t count, uint32_t batchSize, const Function& function)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+			batchSize = batchSize ? batchSize : 1;
+
+			uint32_t batchCount = (count + batchSize - 1) / batchSize;
+			std::vector<ParallelForBatch<Function>> batches(batchCount);
+			JobCounter counter;
+			for (uint32_t i = 0; i < batchCount; ++i)
+			{
+				batches[i].pFunction = &function;
+				batches[i].begin = i * batchSize;
+				batches[i].end = i + 1 == batchCount ? count : (i + 1) * batchSize;
+				if (i + 1 != batchCount)
+				{
+					Run(&ParallelForBatch<Function>::Execute, &batches[i], &counter);
+				}
+			}
+
+			ParallelForBatch<Function>::Execute(&batches[batchCount - 1]);
+			Wait(counter);
+		}
+	}
+}
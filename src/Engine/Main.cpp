@@ -1,10 +1,152 @@
 #include <iostream>
+#include <cstring>
+#include <string>
 
 #include "Rendering/Vulkan/VulkanRenderer/VulkanRenderer.h"
+#include "Rendering/Vulkan/VulkanRenderer/VulkanRenderThread.h"
 
 
 #include "Engine/GameObjects/Mesh.h"
 
+#include "Engine/Jobs/JobSystem.h"
+
+//How many frames a headless run draws when --frames is not given
+#define BLITZEN_HEADLESS_DEFAULT_FRAME_COUNT		1000
+
+//How many times a second the game thread polls the input and makes a render packet when the render thread draws
+#define BLITZEN_GAME_THREAD_TICK_RATE				240.0
+
+/*
+Draws until the window is closed or the headless frames are done. The renderer is destroyed when this returns,
+while the job system still runs the jobs that it waits for. Returns false if the pipelines could not be created
+*/
+bool RunRenderer(BlitzenEngine::VulkanMesh& mesh, const VulkanRendererSettings& rendererSettings,
+	uint64_t headlessFrameCount)
+{
+	VulkanRenderer vulkanRenderer(&mesh, 1, rendererSettings);
+
+	//Joins the pipelines that the renderer compiles on the job system and logs how long each one took
+	bool bPipelinesReady = vulkanRenderer.WaitForPipelines();
+	const VulkanStartupStats& startupStats = vulkanRenderer.GetStartupStats();
+	std::cout << startupStats.shaderErrorLog;
+	for (const VulkanPipelineCompileTiming& timing : startupStats.pipelineTimings)
+	{
+		if (!timing.bCompiled)
+		{
+			std::cout << "Pipeline " << timing.pipelineName << " failed" << '\n';
+			continue;
+		}
+		std::cout << "Pipeline " << timing.pipelineName << " compiled in " << timing.compileTime 
+			<< "ms on job thread " << timing.jobThreadIndex << '\n';
+	}
+	for (const VulkanWorkgroupTuningStats& tuning : startupStats.workgroupTuning)
+	{
+		std::cout << "Kernel " << tuning.kernelName << " uses workgroups of " << tuning.workgroupSize.x << "x"
+			<< tuning.workgroupSize.y << (tuning.bTuned ? ", tuned now" : "") << '\n';
+	}
+	//With hot reload, the window stays open so that the shaders that failed can be fixed
+	if (!bPipelinesReady && !vulkanRenderer.IsShaderHotReloadActive())
+	{
+		return false;
+	}
+
+	if (rendererSettings.bHeadless)
+	{
+		for (uint64_t i = 0; i < headlessFrameCount; ++i)
+		{
+			vulkanRenderer.DrawFrame();
+		}
+	}
+	else
+	{
+		WindowData* pWindowData = &vulkanRenderer.windowData;
+
+		glfwInputs::LoadRenderingWindowInputs(pWindowData->pWindow);
+
+		uint32_t shaderReloadCount = 0;
+		auto logShaderReloads = [&shaderReloadCount](VulkanRenderer& renderer)
+		{
+			const VulkanShaderReloadStats& reloadStats = renderer.GetShaderReloadStats();
+			if (reloadStats.reloadCount != shaderReloadCount)
+			{
+				shaderReloadCount = reloadStats.reloadCount;
+				std::cout << reloadStats.lastErrorLog << "Shaders reloaded in " << reloadStats.lastReloadTime 
+					<< "ms, " << reloadStats.lastRebuiltPipelineCount << " pipelines rebuilt" << '\n';
+			}
+		};
+
+		/*
+		The window and its events belong to this thread, which turns them into render packets at a fixed rate. 
+		It never waits for the gpu or the display, the render thread does that and draws the newest packet
+		*/
+		VulkanRenderThread renderThread;
+		if (renderThread.Start(&vulkanRenderer, logShaderReloads))
+		{
+			VulkanFramePacer gameTickPacer;
+			gameTickPacer.SetTargetFrameRate(BLITZEN_GAME_THREAD_TICK_RATE);
+			while (!pWindowData->bWindowShouldEndApplication)
+			{
+				//A minimized window draws nothing, so the loop sleeps until it gets an event
+				if (!pWindowData->width || !pWindowData->height)
+				{
+					glfwWaitEvents();
+				}
+				else
+				{
+					gameTickPacer.WaitForDeadline();
+					glfwPollEvents();
+				}
+
+				VulkanRenderPacket& packet = renderThread.GetWritePacket();
+				packet.inputTime = std::chrono::steady_clock::now();
+				packet.viewProjection = glm::mat4(1.f);
+				packet.transforms.clear();
+				packet.framebufferExtent.width = static_cast<uint32_t>(pWindowData->width);
+				packet.framebufferExtent.height = static_cast<uint32_t>(pWindowData->height);
+				renderThread.SubmitPacket();
+			}
+			renderThread.Stop();
+
+			std::cout << "Render thread drew " << renderThread.GetDrawnPacketCount() << " packets, " 
+				<< renderThread.GetDroppedPacketCount() << " were replaced before they were drawn" << '\n';
+		}
+
+		//Without a job thread for the render thread, the frames are drawn on this one
+		while (!pWindowData->bWindowShouldEndApplication)
+		{
+			//A minimized window draws nothing, so the loop sleeps until it gets an event
+			if (!pWindowData->width || !pWindowData->height)
+			{
+				glfwWaitEvents();
+			}
+			else
+			{
+				//The input is polled as late as the pacer allows, so that the frame shows the newest of it
+				vulkanRenderer.WaitForNextFrame();
+				glfwPollEvents();
+			}
+			vulkanRenderer.DrawFrame();
+
+			logShaderReloads(vulkanRenderer);
+		}
+	}
+
+	const VulkanFrameStats& frameStats = vulkanRenderer.GetLastFrameStats();
+	if (frameStats.inputLatencySource != VulkanLatencySource::None)
+	{
+		std::cout << "Input latency " << frameStats.inputLatency << "ms, measured until " << 
+			(frameStats.inputLatencySource == VulkanLatencySource::PresentWait ? "the present" : "the gpu was done") << '\n';
+	}
+
+	if (rendererSettings.gpuFrameBudget > 0.0)
+	{
+		std::cout << "Drew at " << frameStats.drawExtent.width << "x" << frameStats.drawExtent.height 
+			<< ", a resolution scale of " << frameStats.resolutionScale << '\n';
+	}
+
+	return true;
+}
+
 int main(int argc, char* argv[] )
 {
 	std::cout << "Blitzen Boot" << '\n';
@@ -30,18 +172,98 @@ int main(int argc, char* argv[] )
 	mesh.indices[4] = 3;
 	mesh.indices[5] = 0;
 
-	VulkanRenderer vulkanRenderer(&mesh, 1);
+	/*
+	--headless renders without a window for a fixed number of frames,
+	which can be changed with --frames <count>
+	*/
+	VulkanRendererSettings rendererSettings;
+	uint64_t headlessFrameCount = BLITZEN_HEADLESS_DEFAULT_FRAME_COUNT;
+	//--trace <filepath> captures cpu zones from boot and writes them as a Chrome trace at the end
+	const char* traceFilepath = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--headless"))
+		{
+			rendererSettings.bHeadless = true;
+		}
+		else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+		{
+			headlessFrameCount = std::stoull(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+		{
+			traceFilepath = argv[++i];
+		}
+		//--tune-workgroups times the compute kernels again, even if an earlier run tuned them on this device
+		else if (!strcmp(argv[i], "--tune-workgroups"))
+		{
+			rendererSettings.bRetuneWorkgroups = true;
+		}
+		//--present-mode <fifo|fifo-relaxed|mailbox|immediate> picks how the swapchain presents
+		else if (!strcmp(argv[i], "--present-mode") && i + 1 < argc)
+		{
+			const char* presentModeName = argv[++i];
+			if (!strcmp(presentModeName, "mailbox"))
+			{
+				rendererSettings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			}
+			else if (!strcmp(presentModeName, "immediate"))
+			{
+				rendererSettings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			}
+			else if (!strcmp(presentModeName, "fifo-relaxed"))
+			{
+				rendererSettings.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+			}
+			else
+			{
+				rendererSettings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+			}
+		}
+		//--frames-in-flight <count> trades latency for throughput, from 1 to BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT
+		else if (!strcmp(argv[i], "--frames-in-flight") && i + 1 < argc)
+		{
+			rendererSettings.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		//--fps <target> limits the frame rate, 0 does not limit it
+		else if (!strcmp(argv[i], "--fps") && i + 1 < argc)
+		{
+			rendererSettings.targetFrameRate = std::stod(argv[++i]);
+		}
+		//--gpu-budget <milliseconds> lowers the resolution when the gpu takes longer than it for a frame
+		else if (!strcmp(argv[i], "--gpu-budget") && i + 1 < argc)
+		{
+			rendererSettings.gpuFrameBudget = std::stod(argv[++i]);
+		}
+	}
+
+	//Windowed runs pick up shader edits while they run, when the build can compile shaders
+	rendererSettings.bShaderHotReload = !rendererSettings.bHeadless && rendererSettings.bCompileShadersAtRuntime;
+
+	if (traceFilepath)
+	{
+		BlitzenEngine::CpuProfiler::SetThreadName("Main");
+		BlitzenEngine::CpuProfiler::StartCapture();
+	}
 
-	WindowData* pWindowData = &vulkanRenderer.windowData;
+	//The workers start before the renderer, which spreads its setup and command recording over them. The render thread gets a deque of its own
+	BlitzenEngine::JobSystem::Init(0, 1);
 
-	glfwInputs::LoadRenderingWindowInputs(pWindowData->pWindow);
+	bool bRendererRan = RunRenderer(mesh, rendererSettings, headlessFrameCount);
+	if (!bRendererRan)
+	{
+		BlitzenEngine::JobSystem::Shutdown();
+		return 1;
+	}
 
-	while (!pWindowData->bWindowShouldEndApplication)
+	if (traceFilepath)
 	{
-		glfwPollEvents();
-		vulkanRenderer.DrawFrame();
+		BlitzenEngine::CpuProfiler::StopCapture();
+		BlitzenEngine::CpuProfiler::ExportChromeTrace(traceFilepath);
 	}
 
+	BlitzenEngine::JobSystem::Shutdown();
+
 	std::cout << "Blitzen End" << '\n';
 	
 	/* TODO: destroy all static and dynamic objects */
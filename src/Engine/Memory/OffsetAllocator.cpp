@@ -0,0 +1,305 @@
+#include "OffsetAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace BlitzenEngine
+{
+	/*
+	Sizes are turned into bin indices like small floating point numbers, with a 5 bit exponent
+	and a 3 bit mantissa. Small sizes get their own bin, bigger ones share a bin with sizes that
+	are at most 1/8 larger
+	*/
+	static uint32_t FindHighestSetBit(uint32_t value)
+	{
+		#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse(&index, value);
+			return static_cast<uint32_t>(index);
+		#else
+			return 31u - static_cast<uint32_t>(__builtin_clz(value));
+		#endif
+	}
+
+	static uint32_t FindLowestSetBit(uint32_t value)
+	{
+		#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, value);
+			return static_cast<uint32_t>(index);
+		#else
+			return static_cast<uint32_t>(__builtin_ctz(value));
+		#endif
+	}
+
+	//Returns the lowest set bit at or after startBit, or NO_SPACE if there is none
+	static uint32_t FindLowestSetBitAfter(uint32_t mask, uint32_t startBit)
+	{
+		if (startBit >= 32)
+		{
+			return BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+		}
+
+		uint32_t maskAfter = mask & ~((1u << startBit) - 1u);
+		return maskAfter ? FindLowestSetBit(maskAfter) : BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+	}
+
+	//Finds the first bin whose sizes are all at least size, used when allocating
+	static uint32_t SizeToBinRoundUp(uint32_t size)
+	{
+		if (size < BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT)
+		{
+			return size;
+		}
+
+		uint32_t mantissaStartBit = FindHighestSetBit(size) - BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS;
+		uint32_t exponent = mantissaStartBit + 1;
+		uint32_t mantissa = (size >> mantissaStartBit) & (BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT - 1);
+
+		//Any bits below the mantissa push the size to the next bin, the carry can move it to the next exponent
+		if (size & ((1u << mantissaStartBit) - 1u))
+		{
+			++mantissa;
+		}
+		return (exponent << BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS) + mantissa;
+	}
+
+	//Finds the bin that a free range of this size is stored in
+	static uint32_t SizeToBinRoundDown(uint32_t size)
+	{
+		if (size < BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT)
+		{
+			return size;
+		}
+
+		uint32_t mantissaStartBit = FindHighestSetBit(size) - BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS;
+		uint32_t exponent = mantissaStartBit + 1;
+		uint32_t mantissa = (size >> mantissaStartBit) & (BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT - 1);
+		return (exponent << BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS) | mantissa;
+	}
+
+	void OffsetAllocator::Init(uint32_t size, uint32_t maxAllocationCount /* =128 * 1024 */)
+	{
+		freeSpace = 0;
+		usedBinsTop = 0;
+		for (uint8_t& bins : usedBins)
+		{
+			bins = 0;
+		}
+		for (uint32_t& binIndex : binIndices)
+		{
+			binIndex = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+		}
+
+		//Every allocation can leave a free range behind it, so the nodes are one more than the allocations
+		uint32_t nodeCount = maxAllocationCount + 1;
+		nodes.assign(nodeCount, Node());
+		freeNodes.resize(nodeCount);
+		for (uint32_t i = 0; i < nodeCount; ++i)
+		{
+			freeNodes[i] = nodeCount - i - 1;
+		}
+		freeNodeCount = nodeCount;
+
+		//The whole resource starts as one free range
+		InsertNodeIntoBin(size, 0);
+	}
+
+	OffsetAllocation OffsetAllocator::Allocate(uint32_t size)
+	{
+		OffsetAllocation allocation;
+
+		//A node is needed for the range that is left over after the allocation
+		if (size == 0 || freeNodeCount == 0)
+		{
+			return allocation;
+		}
+
+		uint32_t minBinIndex = SizeToBinRoundUp(size);
+		uint32_t minTopBin = minBinIndex >> BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS;
+		uint32_t minLeafBin = minBinIndex & (BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT - 1);
+
+		//First looks in the same first level bin, and then in the smallest bigger one that has free nodes
+		uint32_t topBin = minTopBin;
+		uint32_t leafBin = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+		if (topBin < BLITZEN_OFFSET_ALLOCATOR_TOP_BIN_COUNT && (usedBinsTop & (1u << topBin)))
+		{
+			leafBin = FindLowestSetBitAfter(usedBins[topBin], minLeafBin);
+		}
+		if (leafBin == BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			topBin = FindLowestSetBitAfter(usedBinsTop, minTopBin + 1);
+			if (topBin == BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+			{
+				return allocation;
+			}
+			//Every range in a bigger first level bin fits, so the smallest second level bin is taken
+			leafBin = FindLowestSetBit(usedBins[topBin]);
+		}
+
+		uint32_t binIndex = (topBin << BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS) | leafBin;
+		uint32_t nodeIndex = binIndices[binIndex];
+		Node& node = nodes[nodeIndex];
+		uint32_t nodeTotalSize = node.dataSize;
+		node.dataSize = size;
+		node.bUsed = true;
+
+		//The node is taken out of the front of its bin's list
+		binIndices[binIndex] = node.binListNext;
+		if (node.binListNext != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			nodes[node.binListNext].binListPrev = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+		}
+		freeSpace -= nodeTotalSize;
+		if (binIndices[binIndex] == BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			usedBins[topBin] &= ~(1u << leafBin);
+			if (usedBins[topBin] == 0)
+			{
+				usedBinsTop &= ~(1u << topBin);
+			}
+		}
+
+		//What is left of the range goes back to the bins as a new node, right after the allocation
+		uint32_t remainderSize = nodeTotalSize - size;
+		if (remainderSize > 0)
+		{
+			uint32_t newNodeIndex = InsertNodeIntoBin(remainderSize, node.dataOffset + size);
+
+			if (node.neighbourNext != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+			{
+				nodes[node.neighbourNext].neighbourPrev = newNodeIndex;
+			}
+			nodes[newNodeIndex].neighbourPrev = nodeIndex;
+			nodes[newNodeIndex].neighbourNext = node.neighbourNext;
+			node.neighbourNext = newNodeIndex;
+		}
+
+		allocation.offset = node.dataOffset;
+		allocation.nodeIndex = nodeIndex;
+		return allocation;
+	}
+
+	void OffsetAllocator::Free(const OffsetAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+		{
+			return;
+		}
+
+		uint32_t nodeIndex = allocation.nodeIndex;
+		Node& node = nodes[nodeIndex];
+
+		uint32_t dataOffset = node.dataOffset;
+		uint32_t dataSize = node.dataSize;
+
+		//Free neighbours are merged into this range, so that two free ranges are never next to each other
+		if (node.neighbourPrev != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE && !nodes[node.neighbourPrev].bUsed)
+		{
+			Node& prevNode = nodes[node.neighbourPrev];
+			dataOffset = prevNode.dataOffset;
+			dataSize += prevNode.dataSize;
+
+			RemoveNodeFromBin(node.neighbourPrev);
+			node.neighbourPrev = prevNode.neighbourPrev;
+		}
+		if (node.neighbourNext != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE && !nodes[node.neighbourNext].bUsed)
+		{
+			Node& nextNode = nodes[node.neighbourNext];
+			dataSize += nextNode.dataSize;
+
+			RemoveNodeFromBin(node.neighbourNext);
+			node.neighbourNext = nextNode.neighbourNext;
+		}
+
+		uint32_t neighbourNext = node.neighbourNext;
+		uint32_t neighbourPrev = node.neighbourPrev;
+
+		//The node is given back and the merged range gets a new one
+		freeNodes[freeNodeCount++] = nodeIndex;
+		uint32_t combinedNodeIndex = InsertNodeIntoBin(dataSize, dataOffset);
+
+		if (neighbourNext != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			nodes[combinedNodeIndex].neighbourNext = neighbourNext;
+			nodes[neighbourNext].neighbourPrev = combinedNodeIndex;
+		}
+		if (neighbourPrev != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			nodes[combinedNodeIndex].neighbourPrev = neighbourPrev;
+			nodes[neighbourPrev].neighbourNext = combinedNodeIndex;
+		}
+	}
+
+	uint32_t OffsetAllocator::InsertNodeIntoBin(uint32_t size, uint32_t dataOffset)
+	{
+		uint32_t binIndex = SizeToBinRoundDown(size);
+		uint32_t topBin = binIndex >> BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS;
+		uint32_t leafBin = binIndex & (BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT - 1);
+
+		//The first node of a bin marks it as used
+		if (binIndices[binIndex] == BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			usedBins[topBin] |= 1u << leafBin;
+			usedBinsTop |= 1u << topBin;
+		}
+
+		//The new node goes to the front of the bin's list
+		uint32_t topNodeIndex = binIndices[binIndex];
+		uint32_t nodeIndex = freeNodes[--freeNodeCount];
+		Node& node = nodes[nodeIndex];
+		node = Node();
+		node.dataOffset = dataOffset;
+		node.dataSize = size;
+		node.binListNext = topNodeIndex;
+		if (topNodeIndex != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			nodes[topNodeIndex].binListPrev = nodeIndex;
+		}
+		binIndices[binIndex] = nodeIndex;
+
+		freeSpace += size;
+		return nodeIndex;
+	}
+
+	void OffsetAllocator::RemoveNodeFromBin(uint32_t nodeIndex)
+	{
+		Node& node = nodes[nodeIndex];
+
+		if (node.binListPrev != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+		{
+			//Not the first node of the bin, so it is only unlinked
+			nodes[node.binListPrev].binListNext = node.binListNext;
+			if (node.binListNext != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+			{
+				nodes[node.binListNext].binListPrev = node.binListPrev;
+			}
+		}
+		else
+		{
+			//The first node of the bin, so the bin's head moves to the next one
+			uint32_t binIndex = SizeToBinRoundDown(node.dataSize);
+			uint32_t topBin = binIndex >> BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS;
+			uint32_t leafBin = binIndex & (BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT - 1);
+
+			binIndices[binIndex] = node.binListNext;
+			if (node.binListNext != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+			{
+				nodes[node.binListNext].binListPrev = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+			}
+
+			if (binIndices[binIndex] == BLITZEN_OFFSET_ALLOCATOR_NO_SPACE)
+			{
+				usedBins[topBin] &= ~(1u << leafBin);
+				if (usedBins[topBin] == 0)
+				{
+					usedBinsTop &= ~(1u << topBin);
+				}
+			}
+		}
+
+		freeNodes[freeNodeCount++] = nodeIndex;
+		freeSpace -= node.dataSize;
+	}
+}
\ No newline at end of file
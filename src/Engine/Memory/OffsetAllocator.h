@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+
+
+//How many second level bins each first level bin is split into, as a power of 2
+#define BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS		3
+#define BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT		(1u << BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_BITS)
+//One first level bin for each bit of a 32 bit size
+#define BLITZEN_OFFSET_ALLOCATOR_TOP_BIN_COUNT		32u
+#define BLITZEN_OFFSET_ALLOCATOR_BIN_COUNT			(BLITZEN_OFFSET_ALLOCATOR_TOP_BIN_COUNT * BLITZEN_OFFSET_ALLOCATOR_LEAF_BIN_COUNT)
+
+//Marks an empty link or a failed allocation
+#define BLITZEN_OFFSET_ALLOCATOR_NO_SPACE			0xffffffffu
+
+
+
+
+namespace BlitzenEngine
+{
+	//The result of OffsetAllocator::Allocate. The node index is what Free needs to give the range back
+	struct OffsetAllocation
+	{
+		uint32_t offset = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+		uint32_t nodeIndex = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+
+		inline bool IsValid() const { return offset != BLITZEN_OFFSET_ALLOCATOR_NO_SPACE; }
+	};
+
+	/*-----------------------------------------------------------------------------------
+	Hands out ranges of a linear resource (like a gpu buffer) without touching its memory.
+	Free ranges are kept in two level segregated lists (TLSF). The first level is the
+	position of the highest bit of the size, and the second level splits that into a few
+	linear steps, so finding a free range that fits is a couple of bit scans. Freed ranges
+	are merged with free neighbours right away, so the resource does not fragment over time
+	------------------------------------------------------------------------------------*/
+	class OffsetAllocator
+	{
+	public:
+
+		//size is in whatever units the caller uses (bytes, vertices, indices)
+		void Init(uint32_t size, uint32_t maxAllocationCount = 128 * 1024);
+
+		//Returns an invalid allocation if there is no free range that is big enough
+		OffsetAllocation Allocate(uint32_t size);
+
+		void Free(const OffsetAllocation& allocation);
+
+		inline uint32_t GetFreeSpace() const { return freeSpace; }
+
+	private:
+
+		struct Node
+		{
+			uint32_t dataOffset = 0;
+			uint32_t dataSize = 0;
+
+			//The other free nodes in the same bin
+			uint32_t binListPrev = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+			uint32_t binListNext = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+
+			//The nodes right before and after this one in the resource, used or not
+			uint32_t neighbourPrev = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+			uint32_t neighbourNext = BLITZEN_OFFSET_ALLOCATOR_NO_SPACE;
+
+			bool bUsed = false;
+		};
+
+		//Adds a free range to the bin of its size and returns the node that holds it
+		uint32_t InsertNodeIntoBin(uint32_t size, uint32_t dataOffset);
+
+		//Removes a free node from its bin and puts it back to the unused nodes
+		void RemoveNodeFromBin(uint32_t nodeIndex);
+
+	private:
+
+		uint32_t freeSpace = 0;
+
+		//Bit i is set if first level bin i has any free nodes, usedBins does the same for the second level
+		uint32_t usedBinsTop = 0;
+		uint8_t usedBins[BLITZEN_OFFSET_ALLOCATOR_TOP_BIN_COUNT] = {};
+
+		//The first free node of each bin
+		uint32_t binIndices[BLITZEN_OFFSET_ALLOCATOR_BIN_COUNT] = {};
+
+		std::vector<Node> nodes;
+
+		//Stack of node indices that are not holding a range
+		std::vector<uint32_t> freeNodes;
+		uint32_t freeNodeCount = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace BlitzenEngine
+{
+	namespace CpuProfiler
+	{
+		std::atomic<bool> bCapturing{ false };
+
+		/*
+		The buffers are only added to under the mutex, which happens once per thread. They are never
+		freed, so that the zones of threads that have already exited can still be exported
+		*/
+		static std::mutex threadBuffersMutex;
+		static std::vector<std::unique_ptr<CpuProfilerThreadBuffer>> threadBuffers;
+
+		static thread_local CpuProfilerThreadBuffer* pThreadBuffer = nullptr;
+
+		void StartCapture()
+		{
+			bCapturing.store(true, std::memory_order_relaxed);
+		}
+
+		void StopCapture()
+		{
+			bCapturing.store(false, std::memory_order_relaxed);
+		}
+
+		CpuProfilerThreadBuffer& GetThreadBuffer()
+		{
+			if (!pThreadBuffer)
+			{
+				std::lock_guard<std::mutex> lock(threadBuffersMutex);
+				threadBuffers.push_back(std::make_unique<CpuProfilerThreadBuffer>());
+				pThreadBuffer = threadBuffers.back().get();
+				pThreadBuffer->threadId = static_cast<uint32_t>(threadBuffers.size() - 1);
+			}
+
+			return *pThreadBuffer;
+		}
+
+		void SetThreadName(const char* name)
+		{
+			CpuProfilerThreadBuffer& buffer = GetThreadBuffer();
+			std::lock_guard<std::mutex> lock(threadBuffersMutex);
+			buffer.threadName = name;
+		}
+
+		int64_t GetTime()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		//Names are written as they are, apart from the characters that would break the json string
+		static void WriteJsonString(std::ofstream& file, const char* string)
+		{
+			file << '"';
+			for (const char* c = string; *c; ++c)
+			{
+				if (*c == '"' || *c == '\\')
+				{
+					file << '\\';
+				}
+				file << *c;
+			}
+			file << '"';
+		}
+
+		bool ExportChromeTrace(const char* filepath)
+		{
+			std::ofstream file(filepath);
+			if (!file.is_open())
+			{
+				return false;
+			}
+
+			std::lock_guard<std::mutex> lock(threadBuffersMutex);
+
+			//Timestamps are large numbers of microseconds, so they should not be written in scientific notation
+			file << std::fixed << std::setprecision(3);
+			file << "{\"traceEvents\":[\n";
+			bool bFirstEvent = true;
+			std::vector<CpuProfilerEvent> events;
+			for (const std::unique_ptr<CpuProfilerThreadBuffer>& buffer : threadBuffers)
+			{
+				//Copy the events that are still in the ring, the oldest ones may have been overwritten
+				uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+				uint64_t begin = end > BLITZEN_CPU_PROFILER_RING_CAPACITY ?
+					end - BLITZEN_CPU_PROFILER_RING_CAPACITY : 0;
+				events.clear();
+				for (uint64_t i = begin; i < end; ++i)
+				{
+					const CpuProfilerRingEvent& ringEvent = buffer->events[i & (BLITZEN_CPU_PROFILER_RING_CAPACITY - 1)];
+					CpuProfilerEvent event;
+					event.name = ringEvent.name.load(std::memory_order_relaxed);
+					event.start = ringEvent.start.load(std::memory_order_relaxed);
+					event.end = ringEvent.end.load(std::memory_order_relaxed);
+					events.push_back(event);
+				}
+
+				/*
+				If the thread kept writing while copying, the events it overwrote may be torn. The fence pairs with the 
+				one before the thread's writes, so a copy that saw any of them also sees the index that they belong to. 
+				The slot of the event at the index is written before the index moves past it, so it may be torn as well
+				*/
+				std::atomic_thread_fence(std::memory_order_acquire);
+				uint64_t endAfterCopy = buffer->writeIndex.load(std::memory_order_relaxed);
+				uint64_t firstValid = endAfterCopy >= BLITZEN_CPU_PROFILER_RING_CAPACITY ?
+					endAfterCopy - BLITZEN_CPU_PROFILER_RING_CAPACITY + 1 : 0;
+
+				if (!buffer->threadName.empty())
+				{
+					file << (bFirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+						<< buffer->threadId << ",\"args\":{\"name\":";
+					WriteJsonString(file, buffer->threadName.c_str());
+					file << "}}";
+					bFirstEvent = false;
+				}
+
+				for (uint64_t i = std::max(begin, firstValid); i < end; ++i)
+				{
+					const CpuProfilerEvent& event = events[i - begin];
+					file << (bFirstEvent ? "" : ",\n") << "{\"name\":";
+					WriteJsonString(file, event.name);
+					//Chrome traces use microseconds
+					file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+						<< ",\"ts\":" << static_cast<double>(event.start) / 1000.0
+						<< ",\"dur\":" << static_cast<double>(event.end - event.start) / 1000.0 << "}";
+					bFirstEvent = false;
+				}
+			}
+			file << "\n]}\n";
+
+			return true;
+		}
+	}
+}
\ No newline at end of file
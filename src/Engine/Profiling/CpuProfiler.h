@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <string>
+#include <cstdint>
+
+
+
+
+//How many zones each thread keeps before the oldest ones are overwritten, needs to be a power of 2
+#define BLITZEN_CPU_PROFILER_RING_CAPACITY		16384
+
+#define BLITZEN_CPU_PROFILER_CONCAT_INNER(a, b)	a##b
+#define BLITZEN_CPU_PROFILER_CONCAT(a, b)		BLITZEN_CPU_PROFILER_CONCAT_INNER(a, b)
+
+/*----------------------------------------------------------------------------
+Opens a cpu zone that lasts until the end of the current scope. The name needs
+to outlive the capture, so string literals should be used. Defining
+BLITZEN_DISABLE_CPU_PROFILER compiles the zones out completely
+-----------------------------------------------------------------------------*/
+#ifndef BLITZEN_DISABLE_CPU_PROFILER
+	#define BLITZEN_CPU_PROFILER_ZONE(name) \
+	BlitzenEngine::CpuProfilerZone BLITZEN_CPU_PROFILER_CONCAT(cpuProfilerZone, __LINE__)(name)
+#else
+	#define BLITZEN_CPU_PROFILER_ZONE(name)
+#endif
+
+
+
+
+namespace BlitzenEngine
+{
+	//A zone that was closed while the capture was on, times are in nanoseconds of std::chrono::steady_clock
+	struct CpuProfilerEvent
+	{
+		const char* name = nullptr;
+		int64_t start = 0;
+		int64_t end = 0;
+	};
+
+	/*
+	An event in the ring. The exporter can read a slot while its thread writes it again, so the fields are
+	relaxed atomics instead of plain values, and a torn event is found from the write index instead
+	*/
+	struct CpuProfilerRingEvent
+	{
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<int64_t> start{ 0 };
+		std::atomic<int64_t> end{ 0 };
+	};
+
+	/*
+	Each thread that opens zones gets one of these the first time it does. Only the owning thread
+	writes to it, so no locks are needed. The write index is published with release ordering, 
+	so that the exporter can read the events from another thread
+	*/
+	struct CpuProfilerThreadBuffer
+	{
+		std::array<CpuProfilerRingEvent, BLITZEN_CPU_PROFILER_RING_CAPACITY> events;
+		std::atomic<uint64_t> writeIndex{ 0 };
+
+		uint32_t threadId = 0;
+		std::string threadName;
+	};
+
+	namespace CpuProfiler
+	{
+		//Zones are only recorded between StartCapture and StopCapture
+		void StartCapture();
+		void StopCapture();
+
+		//Checked by every zone, when false a zone costs one relaxed atomic load
+		extern std::atomic<bool> bCapturing;
+
+		//Returns the ring buffer of the calling thread, creating it the first time
+		CpuProfilerThreadBuffer& GetThreadBuffer();
+
+		//Names the calling thread in the exported trace
+		void SetThreadName(const char* name);
+
+		//Returns the current time in nanoseconds of std::chrono::steady_clock
+		int64_t GetTime();
+
+		/*
+		Writes the zones of all threads to a Chrome trace event json file that can be opened 
+		in chrome://tracing or Perfetto. It can be called during capture, but zones that are
+		overwritten while it reads are skipped
+		*/
+		bool ExportChromeTrace(const char* filepath);
+	}
+
+	//Scoped zone, use BLITZEN_CPU_PROFILER_ZONE instead of creating it directly
+	class CpuProfilerZone
+	{
+	public:
+
+		inline CpuProfilerZone(const char* zoneName)
+		{
+			if (CpuProfiler::bCapturing.load(std::memory_order_relaxed))
+			{
+				name = zoneName;
+				start = CpuProfiler::GetTime();
+			}
+		}
+
+		inline ~CpuProfilerZone()
+		{
+			if (!name)
+			{
+				return;
+			}
+
+			CpuProfilerThreadBuffer& buffer = CpuProfiler::GetThreadBuffer();
+			uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+			CpuProfilerRingEvent& event = buffer.events[index & (BLITZEN_CPU_PROFILER_RING_CAPACITY - 1)];
+
+			//An exporter that reads any of these writes also sees the write index of the event that they overwrite
+			std::atomic_thread_fence(std::memory_order_release);
+			event.name.store(name, std::memory_order_relaxed);
+			event.start.store(start, std::memory_order_relaxed);
+			event.end.store(CpuProfiler::GetTime(), std::memory_order_relaxed);
+			buffer.writeIndex.store(index + 1, std::memory_order_release);
+		}
+
+		CpuProfilerZone(const CpuProfilerZone&) = delete;
+		CpuProfilerZone& operator=(const CpuProfilerZone&) = delete;
+
+	private:
+
+		//Stays null if the capture was off when the zone was opened
+		const char* name = nullptr;
+		int64_t start = 0;
+	};
+}
\ No newline at end of file
@@ -104,14 +104,16 @@ void VulkanSDKobjects::CommandBufferSubmitInfoInit(
 
 void VulkanSDKobjects::SubmitInfo2Init(VkSubmitInfo2& queueSubmitInfo,
 	VkSemaphoreSubmitInfo* waitSemaphoreInfo, VkSemaphoreSubmitInfo* signalSemaphoreInfo,
-	VkCommandBufferSubmitInfo* commandBufferSubmit)
+	VkCommandBufferSubmitInfo* commandBufferSubmit, uint32_t waitSemaphoreInfoCount /* =1 */,
+	uint32_t signalSemaphoreInfoCount /* =1 */)
 {
 	queueSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
 	queueSubmitInfo.commandBufferInfoCount = 1;
 	queueSubmitInfo.pCommandBufferInfos = commandBufferSubmit;
-	queueSubmitInfo.waitSemaphoreInfoCount = 1;
+	//Passing nullptr for either semaphore info means that there is nothing to wait or signal
+	queueSubmitInfo.waitSemaphoreInfoCount = waitSemaphoreInfo ? waitSemaphoreInfoCount : 0;
 	queueSubmitInfo.pWaitSemaphoreInfos = waitSemaphoreInfo;
-	queueSubmitInfo.signalSemaphoreInfoCount = 1;
+	queueSubmitInfo.signalSemaphoreInfoCount = signalSemaphoreInfo ? signalSemaphoreInfoCount : 0;
 	queueSubmitInfo.pSignalSemaphoreInfos = signalSemaphoreInfo;
 }
 
@@ -493,6 +495,17 @@ void VulkanSDKobjects::FenceCreateInfoInit(
 
 
 
+void VulkanSDKobjects::QueryPoolCreateInfoInit(VkQueryPoolCreateInfo& queryPoolInfo,
+	VkQueryType queryType, uint32_t queryCount)
+{
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = queryType;
+	queryPoolInfo.queryCount = queryCount;
+}
+
+
+
+
 void VulkanSDKobjects::RenderingAttachmentInfoInit(
 	VkRenderingAttachmentInfo& renderingAttachment, VkImageView& imageView, 
 	VkImageLayout imageLayout, VkClearValue* pClearValue /* =nullptr */)
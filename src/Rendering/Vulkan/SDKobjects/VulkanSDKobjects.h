@@ -38,7 +38,8 @@ namespace VulkanSDKobjects
 	//Initializes a VkSubmitInfo2 struct to submit a command buffer to a queue
 	void SubmitInfo2Init(VkSubmitInfo2& queueSubmitInfo,
 		VkSemaphoreSubmitInfo* waitSemaphoreInfo, VkSemaphoreSubmitInfo* signalSemaphoreInfo,
-		VkCommandBufferSubmitInfo* commandBufferSubmit);
+		VkCommandBufferSubmitInfo* commandBufferSubmit, uint32_t waitSemaphoreInfoCount = 1,
+		uint32_t signalSemaphoreInfoCount = 1);
 
 	//Present a swapchain to the screen
 	void PresentInfoKHRInit(VkPresentInfoKHR& presentInfo, VkSwapchainKHR& swapchain,
@@ -224,6 +225,12 @@ namespace VulkanSDKobjects
 
 
 
+	//Initializes a VkQueryPoolCreateInfo struct for query pool creation
+	void QueryPoolCreateInfoInit(VkQueryPoolCreateInfo& queryPoolInfo,
+		VkQueryType queryType, uint32_t queryCount);
+
+
+
 
 	/*------------------------------------------------------------------------------------------------
 	Initializes a VkRenderingAttachmentInfo to pass to VkRenderingInfo so that vkCmdBeginRendering
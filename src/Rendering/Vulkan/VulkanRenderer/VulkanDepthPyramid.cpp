@@ -0,0 +1,321 @@
+#include "VulkanDepthPyramid.h"
+#include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
+
+#include <algorithm>
+
+//Returns the largest power of two that is not larger than value
+static uint32_t PreviousPowerOfTwo(uint32_t value)
+{
+	uint32_t result = 1;
+	while (result * 2 <= value)
+	{
+		result *= 2;
+	}
+	return result;
+}
+
+bool VulkanDepthPyramid::Init(const VkDevice& device, const VmaAllocator& allocator,
+	const VkImageView& depthImageView, VkExtent2D depthExtent, 
+	const VulkanShaderLibrary& shaderLibrary, const char* shaderName, const VkPipelineCache& pipelineCache,
+	const VulkanWorkgroupSize& buildWorkgroupSize)
+{
+	CreateSampler(device);
+
+	CreateDescriptorSetLayouts(device);
+
+	CreateTargets(device, allocator, depthImageView, depthExtent);
+
+	return CreatePipeline(device, shaderLibrary, shaderName, pipelineCache, buildWorkgroupSize);
+}
+
+void VulkanDepthPyramid::CreateTargets(const VkDevice& device, const VmaAllocator& allocator,
+	const VkImageView& depthImageView, VkExtent2D depthExtent)
+{
+	/*
+	Power of two levels halve exactly, so every texel of a level covers exactly 2x2 texels of the level
+	above it, and one reduction sample is enough to build it. Level 0 covers between 1 and 3 texels of
+	the depth image on each axis, the build shader reads all of them
+	*/
+	targets.extent.width = PreviousPowerOfTwo(depthExtent.width);
+	targets.extent.height = PreviousPowerOfTwo(depthExtent.height);
+	targets.depthExtent = depthExtent;
+	depthSourceScale = glm::vec2(1.f);
+
+	targets.mipLevelCount = 1;
+	while (targets.mipLevelCount < BLITZEN_VULKAN_DEPTH_PYRAMID_MAX_MIP_LEVELS &&
+		((targets.extent.width >> targets.mipLevelCount) || (targets.extent.height >> targets.mipLevelCount)))
+	{
+		++targets.mipLevelCount;
+	}
+
+	CreateImage(device, allocator);
+
+	CreateDescriptorSets(device, depthImageView);
+}
+
+void VulkanDepthPyramid::SetDrawnExtent(VkExtent2D drawnExtent)
+{
+	//The drawn part is never larger than the depth image, so a texel of level 0 still covers at most 3x3 texels of it
+	depthSourceScale.x = static_cast<float>(std::min(drawnExtent.width, targets.depthExtent.width)) / 
+		static_cast<float>(std::max(targets.depthExtent.width, 1u));
+	depthSourceScale.y = static_cast<float>(std::min(drawnExtent.height, targets.depthExtent.height)) / 
+		static_cast<float>(std::max(targets.depthExtent.height, 1u));
+}
+
+void VulkanDepthPyramid::Resize(const VkDevice& device, const VmaAllocator& allocator,
+	const VkImageView& depthImageView, VkExtent2D depthExtent, VulkanDepthPyramidTargets& oldTargets)
+{
+	//The sampler, the layouts and the pipeline do not depend on the size
+	oldTargets = targets;
+	targets = VulkanDepthPyramidTargets();
+	CreateTargets(device, allocator, depthImageView, depthExtent);
+}
+
+void VulkanDepthPyramid::DestroyTargets(const VkDevice& device, const VmaAllocator& allocator,
+	VulkanDepthPyramidTargets& oldTargets)
+{
+	//Destroying the pool also frees the sets
+	vkDestroyDescriptorPool(device, oldTargets.descriptorPool, nullptr);
+
+	for (uint32_t i = 0; i < oldTargets.mipLevelCount; ++i)
+	{
+		vkDestroyImageView(device, oldTargets.mipViews[i], nullptr);
+	}
+	vkDestroyImageView(device, oldTargets.imageView, nullptr);
+	vmaDestroyImage(allocator, oldTargets.image, oldTargets.allocation);
+
+	oldTargets = VulkanDepthPyramidTargets();
+}
+
+void VulkanDepthPyramid::CreateImage(const VkDevice& device, const VmaAllocator& allocator)
+{
+	VkFormat format = VK_FORMAT_R32_SFLOAT;
+	VkExtent3D imageExtent = { targets.extent.width, targets.extent.height, 1 };
+
+	VkImageCreateInfo imageInfo{};
+	VulkanSDKobjects::ImageCreateInfoInit(imageInfo, imageExtent, format,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+	imageInfo.mipLevels = targets.mipLevelCount;
+
+	VmaAllocationCreateInfo vmaAllocationInfo{};
+	vmaAllocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	vmaAllocationInfo.requiredFlags = VkMemoryPropertyFlags(
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	vmaCreateImage(allocator, &imageInfo, &vmaAllocationInfo, &targets.image, &targets.allocation, nullptr);
+
+	VkImageViewCreateInfo imageViewInfo{};
+	VulkanSDKobjects::ImageViewCreateInfoInit(imageViewInfo, targets.image,
+		VK_IMAGE_ASPECT_COLOR_BIT, format);
+	vkCreateImageView(device, &imageViewInfo, nullptr, &targets.imageView);
+
+	for (uint32_t i = 0; i < targets.mipLevelCount; ++i)
+	{
+		VulkanSDKobjects::ImageViewCreateInfoInit(imageViewInfo, targets.image,
+			VK_IMAGE_ASPECT_COLOR_BIT, format);
+		imageViewInfo.subresourceRange.baseMipLevel = i;
+		imageViewInfo.subresourceRange.levelCount = 1;
+		vkCreateImageView(device, &imageViewInfo, nullptr, &targets.mipViews[i]);
+	}
+}
+
+void VulkanDepthPyramid::CreateSampler(const VkDevice& device)
+{
+	//The sampler returns the largest of the texels that a linear filter would have blended
+	VkSamplerReductionModeCreateInfo reductionInfo{};
+	reductionInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO;
+	reductionInfo.reductionMode = VK_SAMPLER_REDUCTION_MODE_MAX;
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.pNext = &reductionInfo;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.f;
+	//Not clamped to the levels of one pyramid, so the sampler is kept when the pyramid is resized
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	vkCreateSampler(device, &samplerInfo, nullptr, &reductionSampler);
+}
+
+void VulkanDepthPyramid::CreateDescriptorSetLayouts(const VkDevice& device)
+{
+	std::array<VkDescriptorSetLayoutBinding, 2> buildBindings{};
+	VulkanSDKobjects::DescriptorSetLayoutBindingInit(buildBindings[0], 0,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+	VulkanSDKobjects::DescriptorSetLayoutBindingInit(buildBindings[1], 1,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+	VkDescriptorSetLayoutCreateInfo buildLayoutInfo{};
+	VulkanSDKobjects::DescriptorSetLayoutCreateInfoInit(buildLayoutInfo,
+		static_cast<uint32_t>(buildBindings.size()), buildBindings.data());
+	vkCreateDescriptorSetLayout(device, &buildLayoutInfo, nullptr, &buildSetLayout);
+
+	VkDescriptorSetLayoutBinding sampledBinding{};
+	VulkanSDKobjects::DescriptorSetLayoutBindingInit(sampledBinding, 0,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+	VkDescriptorSetLayoutCreateInfo sampledLayoutInfo{};
+	VulkanSDKobjects::DescriptorSetLayoutCreateInfoInit(sampledLayoutInfo, 1, &sampledBinding);
+	vkCreateDescriptorSetLayout(device, &sampledLayoutInfo, nullptr, &sampledSetLayout);
+}
+
+void VulkanDepthPyramid::CreateDescriptorSets(const VkDevice& device,
+	const VkImageView& depthImageView)
+{
+	//Every build set reads one image and writes one, and the culling set reads the whole pyramid
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = targets.mipLevelCount + 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = targets.mipLevelCount;
+	VkDescriptorPoolCreateInfo poolInfo{};
+	VulkanSDKobjects::DescriptorPoolCreateInfoInit(poolInfo, targets.mipLevelCount + 1,
+		static_cast<uint32_t>(poolSizes.size()), poolSizes.data());
+	vkCreateDescriptorPool(device, &poolInfo, nullptr, &targets.descriptorPool);
+
+	for (uint32_t i = 0; i < targets.mipLevelCount; ++i)
+	{
+		VkDescriptorSetAllocateInfo setInfo{};
+		VulkanSDKobjects::DescriptorSetAllocateInfoInit(setInfo, targets.descriptorPool, &buildSetLayout);
+		vkAllocateDescriptorSets(device, &setInfo, &targets.buildSets[i]);
+
+		//The first level reads the depth image, which is sampled in the shader read only layout
+		VkDescriptorImageInfo sourceDescriptor{};
+		sourceDescriptor.sampler = reductionSampler;
+		sourceDescriptor.imageView = i ? targets.mipViews[i - 1] : depthImageView;
+		sourceDescriptor.imageLayout = i ? VK_IMAGE_LAYOUT_GENERAL :
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkDescriptorImageInfo destinationDescriptor{};
+		destinationDescriptor.imageView = targets.mipViews[i];
+		destinationDescriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+		VulkanSDKobjects::WriteDescriptorSetImageInit(descriptorWrites[0], targets.buildSets[i],
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &sourceDescriptor, 0);
+		VulkanSDKobjects::WriteDescriptorSetImageInit(descriptorWrites[1], targets.buildSets[i],
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &destinationDescriptor, 1);
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()),
+			descriptorWrites.data(), 0, nullptr);
+	}
+
+	VkDescriptorSetAllocateInfo sampledSetInfo{};
+	VulkanSDKobjects::DescriptorSetAllocateInfoInit(sampledSetInfo, targets.descriptorPool,
+		&sampledSetLayout);
+	vkAllocateDescriptorSets(device, &sampledSetInfo, &targets.sampledSet);
+
+	VkDescriptorImageInfo pyramidDescriptor{};
+	pyramidDescriptor.sampler = reductionSampler;
+	pyramidDescriptor.imageView = targets.imageView;
+	pyramidDescriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	VkWriteDescriptorSet pyramidWrite{};
+	VulkanSDKobjects::WriteDescriptorSetImageInit(pyramidWrite, targets.sampledSet,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &pyramidDescriptor, 0);
+	vkUpdateDescriptorSets(device, 1, &pyramidWrite, 0, nullptr);
+}
+
+bool VulkanDepthPyramid::CreatePipeline(const VkDevice& device, const VulkanShaderLibrary& shaderLibrary,
+	const char* shaderName, const VkPipelineCache& pipelineCache, const VulkanWorkgroupSize& buildWorkgroupSize)
+{
+	VkPushConstantRange pushConstant{};
+	VulkanSDKobjects::PushConstantRangeInit(pushConstant,
+		sizeof(DepthPyramidComputePushConstant), VK_SHADER_STAGE_COMPUTE_BIT);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	VulkanSDKobjects::PipelineLayoutCreateInfoInit(pipelineLayoutInfo,
+		&buildSetLayout, 1, &pushConstant, 1);
+	vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
+
+	workgroupSize = buildWorkgroupSize;
+	return CreateBuildPipeline(device, shaderLibrary, shaderName, pipelineCache, workgroupSize, pipeline);
+}
+
+bool VulkanDepthPyramid::CreateBuildPipeline(const VkDevice& device, const VulkanShaderLibrary& shaderLibrary,
+	const char* shaderName, const VkPipelineCache& pipelineCache, const VulkanWorkgroupSize& buildWorkgroupSize,
+	VkPipeline& newPipeline) const
+{
+	VkShaderModule shaderModule{};
+	if (shaderLibrary.CreateShaderModule(device, shaderName, shaderModule) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VulkanWorkgroupSpecialization specialization;
+	specialization.Init(buildWorkgroupSize);
+
+	VkPipelineShaderStageCreateInfo shaderStage{};
+	VulkanSDKobjects::PipelineShaderStageInit(shaderStage, shaderModule,
+		VK_SHADER_STAGE_COMPUTE_BIT);
+	shaderStage.pSpecializationInfo = &specialization.info;
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStage;
+	pipelineInfo.layout = pipelineLayout;
+	VkResult pipelineResult = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, 
+		nullptr, &newPipeline);
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	return pipelineResult == VK_SUCCESS;
+}
+
+void VulkanDepthPyramid::Build(const VkCommandBuffer& commandBuffer, const VkPipeline& buildPipeline,
+	const VulkanWorkgroupSize& buildWorkgroupSize)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, buildPipeline);
+
+	//The caller's barrier moved the pyramid to the general layout, each level then waits for the one before it
+	VkImageMemoryBarrier2 imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	imageBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageBarrier.image = targets.image;
+	imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageBarrier.subresourceRange.levelCount = 1;
+	imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+	VkDependencyInfo barrierDependency{};
+	barrierDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	barrierDependency.imageMemoryBarrierCount = 1;
+	barrierDependency.pImageMemoryBarriers = &imageBarrier;
+
+	for (uint32_t i = 0; i < targets.mipLevelCount; ++i)
+	{
+		uint32_t mipWidth = std::max(targets.extent.width >> i, 1u);
+		uint32_t mipHeight = std::max(targets.extent.height >> i, 1u);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+			0, 1, &targets.buildSets[i], 0, nullptr);
+
+		DepthPyramidComputePushConstant pushConstant;
+		pushConstant.mipExtent = glm::vec2(static_cast<float>(mipWidth),
+			static_cast<float>(mipHeight));
+		pushConstant.sourceScale = i == 0 ? depthSourceScale : glm::vec2(1.f);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+			sizeof(DepthPyramidComputePushConstant), &pushConstant);
+
+		vkCmdDispatch(commandBuffer, GetWorkgroupCount(mipWidth, buildWorkgroupSize.x),
+			GetWorkgroupCount(mipHeight, buildWorkgroupSize.y), 1);
+
+		imageBarrier.subresourceRange.baseMipLevel = i;
+		vkCmdPipelineBarrier2(commandBuffer, &barrierDependency);
+	}
+}
+
+void VulkanDepthPyramid::Cleanup(const VkDevice& device, const VmaAllocator& allocator)
+{
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+
+	DestroyTargets(device, allocator, targets);
+
+	vkDestroyDescriptorSetLayout(device, buildSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, sampledSetLayout, nullptr);
+
+	vkDestroySampler(device, reductionSampler, nullptr);
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+//Includes the vulkan headers and the memory allocator
+#include "VulkanShaderData.h"
+
+#include "VulkanShaderLibrary.h"
+
+//The render graph tracks the pyramid's layout and the accesses of the passes that use it
+#include "VulkanResourceStateTracker.h"
+
+//The build kernel's workgroup size is a specialization constant
+#include "VulkanWorkgroupTuner.h"
+
+
+
+
+//The most mip levels that the pyramid can have, enough for a 65536 pixel wide draw extent
+#define BLITZEN_VULKAN_DEPTH_PYRAMID_MAX_MIP_LEVELS		16
+
+//The workgroup size of the build kernel on both dimensions, until it is tuned for the device
+#define BLITZEN_VULKAN_DEPTH_PYRAMID_WORKGROUP_SIZE		16
+
+
+
+
+/*
+The size of the mip level that the depth pyramid compute shader writes, and the part of the level 
+above it that is read. Only the depth image can have parts that were not drawn
+*/
+struct DepthPyramidComputePushConstant
+{
+	glm::vec2 mipExtent;
+	glm::vec2 sourceScale;
+};
+
+
+//The resources of the pyramid that depend on the size of the depth image, replaced together when it is resized
+struct VulkanDepthPyramidTargets
+{
+	VkImage image{ VK_NULL_HANDLE };
+	VmaAllocation allocation{ VK_NULL_HANDLE };
+	//Views all the levels, used by the culling pass
+	VkImageView imageView{ VK_NULL_HANDLE };
+	//One view for each level, used by the build pass
+	std::array<VkImageView, BLITZEN_VULKAN_DEPTH_PYRAMID_MAX_MIP_LEVELS> mipViews{};
+
+	VkExtent2D extent{ 0, 0 };
+	uint32_t mipLevelCount = 0;
+	//The size of the depth image that level 0 is built from
+	VkExtent2D depthExtent{ 0, 0 };
+
+	VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
+	//Level i is built by reading level i - 1 (or the depth image for level 0) and writing level i
+	std::array<VkDescriptorSet, BLITZEN_VULKAN_DEPTH_PYRAMID_MAX_MIP_LEVELS> buildSets{};
+	VkDescriptorSet sampledSet{ VK_NULL_HANDLE };
+
+	//A new image starts undefined, the first pass that uses it transitions it to the general layout
+	VulkanResourceState state;
+};
+
+
+/*-----------------------------------------------------------------------------------
+Hierarchical depth (Hi-Z) pyramid, built from the depth buffer by a compute pass. Each
+mip level holds the farthest depth of the texels of the level above it. The pyramid is
+sampled with a max reduction sampler, so one sample gives the farthest depth of a 2x2
+footprint, which is what the occlusion test needs to compare an object's nearest depth
+against.
+
+Mip 0 is the largest power of two that fits in the depth image, and it is built from every
+depth texel that its texels cover. The pyramid image stays in the general layout, so it can
+be written as a storage image and sampled at the same time.
+Dynamic resolution draws to a corner of the depth image, and the pyramid is built from that
+corner alone, so culling can keep mapping the screen onto the whole pyramid
+-------------------------------------------------------------------------------------*/
+class VulkanDepthPyramid
+{
+public:
+
+	/*
+	Creates the pyramid for a depth image of the given extent. The depth image view is only
+	read by the first level, and it has to be in the shader read only layout when Build is called.
+	Returns false if the build shader is not in the library or its pipeline could not be created
+	*/
+	bool Init(const VkDevice& device, const VmaAllocator& allocator,
+		const VkImageView& depthImageView, VkExtent2D depthExtent,
+		const VulkanShaderLibrary& shaderLibrary, const char* shaderName, 
+		const VkPipelineCache& pipelineCache, const VulkanWorkgroupSize& buildWorkgroupSize);
+
+	//Uses a manual cleanup function instead of the destructor since it needs the device
+	void Cleanup(const VkDevice& device, const VmaAllocator& allocator);
+
+	/*
+	Creates the image and the sets of the pyramid again for a depth image of another size. The old ones
+	are moved to oldTargets, since the frames in flight might still use them, and the caller destroys them
+	*/
+	void Resize(const VkDevice& device, const VmaAllocator& allocator,
+		const VkImageView& depthImageView, VkExtent2D depthExtent, VulkanDepthPyramidTargets& oldTargets);
+
+	static void DestroyTargets(const VkDevice& device, const VmaAllocator& allocator,
+		VulkanDepthPyramidTargets& oldTargets);
+
+	//The part of the depth image that the next builds read, the whole depth image until it is set
+	void SetDrawnExtent(VkExtent2D drawnExtent);
+
+	/*
+	Records the compute dispatches that reduce the depth image into every level of the pyramid. The
+	pyramid has to be in the general layout already, the barriers between the levels are recorded here
+	*/
+	inline void Build(const VkCommandBuffer& commandBuffer) { Build(commandBuffer, pipeline, workgroupSize); }
+
+	//Builds with another pipeline of the build kernel, which has to have been created with the workgroup size
+	void Build(const VkCommandBuffer& commandBuffer, const VkPipeline& buildPipeline,
+		const VulkanWorkgroupSize& buildWorkgroupSize);
+
+	/*
+	Creates another build pipeline with the layout of the current one, after the shader was reloaded.
+	The pyramid is not changed, the new pipeline replaces the old one through GetPipeline
+	*/
+	bool CreateBuildPipeline(const VkDevice& device, const VulkanShaderLibrary& shaderLibrary,
+		const char* shaderName, const VkPipelineCache& pipelineCache, 
+		const VulkanWorkgroupSize& buildWorkgroupSize, VkPipeline& newPipeline) const;
+
+	//The pipeline and the workgroup size that it was created with are replaced together
+	inline VkPipeline& GetPipeline() { return pipeline; }
+	inline VulkanWorkgroupSize& GetWorkgroupSize() { return workgroupSize; }
+
+	//A set with the whole pyramid and the max reduction sampler as a combined image sampler at binding 0
+	inline VkDescriptorSetLayout& GetSampledDescriptorSetLayout() { return sampledSetLayout; }
+	inline VkDescriptorSet& GetSampledDescriptorSet() { return targets.sampledSet; }
+
+	inline VkExtent2D GetExtent() const { return targets.extent; }
+
+	inline VkImage GetImage() const { return targets.image; }
+	inline VulkanResourceState& GetState() { return targets.state; }
+
+private:
+
+	//Creates everything that depends on the size of the depth image
+	void CreateTargets(const VkDevice& device, const VmaAllocator& allocator,
+		const VkImageView& depthImageView, VkExtent2D depthExtent);
+
+	void CreateImage(const VkDevice& device, const VmaAllocator& allocator);
+
+	void CreateSampler(const VkDevice& device);
+
+	void CreateDescriptorSetLayouts(const VkDevice& device);
+
+	//Creates the sets that the build pass reads and writes each level with, and the set that culling samples with
+	void CreateDescriptorSets(const VkDevice& device, const VkImageView& depthImageView);
+
+	bool CreatePipeline(const VkDevice& device, const VulkanShaderLibrary& shaderLibrary,
+		const char* shaderName, const VkPipelineCache& pipelineCache, const VulkanWorkgroupSize& buildWorkgroupSize);
+
+private:
+
+	VulkanDepthPyramidTargets targets;
+	glm::vec2 depthSourceScale{ 1.f, 1.f };
+
+	VkSampler reductionSampler{ VK_NULL_HANDLE };
+
+	VkDescriptorSetLayout buildSetLayout{ VK_NULL_HANDLE };
+	VkDescriptorSetLayout sampledSetLayout{ VK_NULL_HANDLE };
+
+	VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+	VkPipeline pipeline{ VK_NULL_HANDLE };
+	VulkanWorkgroupSize workgroupSize;
+};
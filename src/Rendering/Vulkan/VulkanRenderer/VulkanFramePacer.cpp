@@ -0,0 +1,106 @@
+#include "VulkanFramePacer.h"
+
+#include <thread>
+
+void VulkanFramePacer::Init(const VkDevice& newDevice, bool bPresentWaitEnabled)
+{
+	device = newDevice;
+
+	if (!bPresentWaitEnabled)
+	{
+		return;
+	}
+
+	pfnWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+		vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+}
+
+void VulkanFramePacer::SetTargetFrameRate(double framesPerSecond)
+{
+	targetFrameRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+	framePeriod = targetFrameRate > 0.0 ?
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(1.0 / targetFrameRate)) : std::chrono::steady_clock::duration{ 0 };
+
+	//The next frame starts a new schedule, so a lower rate does not wait for the deadline of the old one
+	bDeadlineSet = false;
+}
+
+double VulkanFramePacer::WaitForDeadline()
+{
+	if (targetFrameRate <= 0.0)
+	{
+		return 0.0;
+	}
+
+	auto sleepStart = std::chrono::steady_clock::now();
+
+	//The first frame sets the schedule that the next ones follow
+	if (!bDeadlineSet)
+	{
+		nextDeadline = sleepStart + framePeriod;
+		bDeadlineSet = true;
+		return 0.0;
+	}
+
+	if (sleepStart < nextDeadline)
+	{
+		SleepUntil(nextDeadline);
+	}
+
+	/*
+	Deadlines are a period apart instead of a period after the last wake up, so the time that
+	SleepUntil overshoots is not added to every frame. A frame that is more than a period late
+	starts the schedule again from now
+	*/
+	auto sleepEnd = std::chrono::steady_clock::now();
+	nextDeadline += framePeriod;
+	if (nextDeadline < sleepEnd)
+	{
+		nextDeadline = sleepEnd + framePeriod;
+	}
+
+	return std::chrono::duration<double, std::milli>(sleepEnd - sleepStart).count();
+}
+
+bool VulkanFramePacer::WaitForPresent(const VkSwapchainKHR& swapchain, uint64_t presentId, uint64_t timeout) const
+{
+	if (!pfnWaitForPresent || swapchain == VK_NULL_HANDLE || presentId == 0)
+	{
+		return false;
+	}
+
+	return pfnWaitForPresent(device, swapchain, presentId, timeout) == VK_SUCCESS;
+}
+
+void VulkanFramePacer::RecordInputTime(uint64_t presentId, std::chrono::steady_clock::time_point inputTime)
+{
+	size_t historyIndex = presentId % BLITZEN_VULKAN_FRAME_PACER_PRESENT_HISTORY;
+	presentIds[historyIndex] = presentId;
+	inputTimes[historyIndex] = inputTime;
+}
+
+double VulkanFramePacer::GetLatency(uint64_t presentId, std::chrono::steady_clock::time_point timePoint) const
+{
+	size_t historyIndex = presentId % BLITZEN_VULKAN_FRAME_PACER_PRESENT_HISTORY;
+	if (presentId == 0 || presentIds[historyIndex] != presentId)
+	{
+		return -1.0;
+	}
+
+	return std::chrono::duration<double, std::milli>(timePoint - inputTimes[historyIndex]).count();
+}
+
+void VulkanFramePacer::SleepUntil(std::chrono::steady_clock::time_point timePoint)
+{
+	auto spinStart = timePoint - std::chrono::microseconds(BLITZEN_VULKAN_FRAME_PACER_SPIN_MICROSECONDS);
+	if (std::chrono::steady_clock::now() < spinStart)
+	{
+		std::this_thread::sleep_until(spinStart);
+	}
+
+	while (std::chrono::steady_clock::now() < timePoint)
+	{
+		std::this_thread::yield();
+	}
+}
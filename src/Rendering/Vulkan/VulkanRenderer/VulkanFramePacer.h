@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+//The frame pacer is a standalone class, it only needs the Vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+
+
+
+//The os can wake a sleeping thread about a scheduler tick late, so the last part before a deadline is spun instead
+#define BLITZEN_VULKAN_FRAME_PACER_SPIN_MICROSECONDS		2000
+
+//How many presents the pacer remembers the input time of, more than can be waiting for the display at once
+#define BLITZEN_VULKAN_FRAME_PACER_PRESENT_HISTORY			8
+
+
+
+
+//Where the input latency of a frame was measured up to
+enum class VulkanLatencySource : uint8_t
+{
+	//Nothing could measure it, for example before the first frames are done
+	None = 0,
+
+	//Until VK_KHR_present_wait reported that the frame was shown
+	PresentWait = 1,
+
+	//Until the frame's last gpu timestamp, on the cpu timeline. It does not include the wait for the display
+	GpuTimestamps = 2
+};
+
+
+/*-------------------------------------------------------------------------------------
+Decides when the next frame starts. A target frame rate gives every frame a deadline
+that the pacer sleeps until, with the os sleep for most of it and a spin for the last
+part, which is more precise than either alone. With VK_KHR_present_wait it can also
+wait until an earlier present is on screen, so that the input of a frame is read as
+late as possible instead of while other frames are still queued for the display
+---------------------------------------------------------------------------------------*/
+class VulkanFramePacer
+{
+public:
+
+	//Loads vkWaitForPresentKHR, present wait is not used if it was not enabled on the device
+	void Init(const VkDevice& device, bool bPresentWaitEnabled);
+
+	//0 does not limit the frame rate
+	void SetTargetFrameRate(double framesPerSecond);
+
+	inline double GetTargetFrameRate() const { return targetFrameRate; }
+
+	inline bool IsPresentWaitEnabled() const { return pfnWaitForPresent != nullptr; }
+
+	/*
+	Sleeps until the deadline of the next frame and moves it one frame ahead. A frame that missed its
+	deadline moves it ahead from now, so that the frames after a stall do not run unlimited to catch up.
+	Returns how long it slept in milliseconds
+	*/
+	double WaitForDeadline();
+
+	//Waits until the present with the id is on screen, returns false if it timed out or the swapchain is out of date
+	bool WaitForPresent(const VkSwapchainKHR& swapchain, uint64_t presentId, uint64_t timeout) const;
+
+	//Remembers when the input of the frame that is presented with the id was read
+	void RecordInputTime(uint64_t presentId, std::chrono::steady_clock::time_point inputTime);
+
+	//Milliseconds from the input of the present until the time point, negative if the present is no longer remembered
+	double GetLatency(uint64_t presentId, std::chrono::steady_clock::time_point timePoint) const;
+
+	//Sleeps with the os until shortly before the time point and spins for the rest
+	static void SleepUntil(std::chrono::steady_clock::time_point timePoint);
+
+private:
+
+	VkDevice device{ VK_NULL_HANDLE };
+	PFN_vkWaitForPresentKHR pfnWaitForPresent = nullptr;
+
+	double targetFrameRate = 0.0;
+	std::chrono::steady_clock::duration framePeriod{ 0 };
+
+	//The deadline is only set by the first frame that is limited
+	std::chrono::steady_clock::time_point nextDeadline;
+	bool bDeadlineSet = false;
+
+	std::array<uint64_t, BLITZEN_VULKAN_FRAME_PACER_PRESENT_HISTORY> presentIds{};
+	std::array<std::chrono::steady_clock::time_point, BLITZEN_VULKAN_FRAME_PACER_PRESENT_HISTORY> inputTimes{};
+};
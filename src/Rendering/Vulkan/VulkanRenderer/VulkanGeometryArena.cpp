@@ -0,0 +1,83 @@
+#include "VulkanGeometryArena.h"
+#include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
+
+void VulkanGeometryArena::Init(const VkDevice& device, const VmaAllocator& allocator,
+	uint32_t vertexCapacity, uint32_t indexCapacity, uint32_t maxMeshCount)
+{
+	VmaAllocationCreateInfo arenaAllocationInfo{};
+	arenaAllocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	/*
+	The vertex buffer is an SSBO that the vertex shader reads through its device address,
+	so only its address is needed when drawing
+	*/
+	VkBufferCreateInfo vertexBufferInfo{};
+	VulkanSDKobjects::BufferCreateInfoInit(vertexBufferInfo,
+		sizeof(VulkanShaderData::Vertex) * static_cast<VkDeviceSize>(vertexCapacity),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+	vmaCreateBuffer(allocator, &vertexBufferInfo, &arenaAllocationInfo, &(vertexBuffer.buffer),
+		&(vertexBuffer.allocation), &(vertexBuffer.allocationInfo));
+
+	VkBufferDeviceAddressInfo bufferAddressInfo{};
+	bufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	bufferAddressInfo.buffer = vertexBuffer.buffer;
+	vertexBufferAddress = vkGetBufferDeviceAddress(device, &bufferAddressInfo);
+
+	VkBufferCreateInfo indexBufferInfo{};
+	VulkanSDKobjects::BufferCreateInfoInit(indexBufferInfo,
+		sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCapacity),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	vmaCreateBuffer(allocator, &indexBufferInfo, &arenaAllocationInfo, &(indexBuffer.buffer),
+		&(indexBuffer.allocation), &(indexBuffer.allocationInfo));
+
+	vertexAllocator.Init(vertexCapacity, maxMeshCount);
+	indexAllocator.Init(indexCapacity, maxMeshCount);
+}
+
+void VulkanGeometryArena::Cleanup(const VmaAllocator& allocator)
+{
+	vmaDestroyBuffer(allocator, vertexBuffer.buffer, vertexBuffer.allocation);
+	vmaDestroyBuffer(allocator, indexBuffer.buffer, indexBuffer.allocation);
+}
+
+bool VulkanGeometryArena::AllocateMesh(const std::vector<VulkanShaderData::Vertex>& vertices,
+	const std::vector<uint32_t>& indices, VulkanUploadManager& uploadManager,
+	VulkanShaderData::GPUMeshRange& meshRange)
+{
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	uint32_t indexCount = static_cast<uint32_t>(indices.size());
+
+	BlitzenEngine::OffsetAllocation vertexAllocation = vertexAllocator.Allocate(vertexCount);
+	BlitzenEngine::OffsetAllocation indexAllocation = indexAllocator.Allocate(indexCount);
+	if (!vertexAllocation.IsValid() || !indexAllocation.IsValid())
+	{
+		//Either one might have succeeded, so both are given back
+		vertexAllocator.Free(vertexAllocation);
+		indexAllocator.Free(indexAllocation);
+		meshRange = VulkanShaderData::GPUMeshRange();
+		return false;
+	}
+
+	meshRange.vertexAllocation = vertexAllocation;
+	meshRange.indexAllocation = indexAllocation;
+	meshRange.vertexCount = vertexCount;
+	meshRange.indexCount = indexCount;
+
+	//The data goes through the staging ring and is copied with the rest of the meshes
+	uploadManager.UploadToBuffer(vertices.data(), sizeof(VulkanShaderData::Vertex) * vertexCount,
+		vertexBuffer.buffer, sizeof(VulkanShaderData::Vertex) * static_cast<VkDeviceSize>(vertexAllocation.offset));
+	uploadManager.UploadToBuffer(indices.data(), sizeof(uint32_t) * indexCount,
+		indexBuffer.buffer, sizeof(uint32_t) * static_cast<VkDeviceSize>(indexAllocation.offset));
+
+	return true;
+}
+
+void VulkanGeometryArena::FreeMesh(VulkanShaderData::GPUMeshRange& meshRange)
+{
+	vertexAllocator.Free(meshRange.vertexAllocation);
+	indexAllocator.Free(meshRange.indexAllocation);
+
+	//An empty range draws nothing, and freeing it again does nothing
+	meshRange = VulkanShaderData::GPUMeshRange();
+}
\ No newline at end of file
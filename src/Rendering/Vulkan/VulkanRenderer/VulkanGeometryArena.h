@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+//Includes the vulkan headers, the memory allocator and the mesh range struct
+#include "VulkanShaderData.h"
+
+//Mesh data is copied to the arena through the staging ring
+#include "VulkanUploadManager.h"
+
+
+
+
+//The smallest number of vertices and indices that the arena is created with
+#define BLITZEN_VULKAN_GEOMETRY_ARENA_VERTEX_CAPACITY		(2u * 1024u * 1024u)
+#define BLITZEN_VULKAN_GEOMETRY_ARENA_INDEX_CAPACITY		(8u * 1024u * 1024u)
+
+//How many meshes can live in the arena at the same time
+#define BLITZEN_VULKAN_GEOMETRY_ARENA_MAX_MESHES			(128u * 1024u)
+
+
+
+
+/*-----------------------------------------------------------------------------------
+Holds the vertices and indices of every mesh in one vertex storage buffer and one index
+buffer. Each mesh is given a range of both with an offset allocator, so meshes can be
+added and removed without touching the rest. The index buffer is bound once and every
+mesh is drawn with its first index and vertex offset, which means that the vertex
+shader can always index the vertices from the base address of the arena
+-------------------------------------------------------------------------------------*/
+class VulkanGeometryArena
+{
+public:
+
+	//Capacities are in vertices and indices
+	void Init(const VkDevice& device, const VmaAllocator& allocator, uint32_t vertexCapacity,
+		uint32_t indexCapacity, uint32_t maxMeshCount);
+
+	//Uses a manual cleanup function instead of the destructor since it needs the allocator
+	void Cleanup(const VmaAllocator& allocator);
+
+	/*
+	Finds ranges for the mesh and queues the copies of its data to them. Returns false if the
+	arena does not have enough space left, in which case meshRange is left empty
+	*/
+	bool AllocateMesh(const std::vector<VulkanShaderData::Vertex>& vertices,
+		const std::vector<uint32_t>& indices, VulkanUploadManager& uploadManager,
+		VulkanShaderData::GPUMeshRange& meshRange);
+
+	/*
+	Gives the ranges of the mesh back, so that other meshes can use them. No frame that
+	is still in flight should be drawing the mesh when this is called
+	*/
+	void FreeMesh(VulkanShaderData::GPUMeshRange& meshRange);
+
+	inline VkBuffer GetIndexBuffer() const { return indexBuffer.buffer; }
+
+	inline VkDeviceAddress GetVertexBufferAddress() const { return vertexBufferAddress; }
+
+private:
+
+	VulkanShaderData::AllocatedBuffer vertexBuffer;
+	VulkanShaderData::AllocatedBuffer indexBuffer;
+	VkDeviceAddress vertexBufferAddress = 0;
+
+	BlitzenEngine::OffsetAllocator vertexAllocator;
+	BlitzenEngine::OffsetAllocator indexAllocator;
+};
\ No newline at end of file
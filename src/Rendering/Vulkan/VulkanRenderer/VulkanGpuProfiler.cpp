@@ -0,0 +1,213 @@
+#include "VulkanGpuProfiler.h"
+#include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
+
+#include <array>
+#include <chrono>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+void VulkanGpuClockCalibration::Init(const VkInstance& instance, const VkPhysicalDevice& gpu,
+	const VkDevice& device, bool bExtensionEnabled)
+{
+	if (!bExtensionEnabled)
+	{
+		return;
+	}
+
+	/*
+	The host clock that std::chrono::steady_clock uses is the query performance counter
+	on windows and the monotonic clock on linux, one of them should be calibrateable
+	*/
+	#if defined(_WIN32)
+		hostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+	#else
+		hostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+	#endif
+
+	auto pfnGetTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+	pfnGetCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(
+		vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT"));
+	if (!pfnGetTimeDomains || !pfnGetCalibratedTimestamps)
+	{
+		return;
+	}
+
+	uint32_t timeDomainCount = 0;
+	pfnGetTimeDomains(gpu, &timeDomainCount, nullptr);
+	std::vector<VkTimeDomainEXT> timeDomains(timeDomainCount);
+	pfnGetTimeDomains(gpu, &timeDomainCount, timeDomains.data());
+
+	//Both the device and the host domain are needed to place gpu timestamps on the cpu timeline
+	bool bDeviceDomain = false;
+	bool bHostDomain = false;
+	for (VkTimeDomainEXT timeDomain : timeDomains)
+	{
+		bDeviceDomain = bDeviceDomain || timeDomain == VK_TIME_DOMAIN_DEVICE_EXT;
+		bHostDomain = bHostDomain || timeDomain == hostTimeDomain;
+	}
+	bSupported = bDeviceDomain && bHostDomain;
+
+	Calibrate(device);
+}
+
+void VulkanGpuClockCalibration::Calibrate(const VkDevice& device)
+{
+	if (!bSupported)
+	{
+		return;
+	}
+
+	std::array<VkCalibratedTimestampInfoEXT, 2> timestampInfos{};
+	timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+	timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+	timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+	timestampInfos[1].timeDomain = hostTimeDomain;
+
+	std::array<uint64_t, 2> timestamps{};
+	uint64_t maxDeviation = 0;
+	if (pfnGetCalibratedTimestamps(device, static_cast<uint32_t>(timestampInfos.size()),
+		timestampInfos.data(), timestamps.data(), &maxDeviation) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	gpuTimestamp = timestamps[0];
+
+	//The host timestamp is turned to nanoseconds, so that it matches std::chrono::steady_clock
+	#if defined(_WIN32)
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		cpuTime = static_cast<double>(timestamps[1]) * 1000000000.0 /
+			static_cast<double>(frequency.QuadPart);
+	#else
+		cpuTime = static_cast<double>(timestamps[1]);
+	#endif
+
+	bCalibrated = true;
+}
+
+double VulkanGpuClockCalibration::GpuTimestampToCpuTime(uint64_t timestamp,
+	float timestampPeriod) const
+{
+	//The difference is signed, since the timestamp might come before the calibration
+	double ticksSinceCalibration = static_cast<double>(static_cast<int64_t>(timestamp - gpuTimestamp));
+	return (cpuTime + ticksSinceCalibration * timestampPeriod) / 1000000.0;
+}
+
+
+
+
+
+void VulkanGpuProfiler::Init(const VkDevice& device, uint32_t timestampValidBits)
+{
+	zoneNames.reserve(BLITZEN_VULKAN_GPU_PROFILER_MAX_ZONES);
+	zoneTimings.reserve(BLITZEN_VULKAN_GPU_PROFILER_MAX_ZONES);
+
+	//Without a query pool all the other functions do nothing
+	if (timestampValidBits == 0)
+	{
+		return;
+	}
+	timestampMask = timestampValidBits >= 64 ? UINT64_MAX : (uint64_t(1) << timestampValidBits) - 1;
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	VulkanSDKobjects::QueryPoolCreateInfoInit(queryPoolInfo, VK_QUERY_TYPE_TIMESTAMP,
+		BLITZEN_VULKAN_GPU_PROFILER_MAX_ZONES * 2);
+	vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool);
+}
+
+void VulkanGpuProfiler::Cleanup(const VkDevice& device)
+{
+	vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+}
+
+void VulkanGpuProfiler::BeginFrame(const VkCommandBuffer& commandBuffer)
+{
+	zoneNames.clear();
+	bResultsPending = false;
+
+	if (timestampQueryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0,
+		BLITZEN_VULKAN_GPU_PROFILER_MAX_ZONES * 2);
+}
+
+uint32_t VulkanGpuProfiler::BeginZone(const VkCommandBuffer& commandBuffer,
+	const char* zoneName, VkPipelineStageFlags2 stage /* =VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT */)
+{
+	//Zones after the limit are ignored, EndZone will recognize the invalid index
+	if (timestampQueryPool == VK_NULL_HANDLE ||
+		zoneNames.size() >= BLITZEN_VULKAN_GPU_PROFILER_MAX_ZONES)
+	{
+		return UINT32_MAX;
+	}
+
+	uint32_t zoneIndex = static_cast<uint32_t>(zoneNames.size());
+	zoneNames.push_back(zoneName);
+	vkCmdWriteTimestamp2(commandBuffer, stage, timestampQueryPool, zoneIndex * 2);
+	return zoneIndex;
+}
+
+void VulkanGpuProfiler::EndZone(const VkCommandBuffer& commandBuffer, uint32_t zoneIndex,
+	VkPipelineStageFlags2 stage /* =VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT */)
+{
+	if (zoneIndex >= zoneNames.size())
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp2(commandBuffer, stage, timestampQueryPool, zoneIndex * 2 + 1);
+	bResultsPending = true;
+}
+
+bool VulkanGpuProfiler::ReadResults(const VkDevice& device, float timestampPeriod,
+	const VulkanGpuClockCalibration& calibration)
+{
+	if (!bResultsPending)
+	{
+		return false;
+	}
+
+	/*
+	The results are requested without waiting. This is called after the gpu is done with the frame,
+	so they should be available, but if they are not the previous results are kept instead of stalling
+	*/
+	uint32_t queryCount = static_cast<uint32_t>(zoneNames.size()) * 2;
+	std::array<uint64_t, BLITZEN_VULKAN_GPU_PROFILER_MAX_ZONES * 2> timestamps{};
+	if (vkGetQueryPoolResults(device, timestampQueryPool, 0, queryCount,
+		sizeof(uint64_t) * queryCount, timestamps.data(), sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	zoneTimings.resize(zoneNames.size());
+	for (size_t i = 0; i < zoneNames.size(); ++i)
+	{
+		//The bits above the valid ones are undefined, and the difference wraps with the counter
+		uint64_t start = timestamps[i * 2] & timestampMask;
+		uint64_t end = timestamps[i * 2 + 1] & timestampMask;
+
+		VulkanGpuZoneTiming& timing = zoneTimings[i];
+		timing.name = zoneNames[i];
+		timing.gpuTime = static_cast<double>((end - start) & timestampMask) * timestampPeriod / 1000000.0;
+		if (calibration.bCalibrated)
+		{
+			timing.cpuTimelineStart = calibration.GpuTimestampToCpuTime(start, timestampPeriod);
+			timing.cpuTimelineEnd = calibration.GpuTimestampToCpuTime(end, timestampPeriod);
+		}
+	}
+
+	bResultsPending = false;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+//The gpu profiler is a standalone class, it only needs the Vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+
+
+
+//The most zones that one frame can write, each zone uses two timestamp queries
+#define BLITZEN_VULKAN_GPU_PROFILER_MAX_ZONES					32
+
+//How many frames are drawn before the gpu and cpu clocks are calibrated again, to keep their drift small
+#define BLITZEN_VULKAN_GPU_PROFILER_CALIBRATION_INTERVAL		240
+
+
+
+
+//The gpu timing of one of the zones that were written during a frame
+struct VulkanGpuZoneTiming
+{
+	const char* name = nullptr;
+
+	//Time between the two timestamps of the zone in milliseconds
+	double gpuTime = 0.0;
+
+	/*
+	Start and end of the zone on the cpu timeline, in milliseconds of std::chrono::steady_clock.
+	These are only valid when the clocks have been calibrated
+	*/
+	double cpuTimelineStart = 0.0;
+	double cpuTimelineEnd = 0.0;
+};
+
+
+/*--------------------------------------------------------------------
+Holds a matching pair of gpu timestamp and cpu time, taken at the same
+moment with VK_EXT_calibrated_timestamps. It is used to place gpu
+timestamps on the same timeline as the cpu
+---------------------------------------------------------------------*/
+struct VulkanGpuClockCalibration
+{
+	//Loads the extension functions and checks that the host clock can be calibrated against
+	void Init(const VkInstance& instance, const VkPhysicalDevice& gpu,
+		const VkDevice& device, bool bExtensionEnabled);
+
+	//Takes a new pair of timestamps, does nothing if calibration is not supported
+	void Calibrate(const VkDevice& device);
+
+	//Converts a gpu timestamp to milliseconds of std::chrono::steady_clock
+	double GpuTimestampToCpuTime(uint64_t timestamp, float timestampPeriod) const;
+
+	bool bSupported = false;
+	bool bCalibrated = false;
+
+	PFN_vkGetCalibratedTimestampsEXT pfnGetCalibratedTimestamps = nullptr;
+	VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+
+	uint64_t gpuTimestamp = 0;
+	//Time of the calibration in nanoseconds of std::chrono::steady_clock
+	double cpuTime = 0.0;
+};
+
+
+/*-------------------------------------------------------------------------------
+Each frame in flight owns one of these. Zones are written around passes while the
+frame's command buffer is recorded, and the results are read after the gpu is
+done with the frame, so reading them never stalls the cpu
+---------------------------------------------------------------------------------*/
+class VulkanGpuProfiler
+{
+public:
+
+	//The valid bits of the graphics queue's timestamps, 0 when the queue does not support them
+	void Init(const VkDevice& device, uint32_t timestampValidBits);
+
+	//Uses a manual cleanup function instead of the destructor since it needs the device
+	void Cleanup(const VkDevice& device);
+
+	//Resets the query pool, called at the start of the frame's command buffer
+	void BeginFrame(const VkCommandBuffer& commandBuffer);
+
+	//Writes the first timestamp of a zone and returns the index that EndZone expects
+	uint32_t BeginZone(const VkCommandBuffer& commandBuffer, const char* zoneName,
+		VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+	//Writes the second timestamp of the zone
+	void EndZone(const VkCommandBuffer& commandBuffer, uint32_t zoneIndex,
+		VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+	/*
+	Reads the timestamps of the last frame that was recorded with this profiler
+	into zoneTimings. Returns false if there were no new results available
+	*/
+	bool ReadResults(const VkDevice& device, float timestampPeriod,
+		const VulkanGpuClockCalibration& calibration);
+
+public:
+
+	//The results of the last ReadResults call
+	std::vector<VulkanGpuZoneTiming> zoneTimings;
+
+private:
+
+	VkQueryPool timestampQueryPool{ VK_NULL_HANDLE };
+
+	//Keeps the bits of a timestamp that the queue writes, so that a difference across a wrap is still right
+	uint64_t timestampMask = UINT64_MAX;
+
+	//The names of the zones written in the frame that is being recorded or executed
+	std::vector<const char*> zoneNames;
+
+	//Set when a frame has written zones that have not been read yet
+	bool bResultsPending = false;
+};
\ No newline at end of file
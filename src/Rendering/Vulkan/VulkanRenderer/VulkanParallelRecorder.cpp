@@ -0,0 +1,112 @@
+#include "VulkanParallelRecorder.h"
+#include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
+
+#include <algorithm>
+
+#include "Engine/Profiling/CpuProfiler.h"
+
+void VulkanParallelRecorder::Init(const VkDevice& newDevice, uint32_t graphicsQueueFamilyIndex,
+	uint32_t framesInFlight, uint32_t requestedSliceCount)
+{
+	device = newDevice;
+
+	uint32_t jobThreadCount = BlitzenEngine::JobSystem::GetThreadCount();
+	sliceCount = requestedSliceCount ? requestedSliceCount : jobThreadCount;
+	sliceCount = std::min(std::max(sliceCount, 1u),
+		static_cast<uint32_t>(BLITZEN_VULKAN_MAX_RECORDING_THREADS));
+
+	//The pools are reset as a whole every frame, so their command buffers do not need to be reset one by one
+	VkCommandPoolCreateInfo commandPoolInfo{};
+	VulkanSDKobjects::CommandPoolCreateInfoInit(commandPoolInfo, graphicsQueueFamilyIndex,
+		VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+	//Any job thread might pick up a slice, so each of them gets pools
+	threadFrameTools.resize(jobThreadCount);
+	for (std::vector<ThreadFrameTools>& frames : threadFrameTools)
+	{
+		frames.resize(framesInFlight);
+		for (ThreadFrameTools& frameTools : frames)
+		{
+			vkCreateCommandPool(device, &commandPoolInfo, nullptr, &(frameTools.commandPool));
+		}
+	}
+}
+
+void VulkanParallelRecorder::Cleanup()
+{
+	//Destroying each command pool also frees its command buffers
+	for (std::vector<ThreadFrameTools>& frames : threadFrameTools)
+	{
+		for (ThreadFrameTools& frameTools : frames)
+		{
+			vkDestroyCommandPool(device, frameTools.commandPool, nullptr);
+		}
+	}
+	threadFrameTools.clear();
+}
+
+void VulkanParallelRecorder::BeginFrame(uint32_t frameIndex)
+{
+	currentFrame = frameIndex;
+
+	for (std::vector<ThreadFrameTools>& frames : threadFrameTools)
+	{
+		vkResetCommandPool(device, frames[currentFrame].commandPool, 0);
+		frames[currentFrame].usedCommandBufferCount = 0;
+	}
+}
+
+void VulkanParallelRecorder::RecordSecondaries(
+	const VkCommandBufferInheritanceRenderingInfo* pRenderingInfo,
+	const std::function<void(uint32_t, VkCommandBuffer)>& recordSlice,
+	std::vector<VkCommandBuffer>& secondaries)
+{
+	//Each slice writes its own element, so no lock is needed
+	secondaries.resize(sliceCount);
+	BlitzenEngine::JobSystem::ParallelFor(sliceCount, 1,
+		[&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				secondaries[i] = RecordSlice(i, pRenderingInfo, recordSlice);
+			}
+		});
+}
+
+VkCommandBuffer VulkanParallelRecorder::RecordSlice(uint32_t sliceIndex,
+	const VkCommandBufferInheritanceRenderingInfo* pRenderingInfo,
+	const std::function<void(uint32_t, VkCommandBuffer)>& recordSlice)
+{
+	BLITZEN_CPU_PROFILER_ZONE("RecordSecondarySlice");
+
+	ThreadFrameTools& frameTools = threadFrameTools[
+		BlitzenEngine::JobSystem::GetThreadIndex()][currentFrame];
+	if (frameTools.usedCommandBufferCount == frameTools.commandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo commandBufferInfo{};
+		VulkanSDKobjects::CommandBufferAllocInfoInit(commandBufferInfo, frameTools.commandPool,
+			VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+		vkAllocateCommandBuffers(device, &commandBufferInfo, &commandBuffer);
+		frameTools.commandBuffers.push_back(commandBuffer);
+	}
+	VkCommandBuffer commandBuffer = frameTools.commandBuffers[frameTools.usedCommandBufferCount++];
+
+	//Secondaries that continue dynamic rendering need to know the formats of its attachments
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.pNext = pRenderingInfo;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	VulkanSDKobjects::CommandBufferBeginInfoInit(beginInfo,
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | (pRenderingInfo ?
+		VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : 0));
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	recordSlice(sliceIndex, commandBuffer);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	return commandBuffer;
+}
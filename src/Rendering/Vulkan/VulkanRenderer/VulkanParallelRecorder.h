@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+//The parallel recorder only needs the Vulkan headers and the job system
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "Engine/Jobs/JobSystem.h"
+
+
+
+
+//The most slices that secondary command buffers are recorded for
+#define BLITZEN_VULKAN_MAX_RECORDING_THREADS		8
+
+
+
+
+/*-----------------------------------------------------------------------------------
+Records secondary command buffers on the threads of the job system at the same time.
+Each job thread has its own command pool for every frame in flight, so no pool is ever 
+used by two threads and a frame's pools can be reset at once when the gpu is done with
+the frame. A thread that records more than one slice takes another command buffer from
+its pool, so the slices do not need to be tied to threads
+-------------------------------------------------------------------------------------*/
+class VulkanParallelRecorder
+{
+public:
+
+	//A slice count of 0 uses one slice for each thread of the job system, which needs to be initialized first
+	void Init(const VkDevice& device, uint32_t graphicsQueueFamilyIndex,
+		uint32_t framesInFlight, uint32_t requestedSliceCount);
+
+	//Uses a manual cleanup function instead of the destructor since it needs the device
+	void Cleanup();
+
+	//Resets every thread's command pool of the frame, called after the gpu is done with the frame
+	void BeginFrame(uint32_t frameIndex);
+
+	/*
+	Records one secondary command buffer for each slice, by calling recordSlice with the slice
+	index and the command buffer, which has already been begun. The secondaries continue the
+	dynamic rendering described by pRenderingInfo, or are used outside rendering if it is null.
+	Returns after every slice has been recorded, with the command buffers in slice order
+	*/
+	void RecordSecondaries(const VkCommandBufferInheritanceRenderingInfo* pRenderingInfo,
+		const std::function<void(uint32_t, VkCommandBuffer)>& recordSlice,
+		std::vector<VkCommandBuffer>& secondaries);
+
+	inline uint32_t GetSliceCount() const { return sliceCount; }
+
+private:
+
+	//The command objects that one thread uses for one frame in flight
+	struct ThreadFrameTools
+	{
+		VkCommandPool commandPool{ VK_NULL_HANDLE };
+
+		//Allocated when a frame needs more than before, reused after the pool is reset
+		std::vector<VkCommandBuffer> commandBuffers;
+		uint32_t usedCommandBufferCount = 0;
+	};
+
+	//Records a slice on the calling job thread, with a command buffer from that thread's pool
+	VkCommandBuffer RecordSlice(uint32_t sliceIndex,
+		const VkCommandBufferInheritanceRenderingInfo* pRenderingInfo,
+		const std::function<void(uint32_t, VkCommandBuffer)>& recordSlice);
+
+private:
+
+	VkDevice device{ VK_NULL_HANDLE };
+
+	uint32_t sliceCount = 1;
+	uint32_t currentFrame = 0;
+
+	//Indexed by job thread and then by frame in flight
+	std::vector<std::vector<ThreadFrameTools>> threadFrameTools;
+};
@@ -2,8 +2,9 @@
 #include "VulkanShaderData.h"
 #include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
 
-void VulkanGraphicsPipeline::InitBasicGeometryPipeline(const VkDevice& device, 
-	VkFormat* pColorAttachmentFormats)
+bool VulkanGraphicsPipeline::InitBasicGeometryPipeline(const VkDevice& device, 
+	VkFormat* pColorAttachmentFormats, VkFormat depthFormat, const VulkanShaderLibrary& shaderLibrary,
+	const VkPipelineCache& pipelineCache)
 {
 	/*-----------------------------------------------------------------
 	This pipeline will use push constants to access the model matrix 
@@ -22,7 +23,13 @@ void VulkanGraphicsPipeline::InitBasicGeometryPipeline(const VkDevice& device,
 
 	//Gets the shader code, wraps it in shader modules and creates the shader stages
 	std::array<VkShaderModule, 2> shaderModules{};
-	SimpleGeometryShaderStagesInit(shaderModules, device);
+	if (!SimpleGeometryShaderStagesInit(shaderModules, device, shaderLibrary))
+	{
+		//Destroying a null module does nothing, so whichever one was created is destroyed
+		vkDestroyShaderModule(device, shaderModules[0], nullptr);
+		vkDestroyShaderModule(device, shaderModules[1], nullptr);
+		return false;
+	}
 
 	//Initializing the vertex input state, it will not be used with this pipeline
 	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -46,8 +53,9 @@ void VulkanGraphicsPipeline::InitBasicGeometryPipeline(const VkDevice& device,
 
 	VulkanSDKobjects::PipelineMultisampleStateCreateInfoInit(multisampling, VK_SAMPLE_COUNT_1_BIT);
 
-	//We do not want a depth test for this pipeline
-	VulkanSDKobjects::PipelineDepthStencilStateCreateInfoSetDepthTest(depthStencil);
+	//Closer fragments pass, the depth buffer is cleared to 1 and its contents build the depth pyramid
+	VulkanSDKobjects::PipelineDepthStencilStateCreateInfoSetDepthTest(depthStencil,
+		VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
 	//We do not want a depth bounds test for this pipeline
 	VulkanSDKobjects::PipelineDepthStencilStateCreateInfoSetDepthBoundsTest(depthStencil);
 	//We do not want a stencil test for this pipeline
@@ -62,16 +70,38 @@ void VulkanGraphicsPipeline::InitBasicGeometryPipeline(const VkDevice& device,
 	VulkanSDKobjects::PipelineDynamicStateCreateInfoInit(dynamicState, dynamicStates.data(), 2);
 
 	//Creating the rendering info for dynamic rendering when we bind the pipeline
+	depthAttachmentFormat = depthFormat;
 	VulkanSDKobjects::PipelineRenderingCreateInfoInit(renderingInfo, pColorAttachmentFormats,
 		depthAttachmentFormat, stencilAttachmentFormat);
 	colorAttachmentFormat = *pColorAttachmentFormats;
 
 	//Create the pipeline
-	BuildPipeline(device);
+	VkResult pipelineResult = BuildPipeline(device, pipelineCache, graphicsPipeline);
 
 	//With the pipeline created, the shader modules are no longer needed
 	vkDestroyShaderModule(device, shaderModules[0], nullptr);
 	vkDestroyShaderModule(device, shaderModules[1], nullptr);
+
+	return pipelineResult == VK_SUCCESS;
+}
+
+bool VulkanGraphicsPipeline::RebuildBasicGeometryPipeline(const VkDevice& device,
+	const VulkanShaderLibrary& shaderLibrary, const VkPipelineCache& pipelineCache, VkPipeline& newPipeline)
+{
+	//Only the shader stages change, the rest of the state was kept from InitBasicGeometryPipeline
+	std::array<VkShaderModule, 2> shaderModules{};
+	bool bStagesCreated = SimpleGeometryShaderStagesInit(shaderModules, device, shaderLibrary);
+
+	VkResult pipelineResult = VK_ERROR_INITIALIZATION_FAILED;
+	if (bStagesCreated)
+	{
+		pipelineResult = BuildPipeline(device, pipelineCache, newPipeline);
+	}
+
+	vkDestroyShaderModule(device, shaderModules[0], nullptr);
+	vkDestroyShaderModule(device, shaderModules[1], nullptr);
+
+	return pipelineResult == VK_SUCCESS;
 }
 
 
@@ -80,7 +110,8 @@ void VulkanGraphicsPipeline::InitBasicGeometryPipeline(const VkDevice& device,
 
 
 
-void VulkanGraphicsPipeline::BuildPipeline(const VkDevice& device)
+VkResult VulkanGraphicsPipeline::BuildPipeline(const VkDevice& device,
+	const VkPipelineCache& pipelineCache, VkPipeline& pipeline)
 {
 	VkGraphicsPipelineCreateInfo info{};
 
@@ -107,7 +138,7 @@ void VulkanGraphicsPipeline::BuildPipeline(const VkDevice& device)
 	info.pColorBlendState = &colorBlending;
 	info.pDynamicState = &dynamicState;
 
-	vkCreateGraphicsPipelines(device, nullptr, 1, &info, nullptr, &graphicsPipeline);
+	return vkCreateGraphicsPipelines(device, pipelineCache, 1, &info, nullptr, &pipeline);
 }
 
 
@@ -117,50 +148,27 @@ void VulkanGraphicsPipeline::BuildPipeline(const VkDevice& device)
 
 
 
-void VulkanGraphicsPipeline::ReadShaderFile(const char* filepath,
-	std::vector<char>& code)
+bool VulkanGraphicsPipeline::SimpleGeometryShaderStagesInit(
+	std::array<VkShaderModule, 2>& shaderModules, const VkDevice& device, 
+	const VulkanShaderLibrary& shaderLibrary)
 {
-	// open the file. With cursor at the end
-	std::ifstream file(filepath, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open())
+	if (shaderLibrary.CreateShaderModule(device, SIMPLE_GEOMETRY_VERTEX_SHADER, 
+		shaderModules[0]) != VK_SUCCESS)
 	{
-		__debugbreak();
+		return false;
 	}
-
-
-	size_t filesize = static_cast<size_t>(file.tellg());
-
-	code.resize(filesize);
-
-	// put file cursor at beginning
-	file.seekg(0);
-
-	// load the entire file into the buffer
-	file.read(code.data(), filesize);
-
-	file.close();
-}
-
-
-void VulkanGraphicsPipeline::SimpleGeometryShaderStagesInit(
-	std::array<VkShaderModule, 2>& shaderModules, const VkDevice& device)
-{
-	std::vector<char> vertCode;
-	ReadShaderFile(SIMPLE_GEOMETRY_VERTEX_SHADER, vertCode);
-	VkShaderModuleCreateInfo vertShaderModule{};
-	VulkanSDKobjects::ShaderModuleCreateInfoInit(vertShaderModule, vertCode);
-	vkCreateShaderModule(device, &vertShaderModule, nullptr, &shaderModules[0]);
 	VulkanSDKobjects::PipelineShaderStageInit(shaderStages[0], shaderModules[0],
 		VK_SHADER_STAGE_VERTEX_BIT);
 
-	std::vector<char> fragCode;
-	ReadShaderFile(SIMPLE_GEOMETRY_FRAGMENT_SHADER, fragCode);
-	VkShaderModuleCreateInfo fragShaderModule{};
-	VulkanSDKobjects::ShaderModuleCreateInfoInit(fragShaderModule, fragCode);
-	vkCreateShaderModule(device, &fragShaderModule, nullptr, &shaderModules[1]);
+	if (shaderLibrary.CreateShaderModule(device, SIMPLE_GEOMETRY_FRAGMENT_SHADER, 
+		shaderModules[1]) != VK_SUCCESS)
+	{
+		return false;
+	}
 	VulkanSDKobjects::PipelineShaderStageInit(shaderStages[1], shaderModules[1],
 		VK_SHADER_STAGE_FRAGMENT_BIT);
+
+	return true;
 }
 
 
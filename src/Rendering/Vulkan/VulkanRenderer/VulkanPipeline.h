@@ -2,11 +2,9 @@
 
 #include <array>
 #include <vector>
-#include <fstream>
 
-//The VulkanGraphicsPipeline is a standalone class, it only needs the Vulkan headers
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
+//The VulkanGraphicsPipeline is a standalone class, it only needs the Vulkan headers and the shader library
+#include "VulkanShaderLibrary.h"
 
 
 
@@ -20,12 +18,12 @@ class VulkanGraphicsPipeline
 {
 private:
 
-	/*------------------------------------
-	Macros for vulkan shader filepaths
-	-------------------------------------*/
+	/*------------------------------------------
+	Names of the shaders in the shader library
+	-------------------------------------------*/
 
-	#define SIMPLE_GEOMETRY_VERTEX_SHADER		"VulkanShaders/SimpleGeometry.vert.glsl.spv"
-	#define SIMPLE_GEOMETRY_FRAGMENT_SHADER		"VulkanShaders/SimpleGeometry.frag.glsl.spv"
+	#define SIMPLE_GEOMETRY_VERTEX_SHADER		"SimpleGeometry.vert.glsl"
+	#define SIMPLE_GEOMETRY_FRAGMENT_SHADER		"SimpleGeometry.frag.glsl"
 
 public:
 
@@ -33,7 +31,7 @@ public:
 	void Cleanup(const VkDevice& device);
 
 	//This is called at the end of each pipeline init function to actually build the pipeline
-	void BuildPipeline(const VkDevice& device);
+	VkResult BuildPipeline(const VkDevice& device, const VkPipelineCache& pipelineCache, VkPipeline& pipeline);
 
 	/*---------------------------------------------------------------------
 	In the public section, all functions that are called for primary
@@ -41,8 +39,20 @@ public:
 	engine are declared
 	-----------------------------------------------------------------------*/
 
-	//Creates a very simple pipeline used only to create simple geometry
-	void InitBasicGeometryPipeline(const VkDevice& device, VkFormat* pColorAttachmentFormats);
+	/*
+	Creates a very simple pipeline used only to create simple geometry, with a depth test against the depth format.
+	Returns false if its shaders are not in the library or the pipeline could not be created
+	*/
+	bool InitBasicGeometryPipeline(const VkDevice& device, VkFormat* pColorAttachmentFormats,
+		VkFormat depthFormat, const VulkanShaderLibrary& shaderLibrary, 
+		const VkPipelineCache& pipelineCache);
+
+	/*
+	Creates another basic geometry pipeline with the state and layout of this one, after its shaders were 
+	reloaded. The graphics pipeline is not changed, the caller replaces it with the new one
+	*/
+	bool RebuildBasicGeometryPipeline(const VkDevice& device, const VulkanShaderLibrary& shaderLibrary,
+		const VkPipelineCache& pipelineCache, VkPipeline& newPipeline);
 
 private:
 
@@ -52,12 +62,9 @@ private:
 	usually control different setups for some pipeline configuration structs
 	--------------------------------------------------------------------------*/
 
-	//Reads a shader file in byte format so that it can be used to create a shader module 
-	void ReadShaderFile(const char* filePath, std::vector<char>& code);
-
-	//Initializes an array of shader modules using code from the simple geometry shaders
-	void SimpleGeometryShaderStagesInit(std::array<VkShaderModule, 2>& shaderModules, 
-		const VkDevice& device);
+	//Initializes an array of shader modules using code from the simple geometry shaders, false if one is missing
+	bool SimpleGeometryShaderStagesInit(std::array<VkShaderModule, 2>& shaderModules, 
+		const VkDevice& device, const VulkanShaderLibrary& shaderLibrary);
 
 
 
@@ -0,0 +1,159 @@
+#include "VulkanPipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "Engine/Profiling/CpuProfiler.h"
+
+static uint64_t HashCacheData(const std::vector<char>& data)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char byte : data)
+	{
+		hash ^= static_cast<uint8_t>(byte);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void VulkanPipelineCache::Init(const VkDevice& newDevice, const VkPhysicalDevice& physicalDevice,
+	const char* cacheFilepath)
+{
+	BLITZEN_CPU_PROFILER_ZONE("VulkanPipelineCache::Init");
+
+	device = newDevice;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	filepath = cacheFilepath ? cacheFilepath : "";
+
+	std::vector<char> initialData;
+	bLoadedFromFile = !filepath.empty() && ReadCacheFile(initialData);
+	loadedDataSize = bLoadedFromFile ? initialData.size() : 0;
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = loadedDataSize;
+	cacheInfo.pInitialData = bLoadedFromFile ? initialData.data() : nullptr;
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS && bLoadedFromFile)
+	{
+		//The driver rejected the data after all, so the cache starts empty
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache);
+		bLoadedFromFile = false;
+		loadedDataSize = 0;
+	}
+}
+
+void VulkanPipelineCache::Cleanup()
+{
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+	pipelineCache = VK_NULL_HANDLE;
+}
+
+bool VulkanPipelineCache::Save()
+{
+	BLITZEN_CPU_PROFILER_ZONE("VulkanPipelineCache::Save");
+
+	if (filepath.empty() || pipelineCache == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || !dataSize)
+	{
+		return false;
+	}
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		return false;
+	}
+	data.resize(dataSize);
+
+	VulkanPipelineCacheFileHeader header{};
+	FillFileHeader(header, data);
+
+	std::string temporaryFilepath = filepath + ".tmp";
+	{
+		std::ofstream file(temporaryFilepath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+		if (!file.good())
+		{
+			file.close();
+			std::remove(temporaryFilepath.c_str());
+			return false;
+		}
+	}
+
+	//Renaming over an existing file fails on some platforms, so the old one is removed first
+	std::remove(filepath.c_str());
+	return std::rename(temporaryFilepath.c_str(), filepath.c_str()) == 0;
+}
+
+bool VulkanPipelineCache::ReadCacheFile(std::vector<char>& data)
+{
+	std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(VulkanPipelineCacheFileHeader))
+	{
+		return false;
+	}
+	file.seekg(0);
+
+	VulkanPipelineCacheFileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (header.magic != BLITZEN_VULKAN_PIPELINE_CACHE_FILE_MAGIC ||
+		header.fileVersion != BLITZEN_VULKAN_PIPELINE_CACHE_FILE_VERSION ||
+		header.vendorID != deviceProperties.vendorID ||
+		header.deviceID != deviceProperties.deviceID ||
+		header.driverVersion != deviceProperties.driverVersion ||
+		memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) ||
+		header.dataSize != fileSize - sizeof(header))
+	{
+		return false;
+	}
+
+	data.resize(static_cast<size_t>(header.dataSize));
+	file.read(data.data(), data.size());
+	if (!file.good() || HashCacheData(data) != header.dataHash)
+	{
+		return false;
+	}
+
+	//The driver's own header at the start of the data has to agree with the device as well
+	VkPipelineCacheHeaderVersionOne driverHeader{};
+	if (data.size() < sizeof(driverHeader))
+	{
+		return false;
+	}
+	memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+	return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		driverHeader.vendorID == deviceProperties.vendorID &&
+		driverHeader.deviceID == deviceProperties.deviceID &&
+		!memcmp(driverHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+void VulkanPipelineCache::FillFileHeader(VulkanPipelineCacheFileHeader& header,
+	const std::vector<char>& data)
+{
+	header.magic = BLITZEN_VULKAN_PIPELINE_CACHE_FILE_MAGIC;
+	header.fileVersion = BLITZEN_VULKAN_PIPELINE_CACHE_FILE_VERSION;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = data.size();
+	header.dataHash = HashCacheData(data);
+}
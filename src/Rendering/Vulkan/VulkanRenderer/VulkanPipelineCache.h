@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+//The pipeline cache is a standalone class, it only needs the Vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+
+
+
+//Where the renderer keeps the pipeline cache between runs, unless its settings give another file
+#define BLITZEN_VULKAN_PIPELINE_CACHE_DEFAULT_FILEPATH		"BlitzenPipelineCache.bin"
+
+//Written at the start of the file, so that files of other programs and formats are never loaded
+#define BLITZEN_VULKAN_PIPELINE_CACHE_FILE_MAGIC			0x43504C42u
+//Needs to change whenever the layout of VulkanPipelineCacheFileHeader changes
+#define BLITZEN_VULKAN_PIPELINE_CACHE_FILE_VERSION			1u
+
+
+
+
+/*-----------------------------------------------------------------------------
+Written in front of the data that vkGetPipelineCacheData returns. The driver
+checks its own header too, but it does not know the driver version, and some
+drivers crash on cache data that is corrupt, so the file is only given to the
+driver when everything here matches the device and the data's hash is right
+------------------------------------------------------------------------------*/
+struct VulkanPipelineCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t fileVersion;
+
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+
+	uint64_t dataSize;
+	//FNV-1a of the data, catches files that were cut short or damaged
+	uint64_t dataHash;
+};
+
+
+/*-----------------------------------------------------------------------------------
+Holds the VkPipelineCache that every pipeline is created with. It is seeded from a file
+that an earlier run wrote for the same device and driver, so that pipelines that were
+compiled before are not compiled again. The file is written back by Save, which the
+renderer calls at shutdown, and which can be called at any other time
+-------------------------------------------------------------------------------------*/
+class VulkanPipelineCache
+{
+public:
+
+	/*
+	Creates the cache. If filepath is not null and holds a valid cache for this device,
+	the cache starts with its data. A file that does not match is ignored and replaced on Save
+	*/
+	void Init(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const char* filepath);
+
+	//Uses a manual cleanup function instead of the destructor since it needs the device
+	void Cleanup();
+
+	/*
+	Writes the cache data to the file. It is written to a temporary file first, so a run
+	that stops in the middle of writing never leaves a broken cache behind
+	*/
+	bool Save();
+
+	inline VkPipelineCache GetCache() const { return pipelineCache; }
+
+	//True if the cache was seeded from the file
+	inline bool WasLoadedFromFile() const { return bLoadedFromFile; }
+	inline size_t GetLoadedDataSize() const { return loadedDataSize; }
+
+private:
+
+	//Reads the file and checks it against the device, returns false if it can not be used
+	bool ReadCacheFile(std::vector<char>& data);
+
+	void FillFileHeader(VulkanPipelineCacheFileHeader& header, const std::vector<char>& data);
+
+private:
+
+	VkDevice device{ VK_NULL_HANDLE };
+
+	VkPipelineCache pipelineCache{ VK_NULL_HANDLE };
+
+	VkPhysicalDeviceProperties deviceProperties{};
+
+	//Empty if the cache is not kept between runs
+	std::string filepath;
+
+	bool bLoadedFromFile = false;
+	size_t loadedDataSize = 0;
+};
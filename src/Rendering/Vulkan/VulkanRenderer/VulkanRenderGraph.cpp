@@ -0,0 +1,373 @@
+#include "VulkanRenderGraph.h"
+
+#include <algorithm>
+
+void VulkanRenderGraph::Reset()
+{
+	passCount = 0;
+	resourceCount = 0;
+	executionOrder.clear();
+	zones.clear();
+	culledPassCount = 0;
+	asyncComputePassCount = 0;
+}
+
+uint32_t VulkanRenderGraph::ImportImage(const char* name, const VkImage& image, VkImageAspectFlags aspectMask,
+	VulkanResourceState* pState, bool bOutput /* =false */, VkImageLayout finalLayout /* =VK_IMAGE_LAYOUT_UNDEFINED */)
+{
+	if (resourceCount == resources.size())
+	{
+		resources.emplace_back();
+	}
+
+	VulkanRenderGraphResource& resource = resources[resourceCount];
+	resource.name = name;
+	resource.image = image;
+	resource.buffer = VK_NULL_HANDLE;
+	resource.aspectMask = aspectMask;
+	resource.pState = pState;
+	resource.bOutput = bOutput;
+	resource.finalLayout = finalLayout;
+	resource.finalStageMask = VK_PIPELINE_STAGE_2_NONE;
+	resource.finalAccessMask = VK_ACCESS_2_NONE;
+
+	return resourceCount++;
+}
+
+uint32_t VulkanRenderGraph::ImportBuffer(const char* name, const VkBuffer& buffer, VulkanResourceState* pState,
+	bool bOutput /* =false */, VkPipelineStageFlags2 finalStageMask /* =VK_PIPELINE_STAGE_2_NONE */,
+	VkAccessFlags2 finalAccessMask /* =VK_ACCESS_2_NONE */)
+{
+	uint32_t resource = ImportImage(name, VK_NULL_HANDLE, 0, pState, bOutput);
+	resources[resource].buffer = buffer;
+	resources[resource].finalStageMask = finalStageMask;
+	resources[resource].finalAccessMask = finalAccessMask;
+	return resource;
+}
+
+uint32_t VulkanRenderGraph::AddPass(const char* name, VulkanRenderGraphQueue queue,
+	std::function<void(const VkCommandBuffer&)> record, bool bSideEffects /* =false */)
+{
+	if (passCount == passes.size())
+	{
+		passes.emplace_back();
+	}
+
+	VulkanRenderGraphPass& pass = passes[passCount];
+	pass.name = name;
+	pass.queue = queue;
+	pass.record = std::move(record);
+	pass.uses.clear();
+	pass.bSideEffects = bSideEffects;
+	pass.bCulled = false;
+	pass.bAsyncComputeCandidate = false;
+
+	return passCount++;
+}
+
+void VulkanRenderGraph::AddProfilerZone(const char* name, uint32_t lastPass)
+{
+	VulkanRenderGraphZone zone;
+	zone.name = name;
+	zone.lastPass = lastPass;
+	zones.push_back(zone);
+}
+
+void VulkanRenderGraph::ReadImage(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+	VkAccessFlags2 accessMask, VkImageLayout layout)
+{
+	AddUse(pass, resource, stageMask, accessMask, layout, false, false);
+}
+
+void VulkanRenderGraph::WriteImage(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+	VkAccessFlags2 accessMask, VkImageLayout layout, bool bDiscard /* =false */)
+{
+	AddUse(pass, resource, stageMask, accessMask, layout, true, bDiscard);
+}
+
+void VulkanRenderGraph::ReadBuffer(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+	VkAccessFlags2 accessMask)
+{
+	AddUse(pass, resource, stageMask, accessMask, VK_IMAGE_LAYOUT_UNDEFINED, false, false);
+}
+
+void VulkanRenderGraph::WriteBuffer(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+	VkAccessFlags2 accessMask, bool bDiscard /* =false */)
+{
+	AddUse(pass, resource, stageMask, accessMask, VK_IMAGE_LAYOUT_UNDEFINED, true, bDiscard);
+}
+
+void VulkanRenderGraph::AddUse(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+	VkAccessFlags2 accessMask, VkImageLayout layout, bool bWrite, bool bDiscard)
+{
+	VulkanRenderGraphUse use;
+	use.resource = resource;
+	use.stageMask = stageMask;
+	use.accessMask = accessMask;
+	use.layout = layout;
+	use.bWrite = bWrite;
+	use.bDiscard = bDiscard;
+	passes[pass].uses.push_back(use);
+}
+
+void VulkanRenderGraph::Compile()
+{
+	CullPasses();
+	FindDependencies();
+	OrderPasses();
+}
+
+void VulkanRenderGraph::CullPasses()
+{
+	resourceNeeded.assign(resourceCount, 0);
+	for (uint32_t i = 0; i < resourceCount; ++i)
+	{
+		resourceNeeded[i] = resources[i].bOutput;
+	}
+
+	culledPassCount = 0;
+	for (uint32_t i = passCount; i-- > 0;)
+	{
+		VulkanRenderGraphPass& pass = passes[i];
+
+		bool bNeeded = pass.bSideEffects;
+		for (const VulkanRenderGraphUse& use : pass.uses)
+		{
+			bNeeded = bNeeded || (use.bWrite && resourceNeeded[use.resource]);
+		}
+
+		if (!bNeeded)
+		{
+			pass.bCulled = true;
+			++culledPassCount;
+			continue;
+		}
+
+		//The passes before a discard write contents that nobody reads, unless this pass or an earlier one reads them
+		for (const VulkanRenderGraphUse& use : pass.uses)
+		{
+			if (use.bDiscard)
+			{
+				resourceNeeded[use.resource] = 0;
+			}
+		}
+		for (const VulkanRenderGraphUse& use : pass.uses)
+		{
+			if (!use.bDiscard)
+			{
+				resourceNeeded[use.resource] = 1;
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::FindDependencies()
+{
+	for (uint32_t i = 0; i < resourceCount; ++i)
+	{
+		resources[i].lastWriter = UINT32_MAX;
+		resources[i].readers.clear();
+	}
+
+	asyncComputePassCount = 0;
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		VulkanRenderGraphPass& pass = passes[i];
+		pass.dependencies.clear();
+		pass.bWaitsForOtherQueue = false;
+		if (pass.bCulled)
+		{
+			continue;
+		}
+
+		for (const VulkanRenderGraphUse& use : pass.uses)
+		{
+			VulkanRenderGraphResource& resource = resources[use.resource];
+
+			//Every use waits for the last write. A write also waits for the reads since then, which must not see it
+			if (resource.lastWriter != UINT32_MAX && resource.lastWriter != i)
+			{
+				AddDependency(pass, resource.lastWriter);
+			}
+
+			if (use.bWrite)
+			{
+				for (uint32_t reader : resource.readers)
+				{
+					if (reader != i)
+					{
+						AddDependency(pass, reader);
+					}
+				}
+				resource.readers.clear();
+				resource.lastWriter = i;
+			}
+			else
+			{
+				resource.readers.push_back(i);
+			}
+		}
+
+		//The passes were added in a correct order, so every dependency has already been marked
+		for (uint32_t dependency : pass.dependencies)
+		{
+			const VulkanRenderGraphPass& dependencyPass = passes[dependency];
+			pass.bWaitsForOtherQueue = pass.bWaitsForOtherQueue || dependencyPass.bWaitsForOtherQueue ||
+				dependencyPass.queue != VulkanRenderGraphQueue::Compute;
+		}
+
+		pass.bAsyncComputeCandidate = pass.queue == VulkanRenderGraphQueue::Compute && !pass.bWaitsForOtherQueue;
+		if (pass.bAsyncComputeCandidate)
+		{
+			++asyncComputePassCount;
+		}
+	}
+}
+
+void VulkanRenderGraph::OrderPasses()
+{
+	executionOrder.clear();
+	pendingDependencyCounts.assign(passCount, 0);
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		pendingDependencyCounts[i] = static_cast<uint32_t>(passes[i].dependencies.size());
+	}
+
+	uint32_t scheduledCount = passCount - culledPassCount;
+	uint32_t lastPass = UINT32_MAX;
+	while (executionOrder.size() < scheduledCount)
+	{
+		/*
+		The first ready pass that does not wait for the last one, or the first ready pass if they all do.
+		Passes that were added earlier go first, so passes that share nothing keep the order they were added in
+		*/
+		uint32_t nextPass = UINT32_MAX;
+		for (uint32_t i = 0; i < passCount; ++i)
+		{
+			if (passes[i].bCulled || pendingDependencyCounts[i] != 0)
+			{
+				continue;
+			}
+
+			const std::vector<uint32_t>& dependencies = passes[i].dependencies;
+			bool bWaitsForLastPass = std::find(dependencies.begin(), dependencies.end(), lastPass) != dependencies.end();
+			if (!bWaitsForLastPass)
+			{
+				nextPass = i;
+				break;
+			}
+			if (nextPass == UINT32_MAX)
+			{
+				nextPass = i;
+			}
+		}
+
+		//The dependencies only point to passes that were added earlier, so there is always a ready pass
+		executionOrder.push_back(nextPass);
+		lastPass = nextPass;
+
+		//Scheduled passes are kept out of the search with a count that never reaches 0 again
+		pendingDependencyCounts[nextPass] = UINT32_MAX;
+		for (uint32_t i = nextPass + 1; i < passCount; ++i)
+		{
+			const std::vector<uint32_t>& dependencies = passes[i].dependencies;
+			if (std::find(dependencies.begin(), dependencies.end(), nextPass) != dependencies.end())
+			{
+				--pendingDependencyCounts[i];
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::AddDependency(VulkanRenderGraphPass& pass, uint32_t dependency)
+{
+	if (std::find(pass.dependencies.begin(), pass.dependencies.end(), dependency) == pass.dependencies.end())
+	{
+		pass.dependencies.push_back(dependency);
+	}
+}
+
+void VulkanRenderGraph::Execute(const VkCommandBuffer& commandBuffer, VulkanResourceStateTracker& tracker,
+	VulkanGpuProfiler* pProfiler /* =nullptr */)
+{
+	if (pProfiler)
+	{
+		for (VulkanRenderGraphZone& zone : zones)
+		{
+			zone.profilerZone = pProfiler->BeginZone(commandBuffer, zone.name);
+			zone.bEnded = false;
+		}
+	}
+
+	for (uint32_t passIndex : executionOrder)
+	{
+		VulkanRenderGraphPass& pass = passes[passIndex];
+
+		for (const VulkanRenderGraphUse& use : pass.uses)
+		{
+			VulkanRenderGraphResource& resource = resources[use.resource];
+			if (!resource.pState)
+			{
+				continue;
+			}
+
+			if (resource.image != VK_NULL_HANDLE)
+			{
+				tracker.UseImage(resource.image, resource.aspectMask, *resource.pState,
+					use.stageMask, use.accessMask, use.layout, use.bDiscard);
+			}
+			else
+			{
+				tracker.UseBuffer(resource.buffer, *resource.pState, use.stageMask, use.accessMask);
+			}
+		}
+		tracker.FlushBarriers(commandBuffer);
+
+		uint32_t zone = pProfiler ? pProfiler->BeginZone(commandBuffer, pass.name) : 0;
+		pass.record(commandBuffer);
+		if (pProfiler)
+		{
+			pProfiler->EndZone(commandBuffer, zone);
+			EndProfilerZones(commandBuffer, *pProfiler, passIndex);
+		}
+	}
+
+	if (pProfiler)
+	{
+		EndProfilerZones(commandBuffer, *pProfiler, UINT32_MAX);
+	}
+
+	//Nothing in this frame reads the outputs again. The submission's semaphores make them visible to later gpu work, the host needs a barrier
+	for (uint32_t i = 0; i < resourceCount; ++i)
+	{
+		VulkanRenderGraphResource& resource = resources[i];
+		if (!resource.bOutput || !resource.pState)
+		{
+			continue;
+		}
+
+		if (resource.image != VK_NULL_HANDLE && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			tracker.UseImage(resource.image, resource.aspectMask, *resource.pState,
+				VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, resource.finalLayout);
+		}
+		else if (resource.buffer != VK_NULL_HANDLE && resource.finalAccessMask != VK_ACCESS_2_NONE)
+		{
+			tracker.UseBuffer(resource.buffer, *resource.pState, resource.finalStageMask, resource.finalAccessMask);
+		}
+	}
+	tracker.FlushBarriers(commandBuffer);
+}
+
+void VulkanRenderGraph::EndProfilerZones(const VkCommandBuffer& commandBuffer, VulkanGpuProfiler& profiler,
+	uint32_t recordedPass)
+{
+	for (VulkanRenderGraphZone& zone : zones)
+	{
+		if (!zone.bEnded && (recordedPass == UINT32_MAX || zone.lastPass == recordedPass))
+		{
+			profiler.EndZone(commandBuffer, zone.profilerZone);
+			zone.bEnded = true;
+		}
+	}
+}
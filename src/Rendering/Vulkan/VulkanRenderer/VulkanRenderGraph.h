@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+#include "VulkanResourceStateTracker.h"
+#include "VulkanGpuProfiler.h"
+
+
+
+
+//The queue that a pass is written for. Every pass is recorded to the frame's command buffer, the queue only says what it needs
+enum class VulkanRenderGraphQueue : uint8_t
+{
+	Graphics = 0,
+	Compute = 1,
+	Transfer = 2
+};
+
+//A profiler zone that starts before the first pass and ends after one of them, around the passes recorded in between
+struct VulkanRenderGraphZone
+{
+	const char* name = nullptr;
+	uint32_t lastPass = 0;
+
+	//Used while executing
+	uint32_t profilerZone = 0;
+	bool bEnded = false;
+};
+
+//An image or buffer that was created outside of the graph and that the passes of a frame use
+struct VulkanRenderGraphResource
+{
+	const char* name = nullptr;
+
+	//One of the two is set
+	VkImage image = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkImageAspectFlags aspectMask = 0;
+
+	//Null for a resource that synchronizes itself, the graph then only orders and culls the passes that use it
+	VulkanResourceState* pState = nullptr;
+
+	//Something after the frame reads an output, so the passes that write it are never culled
+	bool bOutput = false;
+
+	//The layout that an output image is left in after the last pass, undefined leaves it in the last one that was used
+	VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	//What reads an output buffer after the frame, like the host, which needs a barrier to see the writes. None adds no barrier
+	VkPipelineStageFlags2 finalStageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 finalAccessMask = VK_ACCESS_2_NONE;
+
+	//Used while compiling, the last pass that wrote the resource and the passes that read it since
+	uint32_t lastWriter = UINT32_MAX;
+	std::vector<uint32_t> readers;
+};
+
+//How one pass uses one resource
+struct VulkanRenderGraphUse
+{
+	uint32_t resource = 0;
+
+	VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+
+	//Buffers stay undefined
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	bool bWrite = false;
+
+	//The pass writes over all of the contents that later passes read, so the ones from before it are not needed
+	bool bDiscard = false;
+};
+
+struct VulkanRenderGraphPass
+{
+	const char* name = nullptr;
+	VulkanRenderGraphQueue queue = VulkanRenderGraphQueue::Graphics;
+
+	//Records the commands of the pass, the graph has recorded its barriers before it is called
+	std::function<void(const VkCommandBuffer&)> record;
+
+	std::vector<VulkanRenderGraphUse> uses;
+
+	//A pass with side effects outside of its resources is never culled
+	bool bSideEffects = false;
+
+	//Set by Compile
+	bool bCulled = false;
+	bool bAsyncComputeCandidate = false;
+
+	//Used while compiling, the passes that have to run before this one and whether one of them is not a compute pass
+	std::vector<uint32_t> dependencies;
+	bool bWaitsForOtherQueue = false;
+};
+
+
+/*-------------------------------------------------------------------------------------
+Records the passes of a frame from how they use their images and buffers, instead of
+from a sequence of barriers kept by hand. Each frame imports the resources, adds the
+passes and declares what they read and write, in an order that would be correct if the
+passes ran as they were added. Compile then:
+
+- Culls the passes that write nothing an output or a pass after them needs. A pass
+  that discards a resource ends the need for the contents that were written before it.
+- Orders the passes that are left. Any order that keeps reads after writes, and writes
+  after earlier reads and writes, is correct, so the graph picks a ready pass that does
+  not depend on the one before it when there is one. The barrier before a pass then has
+  work between it and the pass it waits for.
+- Marks the compute passes that wait for no graphics or transfer pass of the frame,
+  directly or through other passes. Those could go to an async compute queue.
+
+Execute declares each pass's uses to the resource state tracker and flushes them before
+the pass, so the barriers and the layout transitions come from the declarations alone.
+The passes and resources keep their vectors between frames, so building the graph again
+every frame does not allocate once it has grown to the frame's size
+---------------------------------------------------------------------------------------*/
+class VulkanRenderGraph
+{
+public:
+
+	//Forgets the passes and the resources of the last frame
+	void Reset();
+
+	//Returns the handle that the passes use the image with
+	uint32_t ImportImage(const char* name, const VkImage& image, VkImageAspectFlags aspectMask,
+		VulkanResourceState* pState, bool bOutput = false, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	uint32_t ImportBuffer(const char* name, const VkBuffer& buffer, VulkanResourceState* pState,
+		bool bOutput = false, VkPipelineStageFlags2 finalStageMask = VK_PIPELINE_STAGE_2_NONE,
+		VkAccessFlags2 finalAccessMask = VK_ACCESS_2_NONE);
+
+	//Returns the handle that the uses of the pass are declared with
+	uint32_t AddPass(const char* name, VulkanRenderGraphQueue queue,
+		std::function<void(const VkCommandBuffer&)> record, bool bSideEffects = false);
+
+	/*
+	Declares how a pass uses a resource. A write that also reads what was there, like a color attachment
+	that is loaded, is declared as a write with the read access. Each resource is declared once for each pass
+	*/
+	void ReadImage(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+		VkAccessFlags2 accessMask, VkImageLayout layout);
+	void WriteImage(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+		VkAccessFlags2 accessMask, VkImageLayout layout, bool bDiscard = false);
+	void ReadBuffer(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask);
+	void WriteBuffer(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+		VkAccessFlags2 accessMask, bool bDiscard = false);
+
+	/*
+	Adds a profiler zone from the start of the graph until the pass was recorded, before the barriers of the 
+	passes after it. A culled last pass ends the zone after every pass
+	*/
+	void AddProfilerZone(const char* name, uint32_t lastPass);
+
+	//Culls, orders and marks the passes, called after every pass was added
+	void Compile();
+
+	/*
+	Records the passes in the compiled order, each after its barriers and inside of a profiler zone with its name
+	when there is a profiler. At the end, the output images with a final layout are transitioned to it,
+	and the output buffers with a final access are made visible to it
+	*/
+	void Execute(const VkCommandBuffer& commandBuffer, VulkanResourceStateTracker& tracker,
+		VulkanGpuProfiler* pProfiler = nullptr);
+
+	inline uint32_t GetPassCount() const { return passCount; }
+	inline const VulkanRenderGraphPass& GetPass(uint32_t pass) const { return passes[pass]; }
+
+	//The passes that Execute records, in the order that it records them
+	inline const std::vector<uint32_t>& GetExecutionOrder() const { return executionOrder; }
+
+	inline uint32_t GetCulledPassCount() const { return culledPassCount; }
+	inline uint32_t GetAsyncComputePassCount() const { return asyncComputePassCount; }
+
+private:
+
+	void AddUse(uint32_t pass, uint32_t resource, VkPipelineStageFlags2 stageMask,
+		VkAccessFlags2 accessMask, VkImageLayout layout, bool bWrite, bool bDiscard);
+
+	//Walks back from the outputs and culls the passes that nothing needs
+	void CullPasses();
+
+	//Finds what each pass that is left waits for, in the order they were added
+	void FindDependencies();
+
+	void OrderPasses();
+
+	static void AddDependency(VulkanRenderGraphPass& pass, uint32_t dependency);
+
+	//Ends the zones whose last pass was just recorded, or every zone that is still open for UINT32_MAX
+	void EndProfilerZones(const VkCommandBuffer& commandBuffer, VulkanGpuProfiler& profiler, uint32_t recordedPass);
+
+private:
+
+	//Only the first counts are used by this frame, the rest are kept for their vectors
+	std::vector<VulkanRenderGraphPass> passes;
+	uint32_t passCount = 0;
+	std::vector<VulkanRenderGraphResource> resources;
+	uint32_t resourceCount = 0;
+
+	std::vector<uint32_t> executionOrder;
+
+	std::vector<VulkanRenderGraphZone> zones;
+
+	//Scratch for compiling
+	std::vector<uint8_t> resourceNeeded;
+	std::vector<uint32_t> pendingDependencyCounts;
+
+	uint32_t culledPassCount = 0;
+	uint32_t asyncComputePassCount = 0;
+};
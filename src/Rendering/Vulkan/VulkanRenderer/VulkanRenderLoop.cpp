@@ -1,9 +1,12 @@
 #include "VulkanRenderer.h"
 #include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
 
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
 void VulkanRenderer::RecordFrameCommandBuffer(
-	const VkCommandBuffer& commandBuffer, uint32_t swapchainImageIndex, 
-	VkImage& drawingImage)
+	const VkCommandBuffer& commandBuffer, uint32_t swapchainImageIndex)
 {
 	//For a command buffer to record commands, it needs to be reset
 	vkResetCommandBuffer(commandBuffer, 0);
@@ -13,35 +16,204 @@ void VulkanRenderer::RecordFrameCommandBuffer(
 	VulkanSDKobjects::CommandBufferBeginInfoInit(commandBufferBeginInfo);
 	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
 
-	//Transitioning the image layout so that vkCmdClearValue can write to it
-	TransitionImageLayoutWhileDrawing(commandBuffer, drawingImage, 
-		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-	//Drawing the background
-	DrawBackground(commandBuffer, drawingImage);
+	//Takes ownership of buffers that were uploaded since the last frame, the submission waits for their copies
+	frameUploadWaitValue = uploadManager.RecordPendingAcquires(commandBuffer);
 
-	DrawGeometry(commandBuffer);
+	//The last frame that used this camera buffer is done, so it can be written for this one
+	UpdateCameraBuffer();
 
-	//Changing the drawing image layout to transfer source and the swapchain's to transfer dst
-	TransitionImageLayoutWhileDrawing(commandBuffer, drawingImage,
-		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-	TransitionImageLayoutWhileDrawing(commandBuffer, 
-		windowInterface.swapchainImages[swapchainImageIndex],
-		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	//The results of the previous use of this profiler were read, so its queries can be reset and written again
+	VulkanGpuProfiler& gpuProfiler = frameTools[frameQueue].gpuProfiler;
+	gpuProfiler.BeginFrame(commandBuffer);
+	uint32_t frameZone = gpuProfiler.BeginZone(commandBuffer, "Frame",
+		VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
 
-	CopyImageToImage(commandBuffer, drawingImage, windowInterface.
-		swapchainImages[swapchainImageIndex], drawExtent,
-		windowInterface.swapchainExtent);
+	//The passes declare what they use, the graph records their barriers and transitions in between
+	{
+		BLITZEN_CPU_PROFILER_ZONE("BuildFrameGraph");
+		BuildFrameGraph(swapchainImageIndex);
+		frameGraph.Compile();
+	}
+	frameGraph.Execute(commandBuffer, resourceTracker, &gpuProfiler);
 
-	//Transitioning the image layout so that it can be presented to the swapchain
-	TransitionImageLayoutWhileDrawing(commandBuffer,
-		windowInterface.swapchainImages[swapchainImageIndex],
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	gpuProfiler.EndZone(commandBuffer, frameZone, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
 
 	//The command buffer has recorded all commands, so it should not record anymore
 	vkEndCommandBuffer(commandBuffer);
 }
 
+void VulkanRenderer::BuildFrameGraph(uint32_t swapchainImageIndex)
+{
+	frameGraph.Reset();
+
+	/*
+	A headless renderer keeps the results in the drawing image. It is left as a transfer source,
+	so that it can be copied or read back after the frame. With a window, the swapchain image is the 
+	output and it is left ready to be presented, the render finished semaphore waits for the transition
+	*/
+	bool bHeadless = rendererSettings.bHeadless;
+	uint32_t drawing = frameGraph.ImportImage("DrawingImage", drawingImage.image, VK_IMAGE_ASPECT_COLOR_BIT,
+		&drawingImage.state, bHeadless, bHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED);
+	uint32_t depth = frameGraph.ImportImage("DepthImage", depthImage.image, VK_IMAGE_ASPECT_DEPTH_BIT,
+		&depthImage.state);
+
+	/*
+	The pyramid's state starts undefined whenever it is created, so the first pass that binds it transitions 
+	it to the general layout. The build places its own barriers between the levels
+	*/
+	uint32_t pyramid = frameGraph.ImportImage("DepthPyramid", depthPyramid.GetImage(), VK_IMAGE_ASPECT_COLOR_BIT,
+		&depthPyramid.GetState());
+
+	uint32_t transforms = frameGraph.ImportBuffer("TransformBuffer", indirectDrawData.transformBuffer.buffer,
+		&indirectDrawData.transformBufferState);
+	uint32_t drawCommands = frameGraph.ImportBuffer("IndirectDrawBuffer", indirectDrawData.indirectDrawBuffer.buffer,
+		&indirectDrawData.indirectDrawBufferState);
+	uint32_t drawCounts = frameGraph.ImportBuffer("DrawCountBuffer", indirectDrawData.drawCountBuffer.buffer,
+		&indirectDrawData.drawCountBufferState);
+
+	//The next frame's early phase reads the visibility that the late phase writes
+	uint32_t visibility = frameGraph.ImportBuffer("VisibilityBuffer", indirectDrawData.visibilityBuffer.buffer,
+		&indirectDrawData.visibilityBufferState, true);
+
+	/*
+	The cpu reads the counts after the frame's fence. The fence does not make the copies visible to the host,
+	so the buffer ends the frame with a barrier to host reads. The last frame that used it was read before this
+	one is recorded, so its state starts again
+	*/
+	VulkanFrameTools& currentFrameTools = frameTools[frameQueue];
+	VulkanResourceStateTracker::ResetState(currentFrameTools.cullingStatsReadbackBufferState, VK_PIPELINE_STAGE_2_NONE);
+	uint32_t cullingStats = frameGraph.ImportBuffer("CullingStatsReadbackBuffer",
+		currentFrameTools.cullingStatsReadbackBuffer.buffer, &currentFrameTools.cullingStatsReadbackBufferState, true,
+		VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+	if (bTransformsPending)
+	{
+		/*
+		The frames that are still in flight read the transform buffer in culling and in the vertex shader.
+		Culling makes the copy visible to itself and the geometry passes to the vertex shader
+		*/
+		uint32_t pass = frameGraph.AddPass("CopyTransforms", VulkanRenderGraphQueue::Transfer,
+			[this](const VkCommandBuffer& commandBuffer) { RecordTransformCopy(commandBuffer); });
+		frameGraph.WriteBuffer(pass, transforms, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	}
+
+	//The background covers the whole draw extent, so the last frame's contents are discarded
+	{
+		uint32_t pass = frameGraph.AddPass("DrawBackground", VulkanRenderGraphQueue::Compute,
+			[this](const VkCommandBuffer& commandBuffer) { DrawBackground(commandBuffer); });
+		frameGraph.WriteImage(pass, drawing, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true);
+	}
+
+	//Each phase clears the counts, culls into them and copies them out, then draws with what culling wrote
+	auto addCullingPasses = [&](VulkanCullingPhase phase, const char* clearName, const char* cullName,
+		const char* copyName, const char* drawName)
+	{
+		uint32_t clearPass = frameGraph.AddPass(clearName, VulkanRenderGraphQueue::Transfer,
+			[this](const VkCommandBuffer& commandBuffer) { ClearDrawCounts(commandBuffer); });
+		frameGraph.WriteBuffer(clearPass, drawCounts, VK_PIPELINE_STAGE_2_CLEAR_BIT, 
+			VK_ACCESS_2_TRANSFER_WRITE_BIT, true);
+
+		/*
+		The compute shader adds to the counts that were just cleared and writes the commands that the previous
+		phase drew with. The visibility written by the last late phase has to be visible to this one
+		*/
+		uint32_t cullPass = frameGraph.AddPass(cullName, VulkanRenderGraphQueue::Compute,
+			[this, phase](const VkCommandBuffer& commandBuffer) { CullDrawRecords(commandBuffer, phase); });
+		frameGraph.WriteBuffer(cullPass, drawCounts, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		frameGraph.WriteBuffer(cullPass, drawCommands, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, true);
+		frameGraph.WriteBuffer(cullPass, visibility, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		frameGraph.ReadBuffer(cullPass, transforms, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+		/*
+		Both phases bind the pyramid with its sampled descriptor, which is written with the general layout.
+		Only the late phase samples it, the early one binds the last frame's pyramid
+		*/
+		frameGraph.ReadImage(cullPass, pyramid, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+
+		//Each phase has its own slots in the readback buffer
+		uint32_t copyPass = frameGraph.AddPass(copyName, VulkanRenderGraphQueue::Transfer,
+			[this, phase](const VkCommandBuffer& commandBuffer) { CopyCullingStats(commandBuffer, phase); });
+		frameGraph.ReadBuffer(copyPass, drawCounts, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+		frameGraph.WriteBuffer(copyPass, cullingStats, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+		/*
+		The draw call reads the commands and the counts that culling wrote, the vertex shader the commands and the 
+		transforms. The color attachment is loaded, and the early pass discards the depth of the last frame, 
+		since it clears it
+		*/
+		bool bClearDepth = phase == VulkanCullingPhase::Early;
+		uint32_t drawPass = frameGraph.AddPass(drawName, VulkanRenderGraphQueue::Graphics,
+			[this, bClearDepth](const VkCommandBuffer& commandBuffer) { DrawGeometry(commandBuffer, bClearDepth); });
+		frameGraph.ReadBuffer(drawPass, drawCommands, 
+			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+		frameGraph.ReadBuffer(drawPass, drawCounts, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+		frameGraph.ReadBuffer(drawPass, transforms, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+		frameGraph.WriteImage(drawPass, drawing, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		frameGraph.WriteImage(drawPass, depth,
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, bClearDepth);
+
+		return drawPass;
+	};
+
+	//Draws the objects that were visible in the last frame
+	addCullingPasses(VulkanCullingPhase::Early, "ClearDrawCountsEarly", "CullDrawRecordsEarly",
+		"CopyCullingStatsEarly", "DrawGeometryEarly");
+
+	//The depth of the early pass becomes the occluders that the late phase tests against
+	{
+		uint32_t pass = frameGraph.AddPass("BuildDepthPyramid", VulkanRenderGraphQueue::Compute,
+			[this](const VkCommandBuffer& commandBuffer) { depthPyramid.Build(commandBuffer); });
+		frameGraph.ReadImage(pass, depth, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		frameGraph.WriteImage(pass, pyramid, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true);
+	}
+
+	//Draws the objects that became visible this frame
+	uint32_t lateDrawPass = addCullingPasses(VulkanCullingPhase::Late, "ClearDrawCountsLate", 
+		"CullDrawRecordsLate", "CopyCullingStatsLate", "DrawGeometryLate");
+
+	/*
+	The resolution scaler times the frame until the geometry is drawn. The copy to the swapchain waits for
+	the acquire, so under fifo the rest of the frame also measures how long the display held the image
+	*/
+	frameGraph.AddProfilerZone(BLITZEN_VULKAN_RESOLUTION_SCALE_ZONE, lateDrawPass);
+
+	if (bHeadless)
+	{
+		return;
+	}
+
+	//The submission waits for the acquire in the blit stage, so the swapchain image's barrier starts there
+	VkImage& swapchainImage = windowInterface.swapchainImages[swapchainImageIndex];
+	VulkanResourceStateTracker::ResetState(swapchainImageState, VK_PIPELINE_STAGE_2_BLIT_BIT);
+	uint32_t swapchain = frameGraph.ImportImage("SwapchainImage", swapchainImage, VK_IMAGE_ASPECT_COLOR_BIT,
+		&swapchainImageState, true, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	uint32_t pass = frameGraph.AddPass("CopyImageToImage", VulkanRenderGraphQueue::Graphics,
+		[this, &swapchainImage](const VkCommandBuffer& commandBuffer)
+		{
+			CopyImageToImage(commandBuffer, drawingImage.image, swapchainImage, drawExtent,
+				windowInterface.swapchainExtent);
+		});
+	frameGraph.ReadImage(pass, drawing, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	frameGraph.WriteImage(pass, swapchain, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true);
+}
+
 void VulkanRenderer::TransitionImageLayoutWhileDrawing(const VkCommandBuffer& commandBuffer,
 	VkImage& currentImage, VkImageLayout initialLayout, VkImageLayout finalLayout)
 {
@@ -52,9 +224,9 @@ void VulkanRenderer::TransitionImageLayoutWhileDrawing(const VkCommandBuffer& co
 	imageMemoryBarrier.newLayout = finalLayout;
 	imageMemoryBarrier.image = currentImage;
 
-	//The barrier will stop all pipeline commands, even thought this is not optimal
+	//The barrier will stop all pipeline commands, which is fine outside of the frame
 	imageMemoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-	imageMemoryBarrier.dstAccessMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	imageMemoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 
 	imageMemoryBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
 	imageMemoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT |
@@ -64,6 +236,7 @@ void VulkanRenderer::TransitionImageLayoutWhileDrawing(const VkCommandBuffer& co
 	VkImageAspectFlags subresourceRangeAspectMask = 
 		/*Depending on the type of transitions requested, 
 		the barrier will access the appropriate aspect*/(finalLayout ==
+		VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || initialLayout == 
 		VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? 
 		VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
 	VkImageSubresourceRange subresourceRange{};
@@ -81,11 +254,15 @@ void VulkanRenderer::TransitionImageLayoutWhileDrawing(const VkCommandBuffer& co
 	vkCmdPipelineBarrier2(commandBuffer, &barrierDependency);
 }
 
-void VulkanRenderer::DrawBackground(const VkCommandBuffer& commandBuffer,
-	VkImage& image)
+void VulkanRenderer::DrawBackground(const VkCommandBuffer& commandBuffer)
 {
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-		gradientComputePipeline.computePipeline);
+	DrawBackground(commandBuffer, gradientComputePipeline.computePipeline, gradientComputePipeline.workgroupSize);
+}
+
+void VulkanRenderer::DrawBackground(const VkCommandBuffer& commandBuffer, const VkPipeline& pipeline,
+	const VulkanWorkgroupSize& workgroupSize)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 
 	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
 		gradientComputePipeline.pipelineLayout, 0, 1, &backgroundDrawingDescriptorSet,
@@ -94,29 +271,170 @@ void VulkanRenderer::DrawBackground(const VkCommandBuffer& commandBuffer,
 	GradientComputePushConstant colorPushConstant;
 	colorPushConstant.data1 = glm::vec4(1, 0, 0, 1);
 	colorPushConstant.data2 = glm::vec4(0, 0, 1, 1);
+	//The drawing image can be larger than the draw extent, so the shader is given the part that is drawn
+	colorPushConstant.data3 = glm::vec4(static_cast<float>(drawExtent.width), 
+		static_cast<float>(drawExtent.height), 0, 0);
 
 	vkCmdPushConstants(commandBuffer, gradientComputePipeline.pipelineLayout,
 		VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GradientComputePushConstant),
 		&colorPushConstant);
 
-	vkCmdDispatch(commandBuffer, std::ceil(drawExtent.width / 16.0), 
-		std::ceil(drawExtent.height / 16.0), 1);
+	vkCmdDispatch(commandBuffer, GetWorkgroupCount(drawExtent.width, workgroupSize.x),
+		GetWorkgroupCount(drawExtent.height, workgroupSize.y), 1);
 }
 
-void VulkanRenderer::DrawGeometry(const VkCommandBuffer& commandBuffer)
+void VulkanRenderer::ClearDrawCounts(const VkCommandBuffer& commandBuffer)
 {
+	vkCmdFillBuffer(commandBuffer, indirectDrawData.drawCountBuffer.buffer, 0, 
+		sizeof(uint32_t) * indirectDrawData.drawSliceCount, 0);
+}
+
+void VulkanRenderer::CullDrawRecords(const VkCommandBuffer& commandBuffer,
+	VulkanCullingPhase phase)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+		drawCullingComputePipeline.computePipeline);
+
+	//Only the late phase samples the pyramid, but the layout always has it
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+		drawCullingComputePipeline.pipelineLayout, 0, 1, 
+		&(depthPyramid.GetSampledDescriptorSet()), 0, nullptr);
+
+	DrawCullingComputePushConstant drawCullingPushConstant;
+	drawCullingPushConstant.meshDrawDataBuffer = indirectDrawData.meshDrawDataBufferAddress;
+	drawCullingPushConstant.drawRecordBuffer = indirectDrawData.drawRecordBufferAddress;
+	drawCullingPushConstant.transformBuffer = indirectDrawData.transformBufferAddress;
+	drawCullingPushConstant.cameraBuffer = frameTools[frameQueue].cameraBufferAddress;
+	drawCullingPushConstant.indirectDrawBuffer = indirectDrawData.indirectDrawBufferAddress;
+	drawCullingPushConstant.drawCountBuffer = indirectDrawData.drawCountBufferAddress;
+	drawCullingPushConstant.visibilityBuffer = indirectDrawData.visibilityBufferAddress;
+	drawCullingPushConstant.drawRecordCount = indirectDrawData.drawRecordCount;
+	drawCullingPushConstant.cullingPhase = static_cast<uint32_t>(phase);
+	drawCullingPushConstant.depthPyramidExtent = glm::vec2(
+		static_cast<float>(depthPyramid.GetExtent().width),
+		static_cast<float>(depthPyramid.GetExtent().height));
+	drawCullingPushConstant.drawSliceSize = indirectDrawData.drawSliceSize;
+	drawCullingPushConstant.padding = 0;
+	vkCmdPushConstants(commandBuffer, drawCullingComputePipeline.pipelineLayout,
+		VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawCullingComputePushConstant),
+		&drawCullingPushConstant);
+
+	/*
+	One invocation for each draw record, all in a single dispatch. When there are more 
+	workgroups than one dimension allows, the rest continue on the second dimension
+	*/
+	uint32_t groupCount = GetWorkgroupCount(indirectDrawData.drawRecordCount,
+		drawCullingComputePipeline.workgroupSize.x);
+	uint32_t groupCountX = std::min(groupCount, BLITZEN_VULKAN_MAX_DISPATCH_GROUPS_X);
+	uint32_t groupCountY = groupCountX ? (groupCount + groupCountX - 1) / groupCountX : 0;
+	vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+}
+
+void VulkanRenderer::CopyCullingStats(const VkCommandBuffer& commandBuffer, VulkanCullingPhase phase)
+{
+	//Each phase has its own slots in the readback buffer
+	VkDeviceSize countsSize = sizeof(uint32_t) * indirectDrawData.drawSliceCount;
+	VkBufferCopy countCopy{};
+	VulkanSDKobjects::BufferCopyInit(countCopy, countsSize, 0,
+		countsSize * static_cast<uint32_t>(phase));
+	vkCmdCopyBuffer(commandBuffer, indirectDrawData.drawCountBuffer.buffer,
+		frameTools[frameQueue].cullingStatsReadbackBuffer.buffer, 1, &countCopy);
+	frameTools[frameQueue].bCullingStatsWritten = true;
+}
+
+void VulkanRenderer::UpdateCameraBuffer()
+{
+	VulkanShaderData::GPUCameraData cameraData;
+	cameraData.viewProjection = viewProjection;
+
+	/*
+	Each plane is a sum or difference of the rows of the matrix (Gribb and Hartmann).
+	Vulkan's clip space has a depth range of 0 to w, so the near plane is the third row alone
+	*/
+	glm::mat4 transposed = glm::transpose(viewProjection);
+	cameraData.frustumPlanes[0] = transposed[3] + transposed[0];
+	cameraData.frustumPlanes[1] = transposed[3] - transposed[0];
+	cameraData.frustumPlanes[2] = transposed[3] + transposed[1];
+	cameraData.frustumPlanes[3] = transposed[3] - transposed[1];
+	cameraData.frustumPlanes[4] = transposed[2];
+	cameraData.frustumPlanes[5] = transposed[3] - transposed[2];
+
+	//Normalized so that the distance of a point to a plane can be compared to a sphere's radius
+	for (glm::vec4& plane : cameraData.frustumPlanes)
+	{
+		float normalLength = glm::length(glm::vec3(plane));
+		if (normalLength > 0.f)
+		{
+			plane /= normalLength;
+		}
+	}
+
+	VulkanShaderData::AllocatedBuffer& cameraBuffer = frameTools[frameQueue].cameraBuffer;
+	memcpy(cameraBuffer.allocationInfo.pMappedData, &cameraData, sizeof(cameraData));
+	vmaFlushAllocation(allocator, cameraBuffer.allocation, 0, VK_WHOLE_SIZE);
+}
+
+void VulkanRenderer::RecordTransformCopy(const VkCommandBuffer& commandBuffer)
+{
+	//The last frame that used this staging buffer is done, so it can be written for this one
+	VulkanShaderData::AllocatedBuffer& stagingBuffer = frameTools[frameQueue].transformStagingBuffer;
+	VkDeviceSize transformsSize = sizeof(glm::mat4) * pendingTransforms.size();
+	memcpy(stagingBuffer.allocationInfo.pMappedData, pendingTransforms.data(), transformsSize);
+	vmaFlushAllocation(allocator, stagingBuffer.allocation, 0, VK_WHOLE_SIZE);
+	bTransformsPending = false;
+
+	VkBufferCopy transformCopy{};
+	transformCopy.size = transformsSize;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, indirectDrawData.transformBuffer.buffer, 
+		1, &transformCopy);
+}
+
+void VulkanRenderer::DrawGeometry(const VkCommandBuffer& commandBuffer, bool bClearDepth)
+{
+	//The secondaries continue a rendering pass with these attachment formats
+	VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{};
+	inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	inheritanceRenderingInfo.colorAttachmentCount = 1;
+	inheritanceRenderingInfo.pColorAttachmentFormats = &drawingImage.format;
+	inheritanceRenderingInfo.depthAttachmentFormat = depthImage.format;
+	inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	//Each thread records the draw of its own slice, while this thread records the first one
+	{
+		BLITZEN_CPU_PROFILER_ZONE("RecordGeometrySecondaries");
+		parallelRecorder.RecordSecondaries(&inheritanceRenderingInfo,
+			[this](uint32_t sliceIndex, VkCommandBuffer secondary)
+			{ DrawGeometrySlice(secondary, sliceIndex); }, geometrySecondaries);
+	}
+
 	//This render pass is going to use a single color attachment
 	VkRenderingAttachmentInfo colorAttachment{};
 	VulkanSDKobjects::RenderingAttachmentInfoInit(colorAttachment, drawingImage.imageView, 
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
-	//Creating the rendering info to start rendering
+	//The depth attachment is cleared to the far plane or loaded with what the early pass drew
+	VkClearValue depthClear{};
+	depthClear.depthStencil.depth = 1.f;
+	VkRenderingAttachmentInfo depthAttachment{};
+	VulkanSDKobjects::RenderingAttachmentInfoInit(depthAttachment, depthImage.imageView,
+		VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, bClearDepth ? &depthClear : nullptr);
+
+	//The contents of the pass come only from the secondaries
 	VkRenderingInfo renderingInfo{};
 	VulkanSDKobjects::RenderingInfoInit(renderingInfo, &colorAttachment,
-		drawExtent, nullptr, nullptr);
+		drawExtent, &depthAttachment, nullptr);
+	renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
 	vkCmdBeginRendering(commandBuffer, &renderingInfo);
 
-	//Binding the pipeline we want to use
+	vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(geometrySecondaries.size()),
+		geometrySecondaries.data());
+
+	vkCmdEndRendering(commandBuffer);
+}
+
+void VulkanRenderer::DrawGeometrySlice(const VkCommandBuffer& commandBuffer, uint32_t sliceIndex)
+{
+	//Secondaries inherit no state from the primary, so every one of them sets its own
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
 		simpleGeometryGraphicsPipeline.graphicsPipeline);
 
@@ -137,20 +455,32 @@ void VulkanRenderer::DrawGeometry(const VkCommandBuffer& commandBuffer)
 	scissor.extent.height = drawExtent.height;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	vkCmdBindIndexBuffer(commandBuffer, meshBuffersList[0].indexBuffer.buffer, 0, 
-		VK_INDEX_TYPE_UINT32);
+	/*
+	All the meshes live in the geometry arena, so the index buffer is bound once. The vertex shader
+	finds the vertices, the object, its transform and the camera through the addresses in the push constants
+	*/
+	vkCmdBindIndexBuffer(commandBuffer, geometryArena.GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+	uint32_t firstCommand = sliceIndex * indirectDrawData.drawSliceSize;
 
 	VulkanShaderData::GPUPushConstants pushConstants;
-	pushConstants.modelMatrix = glm::mat4(1.0f);
-	pushConstants.vertexBuffer = meshBuffersList[0].vertexBufferAddress;
+	pushConstants.vertexBuffer = geometryArena.GetVertexBufferAddress();
+	pushConstants.drawRecordBuffer = indirectDrawData.drawRecordBufferAddress;
+	pushConstants.transformBuffer = indirectDrawData.transformBufferAddress;
+	pushConstants.indirectDrawBuffer = indirectDrawData.indirectDrawBufferAddress;
+	pushConstants.cameraBuffer = frameTools[frameQueue].cameraBufferAddress;
+	pushConstants.drawCommandOffset = firstCommand;
+	pushConstants.padding = 0;
 	vkCmdPushConstants(commandBuffer, simpleGeometryGraphicsPipeline.pipelineLayout,
 		VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VulkanShaderData::GPUPushConstants),
 		&pushConstants);
 
-	//Draw command, draws 3 vertices
-	vkCmdDrawIndexed(commandBuffer, 6, 1, 0, 0, 0);
-
-	vkCmdEndRendering(commandBuffer);
+	//One call draws every command that the compute pass wrote to this slice, the commands start after the record index
+	vkCmdDrawIndexedIndirectCount(commandBuffer, indirectDrawData.indirectDrawBuffer.buffer,
+		sizeof(VulkanShaderData::GPUIndirectDrawCommand) * firstCommand +
+		offsetof(VulkanShaderData::GPUIndirectDrawCommand, command),
+		indirectDrawData.drawCountBuffer.buffer, sizeof(uint32_t) * sliceIndex, 
+		indirectDrawData.drawSliceSize, sizeof(VulkanShaderData::GPUIndirectDrawCommand));
 }
 
 void VulkanRenderer::CopyImageToImage(const VkCommandBuffer& commandBuffer, 
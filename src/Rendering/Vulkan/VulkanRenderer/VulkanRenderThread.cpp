@@ -0,0 +1,117 @@
+#include "VulkanRenderThread.h"
+
+#include "Engine/Profiling/CpuProfiler.h"
+
+VulkanRenderThread::~VulkanRenderThread()
+{
+	Stop();
+}
+
+bool VulkanRenderThread::Start(VulkanRenderer* pNewRenderer,
+	std::function<void(VulkanRenderer&)> newOnFrameDrawn /* =nullptr */)
+{
+	if (renderThread.joinable() || !pNewRenderer)
+	{
+		return false;
+	}
+
+	//Reserved here instead of on the new thread, so that a missing external thread is reported to the caller
+	if (!BlitzenEngine::JobSystem::ReserveExternalThread(jobThreadIndex))
+	{
+		return false;
+	}
+
+	pRenderer = pNewRenderer;
+	onFrameDrawn = std::move(newOnFrameDrawn);
+	bStopRequested.store(false, std::memory_order_relaxed);
+	renderThread = std::thread(&VulkanRenderThread::RenderLoop, this);
+
+	return true;
+}
+
+void VulkanRenderThread::Stop()
+{
+	if (!renderThread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		bStopRequested.store(true, std::memory_order_relaxed);
+	}
+	wakeCondition.notify_one();
+
+	renderThread.join();
+}
+
+void VulkanRenderThread::SubmitPacket()
+{
+	uint32_t lastIndex = sharedIndex.exchange(writeIndex | newPacketBit, std::memory_order_seq_cst);
+	writeIndex = lastIndex & ~newPacketBit;
+	if (lastIndex & newPacketBit)
+	{
+		++droppedPacketCount;
+	}
+
+	//Same as the job system, the flag is set before the render thread checks for a packet, so one of them sees the other
+	if (bRenderThreadSleeping.load(std::memory_order_seq_cst))
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		wakeCondition.notify_one();
+	}
+}
+
+bool VulkanRenderThread::AcquirePacket()
+{
+	if (!(sharedIndex.load(std::memory_order_relaxed) & newPacketBit))
+	{
+		BLITZEN_CPU_PROFILER_ZONE("WaitForPacket");
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		bRenderThreadSleeping.store(true, std::memory_order_seq_cst);
+		wakeCondition.wait(lock, [this]()
+		{
+			return (sharedIndex.load(std::memory_order_seq_cst) & newPacketBit) ||
+				bStopRequested.load(std::memory_order_relaxed);
+		});
+		bRenderThreadSleeping.store(false, std::memory_order_relaxed);
+	}
+
+	if (bStopRequested.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	//Acquire so that the writes of the game thread to the packet are visible here
+	readIndex = sharedIndex.exchange(readIndex, std::memory_order_acq_rel) & ~newPacketBit;
+	return true;
+}
+
+void VulkanRenderThread::RenderLoop()
+{
+	BlitzenEngine::JobSystem::AttachThread(jobThreadIndex);
+	BlitzenEngine::CpuProfiler::SetThreadName("Render");
+
+	while (!bStopRequested.load(std::memory_order_relaxed))
+	{
+		/*
+		The pacer sleeps before the packet is taken, so that the frame is drawn with the newest one.
+		A packet that arrives while the thread waits for the pacer replaces the older one
+		*/
+		pRenderer->WaitForNextFrame();
+
+		if (!AcquirePacket())
+		{
+			break;
+		}
+
+		pRenderer->DrawFrame(packets[readIndex]);
+		drawnPacketCount.fetch_add(1, std::memory_order_relaxed);
+
+		if (onFrameDrawn)
+		{
+			onFrameDrawn(*pRenderer);
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "VulkanRenderer.h"
+
+
+
+
+//One packet the game thread writes, one the render thread draws and one that holds the newest finished packet
+#define BLITZEN_VULKAN_RENDER_PACKET_COUNT			3
+
+
+
+
+/*-------------------------------------------------------------------------------------
+Draws frames on a thread of its own, from render packets that the game thread makes.
+The packets are triple buffered and change hands through one atomic index, so neither
+thread ever waits for the other to finish with a packet. The render thread always draws
+the newest packet, a packet that was replaced before it was drawn is dropped. The game
+thread does not wait for frames or presents, it only takes a lock to wake the render
+thread when that thread ran out of packets and went to sleep
+---------------------------------------------------------------------------------------*/
+class VulkanRenderThread
+{
+public:
+
+	~VulkanRenderThread();
+
+	/*
+	Starts drawing with the renderer, whose pipelines need to be waited for first. The render thread takes one
+	of the job system's external threads, so it can record in parallel. Returns false if none is left.
+	The callback runs on the render thread after every frame, it can read the renderer's stats
+	*/
+	bool Start(VulkanRenderer* pRenderer, std::function<void(VulkanRenderer&)> onFrameDrawn = nullptr);
+
+	//Draws the frame that is being recorded and joins the render thread, the packets that are waiting are dropped
+	void Stop();
+
+	//The packet that the game thread fills next, it keeps what it was last filled with
+	inline VulkanRenderPacket& GetWritePacket() { return packets[writeIndex]; }
+
+	//Hands the write packet to the render thread and gives the game thread another one to fill
+	void SubmitPacket();
+
+	inline uint64_t GetDrawnPacketCount() const { return drawnPacketCount.load(std::memory_order_relaxed); }
+
+	//Packets that the game thread replaced before the render thread could draw them
+	inline uint64_t GetDroppedPacketCount() const { return droppedPacketCount; }
+
+private:
+
+	void RenderLoop();
+
+	//Takes the newest submitted packet, waits for one if there is none. Returns false if the thread should stop
+	bool AcquirePacket();
+
+private:
+
+	VulkanRenderer* pRenderer = nullptr;
+	std::function<void(VulkanRenderer&)> onFrameDrawn;
+
+	std::thread renderThread;
+	uint32_t jobThreadIndex = 0;
+
+	std::array<VulkanRenderPacket, BLITZEN_VULKAN_RENDER_PACKET_COUNT> packets;
+
+	//Owned by the game thread
+	uint32_t writeIndex = 0;
+	//Owned by the render thread
+	uint32_t readIndex = 2;
+
+	/*
+	The index of the packet that is between the threads, with a bit that tells if it was submitted since
+	the render thread last took it. Either thread swaps the packet it owns for this one
+	*/
+	static constexpr uint32_t newPacketBit = 1u << 31;
+	std::atomic<uint32_t> sharedIndex{ 1 };
+
+	std::atomic<bool> bRenderThreadSleeping{ false };
+	std::atomic<bool> bStopRequested{ false };
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+
+	std::atomic<uint64_t> drawnPacketCount{ 0 };
+	uint64_t droppedPacketCount = 0;
+};
@@ -5,6 +5,7 @@
 #include <string>
 #include <fstream>
 #include <thread>
+#include <chrono>
 
 //Includes the vulkan header files as well as glfw and the WindowData struct
 #include "Engine/Inputs/glfwInputs/glfwInputs.h"
@@ -17,27 +18,98 @@
 //Header file that includes different graphics pipeline configurations
 #include "VulkanPipeline.h"
 
+//Timestamp query zones that measure the gpu time of each pass
+#include "VulkanGpuProfiler.h"
+
+//Batches buffer uploads through a persistent staging ring
+#include "VulkanUploadManager.h"
+
+//One vertex and one index buffer that all the meshes are sub-allocated from
+#include "VulkanGeometryArena.h"
+
+//Hi-Z pyramid that the occlusion culling pass tests objects against
+#include "VulkanDepthPyramid.h"
+
+//Worker threads that record the slices of the geometry passes into secondary command buffers
+#include "VulkanParallelRecorder.h"
+
+//Keeps compiled pipelines between runs
+#include "VulkanPipelineCache.h"
+
+//Every compiled shader, mapped from one file
+#include "VulkanShaderLibrary.h"
+
+//Finds the fastest workgroup size of the compute kernels on the device
+#include "VulkanWorkgroupTuner.h"
+
+//Limits the frame rate and waits for presents before the input of a frame is read
+#include "VulkanFramePacer.h"
+
+//Scales the draw extent to keep the gpu time of a frame within a budget
+#include "VulkanResolutionScaler.h"
+
+//Batches the barriers that the passes of a frame need from how they use each resource
+#include "VulkanResourceStateTracker.h"
+
+//Orders and culls the passes of a frame from the resources that they read and write
+#include "VulkanRenderGraph.h"
+
 //Needed to pass meshes to the engine and turn it into shader data 
 #include "Engine/GameObjects/Mesh.h"
 
+//Cpu zones around the setup functions and the stages of DrawFrame
+#include "Engine/Profiling/CpuProfiler.h"
+
+//Compiles the pipelines in parallel during startup
+#include "Engine/Jobs/JobSystem.h"
+
+//Watches the shader sources for hot reload
+#include "Engine/Files/FileWatcher.h"
+
 
 
 
 /*------------------------------------------------------------
 When vulkan is busy drawing a frame, the cpu should move on 
-to process the next frame, but no more than two should be 
-in flight at the same time
+to process the next frame. How many frames can be in flight
+is a renderer setting, up to this many. More of them keep the
+gpu busier, fewer let the input show up on screen sooner
 ---------------------------------------------------------------*/
-#define BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT	2Ui32
+#define BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT		4u
+#define BLITZEN_VULKAN_DEFAULT_FRAMES_IN_FLIGHT	2u
 
+//How long the cpu waits for an earlier frame, a swapchain image or a present before the frame is skipped, in nanoseconds
+#define BLITZEN_VULKAN_FRAME_WAIT_TIMEOUT	1000000000ull
 
 
 
-/*----------------------------------
-Shader filepath macros
------------------------------------*/
-#define BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER_FILEPATH \
-"VulkanShaders/gradient.comp.glsl.spv"
+
+/*------------------------------------------
+Names of the shaders in the shader library
+-------------------------------------------*/
+#define BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER			"gradient.comp.glsl"
+
+//The workgroup size of the gradient on both dimensions, until it is tuned for the device
+#define BLITZEN_VULKAN_GRADIENT_WORKGROUP_SIZE			16
+
+#define BLITZEN_VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER		"DepthPyramid.comp.glsl"
+
+#define BLITZEN_VULKAN_DRAW_CULLING_COMPUTE_SHADER		"CullDrawRecords.comp.glsl"
+
+//The workgroup size of the draw culling shader, given to it as a specialization constant
+#define BLITZEN_VULKAN_DRAW_CULLING_WORKGROUP_SIZE		64
+
+//Most devices allow no more workgroups than this on one dimension, so larger dispatches spill to the second
+#define BLITZEN_VULKAN_MAX_DISPATCH_GROUPS_X			65535u
+
+//How long the shader sources need to stay unchanged before they are reloaded, so that one save is one reload
+#define BLITZEN_VULKAN_SHADER_RELOAD_DELAY_MS			100
+
+//The gpu zone that the resolution scaler keeps within the budget, from the start of the frame until the geometry is drawn
+#define BLITZEN_VULKAN_RESOLUTION_SCALE_ZONE			"ScaledRender"
+
+//How many meshes one job computes the draw data and bounds of during setup
+#define BLITZEN_VULKAN_MESH_DRAW_DATA_JOB_BATCH_SIZE	64
 
 
 
@@ -60,6 +132,21 @@ struct VkBootstrapInitialized
 
 	uint32_t graphicsQueueFamilyIndex;
 	VkQueue graphicsQueue{VK_NULL_HANDLE};
+
+	//Same as the graphics queue if the device has no separate transfer family
+	uint32_t transferQueueFamilyIndex;
+	VkQueue transferQueue{ VK_NULL_HANDLE };
+
+	//Nanoseconds per timestamp tick, used to convert timestamp queries to time
+	float timestampPeriod = 1.f;
+	//False if the graphics queue does not support timestamps
+	bool bTimestampsSupported = false;
+	//How many low bits of a timestamp the graphics queue writes, the counter wraps after them
+	uint32_t timestampValidBits = 0;
+	//Set if VK_EXT_calibrated_timestamps was found and enabled
+	bool bCalibratedTimestampsEnabled = false;
+	//Set if VK_KHR_present_id and VK_KHR_present_wait were found with their features and enabled, never when headless
+	bool bPresentWaitEnabled = false;
 };
 
 //Holds primary vulkan objects that are responsible for window interfacing
@@ -70,9 +157,18 @@ struct VulkanWindowInterfaceObjects
 	VkSwapchainKHR swapchain{ VK_NULL_HANDLE };
 	VkFormat swapchainImageFormat;
 	VkExtent2D swapchainExtent;
+	//The mode that the surface supported, which can be a fallback of the one in the settings
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
 	std::vector<VkImage> swapchainImages{ 0 };
 	std::vector<VkImageView> swapchainImageViews{ 0 };
+
+	/*
+	Signalled by the frame that draws to the image of the same index and waited on by its present. 
+	They belong to the images instead of the frames, since the image is only acquired again once 
+	the present that waits on its semaphore is done
+	*/
+	std::vector<VkSemaphore> renderFinishedSemaphores;
 	
 	uint32_t presentQueueIndex;
 	VkQueue presentQueue{ VK_NULL_HANDLE };
@@ -86,11 +182,15 @@ struct VulkanAllocatedImage
 	VmaAllocation allocation;
 	VkExtent3D extent;
 	VkFormat format;
+
+	//How the frame's passes left the image, a new image starts with nothing to wait for
+	VulkanResourceState state;
 };
 
 /*---------------------------------------------------------
-Holds the objects that will be used each frame for commands
-and synchronization functionality
+Holds the objects that will be used each frame for commands.
+The cpu knows that the gpu is done with them once the frame
+timeline semaphore reaches the value of their last frame
 -----------------------------------------------------------*/
 struct VulkanFrameTools
 {
@@ -98,11 +198,211 @@ struct VulkanFrameTools
 
 	VkCommandBuffer renderingCommandBuffer;
 
+	//Acquire can only signal a binary semaphore
 	VkSemaphore imageAvailableSeamphore;
 
-	VkSemaphore renderFinishedSemahore;
+	//Writes timestamps around the passes of this frame and reads them after the frame is done
+	VulkanGpuProfiler gpuProfiler;
+
+	//Holds the camera that this frame is drawn with, written by the cpu while the frame is recorded
+	VulkanShaderData::AllocatedBuffer cameraBuffer;
+	VkDeviceAddress cameraBufferAddress = 0;
 
-	VkFence inFlightFence;
+	//The draw counts of every slice in both culling phases are copied here, so that the cpu can read them after the frame is done
+	VulkanShaderData::AllocatedBuffer cullingStatsReadbackBuffer;
+	VulkanResourceState cullingStatsReadbackBufferState;
+	bool bCullingStatsWritten = false;
+
+	//When the input of the frame that used these tools was read, its latency is measured from here
+	std::chrono::steady_clock::time_point inputTime;
+
+	//Transforms of a render packet are written here and copied to the transform buffer by this frame
+	VulkanShaderData::AllocatedBuffer transformStagingBuffer;
+};
+
+/*---------------------------------------------------------
+Everything that a frame is drawn with, made by the game thread.
+The renderer copies what it needs from it, so the packet
+can be written again as soon as DrawFrame returns
+-----------------------------------------------------------*/
+struct VulkanRenderPacket
+{
+	//The camera that the frame is drawn and culled with, the visible objects come from culling with it
+	glm::mat4 viewProjection = glm::mat4(1.f);
+
+	//One for each draw record, in the order of the meshes. Empty keeps the transforms of the last packet
+	std::vector<glm::mat4> transforms;
+
+	//The size of the window's framebuffer, the swapchain is created again when it changes. 0 draws nothing
+	VkExtent2D framebufferExtent{ 0, 0 };
+
+	//When the game thread read the input that the packet was made from
+	std::chrono::steady_clock::time_point inputTime;
+};
+
+
+/*-------------------------------------------------------------
+Timings of the different stages of DrawFrame, in milliseconds.
+The gpu time belongs to the last frame that used the same frame
+tools, since it can only be read after the frame timeline has
+reached that frame
+--------------------------------------------------------------*/
+struct VulkanFrameStats
+{
+	//How long the cpu waited for the frame that used the same frame tools
+	double frameWaitTime = 0.0;
+	double recordTime = 0.0;
+	double submitTime = 0.0;
+	double gpuTime = 0.0;
+
+	//False if the frame was skipped before it was submitted, its timings are then left from an earlier frame
+	bool bSubmitted = false;
+
+	//False if the frame read no new gpu timestamps, like the first frames in flight
+	bool bGpuTimeValid = false;
+
+	//How many objects the culling passes drew and how many they rejected, from the same frame as the gpu time
+	uint32_t drawnObjectCount = 0;
+	uint32_t culledObjectCount = 0;
+	//False if the frame read no new counts
+	bool bCullingStatsValid = false;
+
+	//How long WaitForNextFrame slept for the frame limiter and waited for an earlier present
+	double pacingWaitTime = 0.0;
+
+	//From the input of the last frame that could be measured until it was shown, or until its gpu work ended
+	double inputLatency = 0.0;
+	VulkanLatencySource inputLatencySource = VulkanLatencySource::None;
+
+	//The extent that the frame was drawn at before the upscale, and how it compares to the swapchain's
+	VkExtent2D drawExtent{ 0, 0 };
+	float resolutionScale = 1.f;
+
+	//How many barriers the frame's command buffer recorded, and in how many vkCmdPipelineBarrier2 calls
+	uint32_t barrierCount = 0;
+	uint32_t barrierBatchCount = 0;
+
+	//How many passes the frame's render graph had, how many it culled and how many could go to an async compute queue
+	uint32_t renderGraphPassCount = 0;
+	uint32_t culledPassCount = 0;
+	uint32_t asyncComputePassCount = 0;
+};
+
+
+/*
+The pipelines that are compiled on the job system during startup. Pipelines that
+depend on each other are compiled in order by the same job
+*/
+enum class VulkanStartupPipeline : uint32_t
+{
+	Gradient = 0,
+	DepthPyramid = 1,
+	DrawCulling = 2,
+	Geometry = 3,
+
+	Count = 4
+};
+
+//When and where one of the startup pipelines was compiled, in milliseconds since the pipeline jobs were started
+struct VulkanPipelineCompileTiming
+{
+	const char* pipelineName = "";
+	double startTime = 0.0;
+	double compileTime = 0.0;
+	uint32_t jobThreadIndex = 0;
+
+	//False if a shader was missing from the shader library or the driver failed to create the pipeline
+	bool bCompiled = false;
+};
+
+//The workgroup size that a compute kernel uses
+struct VulkanWorkgroupTuningStats
+{
+	const char* kernelName = "";
+	VulkanWorkgroupSize workgroupSize;
+
+	//True if it was tuned by this run, false if it was read from the file
+	bool bTuned = false;
+	//Milliseconds for one dispatch when it was tuned
+	float dispatchTime = 0.f;
+};
+
+//How long the renderer took to start, in milliseconds
+struct VulkanStartupStats
+{
+	//The constructor and the time that the join point waited for the pipelines
+	double totalTime = 0.0;
+	//From the start of the pipeline jobs until the last of them finished
+	double pipelineTime = 0.0;
+	//How long the join point waited for pipelines that were still compiling after the rest of the setup
+	double pipelineWaitTime = 0.0;
+
+	std::array<VulkanPipelineCompileTiming, static_cast<size_t>(VulkanStartupPipeline::Count)> pipelineTimings;
+
+	//True if the pipeline cache was seeded from the file that an earlier run wrote
+	bool bPipelineCacheWarm = false;
+	size_t pipelineCacheLoadedSize = 0;
+
+	//Opening the shader library, which includes compiling the shaders that were not in the shader cache
+	double shaderTime = 0.0;
+	bool bShadersCompiledAtRuntime = false;
+	uint32_t shaderCacheHitCount = 0;
+	uint32_t shaderCompileCount = 0;
+	//Why the shader library failed to open or which shaders failed to compile, empty if nothing failed
+	std::string shaderErrorLog;
+
+	//Tuning the compute kernels that had no result for this device yet, 0 if every kernel had one
+	double workgroupTuningTime = 0.0;
+	std::vector<VulkanWorkgroupTuningStats> workgroupTuning;
+};
+
+
+//What the last shader reload did, in milliseconds
+struct VulkanShaderReloadStats
+{
+	uint32_t reloadCount = 0;
+
+	//From the start of the reload job until the new pipelines were ready
+	double lastReloadTime = 0.0;
+	uint32_t lastRebuiltPipelineCount = 0;
+
+	//Which shaders failed to compile or pipelines failed to build in the last reload, empty if nothing failed
+	std::string lastErrorLog;
+};
+
+//Written by the shader reload job, the render thread only reads it after the job is done
+struct VulkanPendingShaderReload
+{
+	//Null for pipelines that were not rebuilt
+	std::array<VkPipeline, static_cast<size_t>(VulkanStartupPipeline::Count)> newPipelines{};
+	std::string errorLog;
+	double reloadTime = 0.0;
+};
+
+//A pipeline that was replaced, which frames in flight might still be using
+struct VulkanRetiredPipeline
+{
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	//The first frame that starts after every frame that could have used it is done
+	uint64_t destroyFrame = 0;
+};
+
+//What a swapchain recreation replaced, destroyed like the retired pipelines once no frame in flight can use it
+struct VulkanRetiredSwapchainResources
+{
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	std::vector<VkImageView> swapchainImageViews;
+	std::vector<VkSemaphore> renderFinishedSemaphores;
+
+	//Null if the drawing image was large enough for the new extent
+	VulkanAllocatedImage drawingImage{};
+	VkDescriptorSet backgroundDrawingDescriptorSet = VK_NULL_HANDLE;
+
+	//Null if the extent did not change
+	VulkanAllocatedImage depthImage{};
+	VulkanDepthPyramidTargets depthPyramidTargets;
+
+	uint64_t destroyFrame = 0;
 };
 
 
@@ -113,6 +413,9 @@ struct ComputePipelineData
 	VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
 
 	VkPipeline computePipeline{ VK_NULL_HANDLE };
+
+	//The size in the pipeline's specialization constants, dispatches are counted with it
+	VulkanWorkgroupSize workgroupSize;
 };
 
 
@@ -130,6 +433,151 @@ struct GradientComputePushConstant
 	glm::vec4 data4;
 };
 
+struct DrawCullingComputePushConstant
+{
+	VkDeviceAddress meshDrawDataBuffer;
+	VkDeviceAddress drawRecordBuffer;
+	VkDeviceAddress transformBuffer;
+	VkDeviceAddress cameraBuffer;
+	VkDeviceAddress indirectDrawBuffer;
+	VkDeviceAddress drawCountBuffer;
+	VkDeviceAddress visibilityBuffer;
+	uint32_t drawRecordCount;
+	//One of VulkanCullingPhase
+	uint32_t cullingPhase;
+	glm::vec2 depthPyramidExtent;
+	//How many draw records, and commands, each slice of the indirect draw buffer has room for
+	uint32_t drawSliceSize;
+	uint32_t padding;
+};
+
+
+/*-----------------------------------------------------------------------
+Objects are culled and drawn in two phases each frame. The early phase
+draws what was visible last frame, with frustum culling only. Its depth
+builds the Hi-Z pyramid, and the late phase tests every object against 
+the frustum and the pyramid. It draws the visible objects that the early
+phase skipped and saves the visibility of all of them for the next frame
+------------------------------------------------------------------------*/
+enum class VulkanCullingPhase : uint32_t
+{
+	Early = 0,
+	Late = 1
+};
+
+
+/*-----------------------------------------------------------------------
+Buffers of the gpu driven draw path. The scene's meshes, objects and
+transforms are uploaded once, and a compute pass culls the objects and
+turns the visible ones into indirect draw commands every frame, so the
+cpu records the same few commands no matter how many objects there are
+------------------------------------------------------------------------*/
+struct VulkanIndirectDrawData
+{
+	VulkanShaderData::AllocatedBuffer meshDrawDataBuffer;
+	VkDeviceAddress meshDrawDataBufferAddress = 0;
+
+	VulkanShaderData::AllocatedBuffer drawRecordBuffer;
+	VkDeviceAddress drawRecordBufferAddress = 0;
+
+	VulkanShaderData::AllocatedBuffer transformBuffer;
+	VkDeviceAddress transformBufferAddress = 0;
+	VulkanResourceState transformBufferState;
+
+	/*
+	Written by the culling pass and read by vkCmdDrawIndexedIndirectCount. The draw records are split 
+	into slices of drawSliceSize, one for each recording slice. The visible records of a slice are packed 
+	at the start of its part of the command buffer, and the slice has its own count in the count buffer
+	*/
+	VulkanShaderData::AllocatedBuffer indirectDrawBuffer;
+	VkDeviceAddress indirectDrawBufferAddress = 0;
+	VulkanResourceState indirectDrawBufferState;
+	VulkanShaderData::AllocatedBuffer drawCountBuffer;
+	VkDeviceAddress drawCountBufferAddress = 0;
+	VulkanResourceState drawCountBufferState;
+
+	//One value for each draw record, 1 if the late culling phase found it visible in the last frame
+	VulkanShaderData::AllocatedBuffer visibilityBuffer;
+	VkDeviceAddress visibilityBufferAddress = 0;
+	VulkanResourceState visibilityBufferState;
+
+	uint32_t drawRecordCount = 0;
+
+	uint32_t drawSliceCount = 1;
+	uint32_t drawSliceSize = 1;
+};
+
+
+/*------------------------------------------------------------
+Settings that are passed to the VulkanRenderer on construction
+and decide how it is going to be initialized
+--------------------------------------------------------------*/
+struct VulkanRendererSettings
+{
+	/*
+	When headless, no window, surface or swapchain are created. Frames are
+	drawn to the drawing image only and nothing is presented, so the renderer
+	runs as fast as the device allows (used for servers and benchmarking)
+	*/
+	bool bHeadless = false;
+
+	/*
+	How many secondary command buffers the geometry passes are split into, which the job system records 
+	in parallel. 0 uses one for each job thread, up to BLITZEN_VULKAN_MAX_RECORDING_THREADS
+	*/
+	uint32_t recordingSliceCount = 0;
+
+	//The pipeline cache is read from and written to this file, null keeps it in memory only
+	const char* pipelineCacheFilepath = BLITZEN_VULKAN_PIPELINE_CACHE_DEFAULT_FILEPATH;
+
+	/*
+	Compiles the GLSL sources at startup through the shader cache, instead of reading the library 
+	that the build packed. Only builds that found glslang can do it, and they do it by default
+	*/
+	bool bCompileShadersAtRuntime = VulkanShaderCompiler::IsAvailable();
+	//Each one is NAME or NAME=VALUE, and they are part of the shader cache key
+	std::vector<std::string> shaderDefines;
+
+	/*
+	Watches the shader sources and rebuilds the pipelines of the shaders that change while the 
+	renderer keeps drawing. Only works with bCompileShadersAtRuntime
+	*/
+	bool bShaderHotReload = false;
+
+	//The fastest workgroup sizes that were found for the device are kept in this file, null tunes every run
+	const char* workgroupTuningFilepath = BLITZEN_VULKAN_WORKGROUP_TUNING_DEFAULT_FILEPATH;
+	//Tunes every kernel at startup, even the ones that the file has a result for
+	bool bRetuneWorkgroups = false;
+
+	/*
+	The present mode that the swapchain is created with. If the surface does not support it, 
+	mailbox and immediate fall back to each other and everything falls back to fifo
+	*/
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+	//The frame limiter's target, 0 does not limit the frame rate
+	double targetFrameRate = 0.0;
+
+	/*
+	Dynamic resolution draws at a smaller extent when the gpu time of recent frames, until the geometry is drawn, goes over
+	this budget in milliseconds, and the copy to the swapchain upscales it. 0 always draws at full resolution
+	*/
+	double gpuFrameBudget = 0.0;
+	//Bounds of the resolution scale on each side, clamped from BLITZEN_VULKAN_MIN_RESOLUTION_SCALE to 1
+	float minResolutionScale = 0.5f;
+	float maxResolutionScale = 1.f;
+
+	/*
+	With present wait, how many of the earlier frames can still be waiting for the display when the
+	next frame reads its input. 1 waits until the last frame is shown, which has the lowest latency.
+	0 does not wait for presents
+	*/
+	uint32_t maxQueuedPresents = 1;
+
+	//From 1 to BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT, values outside of it are clamped
+	uint32_t framesInFlight = BLITZEN_VULKAN_DEFAULT_FRAMES_IN_FLIGHT;
+};
+
 
 /*------------------------------------------------------------
 The vulkan Renderer is responsible for setting up the 
@@ -144,31 +592,208 @@ public:
 
 public:
 
-	VulkanRenderer(BlitzenEngine::VulkanMesh* pMeshes, uint32_t meshCount);
+	VulkanRenderer(BlitzenEngine::VulkanMesh* pMeshes, uint32_t meshCount, 
+		const VulkanRendererSettings& settings = VulkanRendererSettings());
 
 	~VulkanRenderer();
 
+	//Waits for the startup pipelines the first time it is called, and draws nothing if any of them failed
 	void DrawFrame();
 
+	/*
+	Draws a frame from a render packet instead of the renderer's own state, so it can be called from a 
+	render thread. It does not use the window, the game thread that owns it fills the packet
+	*/
+	void DrawFrame(const VulkanRenderPacket& packet);
+
+	/*
+	Sleeps for the frame limiter and waits for earlier presents, so the input should be read right after it.
+	DrawFrame calls it if it was not called since the last frame
+	*/
+	void WaitForNextFrame();
+
+	//The swapchain is created again with the mode before the next frame, the window interface tells which mode it got
+	void SetPresentMode(VkPresentModeKHR presentMode);
+
+	inline VkPresentModeKHR GetPresentMode() const { return windowInterface.presentMode; }
+
+	//0 draws at the upper bound of the resolution scale
+	inline void SetGpuFrameBudget(double gpuFrameBudget)
+	{ rendererSettings.gpuFrameBudget = gpuFrameBudget; resolutionScaler.SetFrameBudget(gpuFrameBudget); }
+
+	inline float GetResolutionScale() const { return resolutionScaler.GetScale(); }
+
+	//0 does not limit the frame rate
+	inline void SetTargetFrameRate(double targetFrameRate) 
+	{ rendererSettings.targetFrameRate = targetFrameRate; framePacer.SetTargetFrameRate(targetFrameRate); }
+
+	/*
+	The pipelines are compiled on the job system while the constructor uploads the meshes. 
+	This waits for them, and should be called from the thread that created the renderer. 
+	DrawFrame calls it too, so calling it is only needed to read complete startup stats earlier.
+	Returns false if any pipeline failed, the startup stats tell which
+	*/
+	bool WaitForPipelines();
+
+	//Returns the timings of the last call to DrawFrame
+	inline const VulkanFrameStats& GetLastFrameStats() const { return lastFrameStats; }
+
+	//The pipeline timings are only complete after WaitForPipelines
+	inline const VulkanStartupStats& GetStartupStats() const { return startupStats; }
+
+	//Only complete reloads are counted, the stats are updated at the start of the frame that uses the new pipelines
+	inline const VulkanShaderReloadStats& GetShaderReloadStats() const { return shaderReloadStats; }
+
+	//False if hot reload was not requested or the shader sources could not be watched
+	inline bool IsShaderHotReloadActive() const { return shaderWatcher.IsWatching(); }
+
+	//Writes the pipeline cache to its file now, it is also written when the renderer is destroyed
+	inline bool SavePipelineCache() { return pipelineCache.Save(); }
+
+	/*
+	Tunes every compute kernel again and replaces the pipelines whose size changed. Waits for the frames 
+	in flight, so it should not be called every frame. The startup stats get the new results.
+	Returns false if the device has no timestamps or the pipelines are not ready
+	*/
+	bool RetuneWorkgroupSizes();
+
+	/*
+	Returns the gpu time of every pass in the last frame whose timestamps were read,
+	the first zone is always the whole frame
+	*/
+	inline const std::vector<VulkanGpuZoneTiming>& GetGpuZoneTimings() const 
+	{ return lastGpuZoneTimings; }
+
+	//Returns the gpu time of a pass in milliseconds, or a negative value if the pass was not found
+	double GetGpuZoneTime(const char* zoneName) const;
+
+	//Sets the camera that the next frames are drawn and culled with, the default is the identity
+	inline void SetViewProjection(const glm::mat4& newViewProjection) 
+	{ viewProjection = newViewProjection; }
+
 private:
 
+	/*
+	Called at the start of each frame, after the wait for its frame tools. Destroys the replaced pipelines that no frame 
+	in flight can use anymore, swaps in the pipelines of a finished reload and starts a reload once the 
+	shader sources stop changing
+	*/
+	void UpdateShaderHotReload();
+
+	//Compiles the changed shaders and rebuilds the pipelines that use them, pData is the renderer
+	static void ReloadShadersJob(void* pData);
+
+	//Replaces the pipelines that the reload job rebuilt, the old ones are retired
+	void ApplyShaderReload();
+
+	//Destroys the retired pipelines whose frames are done, or all of them if the device is idle
+	void DestroyRetiredPipelines(bool bDeviceIdle);
+
+	//Creates a new pipeline from the current shaders, with the layout and the workgroup size of the old one
+	bool RebuildPipeline(VulkanStartupPipeline pipeline, VkPipeline& newPipeline);
+
+	VkPipeline& GetPipelineHandle(VulkanStartupPipeline pipeline);
+
+	/*
+	Creates a swapchain for the current size of the window and gives the old one to it. The drawing image 
+	only grows, the depth image and the pyramid follow the draw extent. Everything replaced is retired.
+	Returns false if the window is minimized or the swapchain could not be created, nothing is drawn until it succeeds
+	*/
+	bool RecreateSwapchain();
+
+	//Destroys what swapchain recreations replaced once its frames are done, or all of it if the device is idle
+	void DestroyRetiredSwapchainResources(bool bDeviceIdle);
+
+	/*
+	Times the workgroup size candidates of the tunable kernels that have no result yet, or all of them 
+	when retuning, and replaces the pipelines whose size changed. Nothing can be in flight
+	*/
+	void TuneWorkgroupSizes(bool bRetune);
+
+	//The result of the shader's kernel for this device, or the default if it was never tuned
+	VulkanWorkgroupSize FindTunedWorkgroupSize(const char* shaderName, const VulkanWorkgroupSize& defaultSize);
+
+	//Maps the shader library again after startup closed it, returns false if it could not be opened
+	bool OpenShaderLibrary();
+
+	//Reads the gpu profiler results of the frame in the current frame tools, called after the frame is done
+	void ReadGpuProfilerResults();
+
+	//Reads the draw count that the culling pass of the frame in the current frame tools wrote, called with the profiler results
+	void ReadCullingStats();
+
+	/*
+	Called by ReadGpuProfilerResults once the timestamps of the frame in the current frame tools were read. 
+	Without present wait, the latency of that frame ends at its last gpu timestamp
+	*/
+	void ReadInputLatency();
+
+	//Called by both DrawFrame overloads, once they set the state that the frame is drawn with
+	void RenderFrame();
+
+	//Writes the view projection matrix and the frustum planes that it makes to the camera buffer of the current frame tools
+	void UpdateCameraBuffer();
+
+	//Sets the draw extent of the next frame from the native one and the resolution scale
+	void UpdateDrawExtent();
+
+	/*
+	A pass of the frame graph, added when a render packet changed the transforms. Writes them to the 
+	staging buffer of the frame tools and copies it to the transform buffer before culling reads it
+	*/
+	void RecordTransformCopy(const VkCommandBuffer& commandBuffer);
+
 	//Records the command buffer that will draw the frame
 	void RecordFrameCommandBuffer(const VkCommandBuffer& commandBuffer, 
-		uint32_t swapchainImageIndex, VkImage& drawingImage);
+		uint32_t swapchainImageIndex);
+
+	/*
+	Called by RecordFrameCommandBuffer. Imports the resources of the frame into the frame graph 
+	and adds its passes, with how each of them uses the resources
+	*/
+	void BuildFrameGraph(uint32_t swapchainImageIndex);
 
 	/*
-	Called by RecordFrameCommandBuffer.
-	Records the commands that will draw the background of the window
+	A pass of the frame graph.
+	Records the commands that will draw the background of the window. 
+	The drawing image has to be in the general layout
 	*/
-	void DrawBackground(const VkCommandBuffer& commandBuffer, 
-		VkImage& image);
+	void DrawBackground(const VkCommandBuffer& commandBuffer);
 
-	void DrawGeometry(const VkCommandBuffer& commandBuffer);
+	//Draws the background with another pipeline of the gradient, which workgroup tuning times
+	void DrawBackground(const VkCommandBuffer& commandBuffer, const VkPipeline& pipeline,
+		const VulkanWorkgroupSize& workgroupSize);
 
+	//A pass of the frame graph, before each culling pass. Clears the count of every slice
+	void ClearDrawCounts(const VkCommandBuffer& commandBuffer);
 
+	/*
+	A pass of the frame graph, before each DrawGeometry.
+	Dispatches the compute pass that culls the draw records of the phase and writes 
+	the indirect draw commands of the visible ones and their count
+	*/
+	void CullDrawRecords(const VkCommandBuffer& commandBuffer, VulkanCullingPhase phase);
 
+	//Copies the counts of the phase to the readback buffer, so that the cpu can see how many objects were drawn
+	void CopyCullingStats(const VkCommandBuffer& commandBuffer, VulkanCullingPhase phase);
 
-	//Helper function called while command recording to change the layout of an image
+	/*
+	The early phase clears the depth buffer, the late phase draws on top of it. 
+	Each slice of the indirect draw buffer is drawn by a secondary command buffer
+	that the parallel recorder records on its own thread
+	*/
+	void DrawGeometry(const VkCommandBuffer& commandBuffer, bool bClearDepth);
+
+	//Records the state and the indirect draw of one slice into a secondary command buffer of the geometry pass
+	void DrawGeometrySlice(const VkCommandBuffer& commandBuffer, uint32_t sliceIndex);
+
+
+
+
+	/*
+	Changes the layout of an image with a barrier that waits for every earlier command. The frame's passes
+	get theirs from the frame graph instead, this is left for command buffers outside of the frame
+	*/
 	void TransitionImageLayoutWhileDrawing(const VkCommandBuffer& commandBuffer,
 		VkImage& currentImage, VkImageLayout initialLayout, VkImageLayout finalLayout);
 
@@ -205,13 +830,20 @@ private:
 	//Gets all required device queues and queue family indices from the device
 	void GetDeviceQueues(vkb::Device& vkbDevice);
 
-	//Initializes the swapchain, saves the image format and extent and gets the swapchain images
-	void SetupSwapchain();
+	/*
+	Initializes the swapchain, saves the image format and extent and gets the swapchain images.
+	Creates a render finished semaphore for each image. The old swapchain can be null, returns false if the swapchain could not be created
+	*/
+	bool SetupSwapchain(const VkSwapchainKHR& oldSwapchain);
+
 
 
 
+	//Allocates the image that every pass draws to, it can be larger than the draw extent
+	void AllocateDrawingImage(VkExtent2D extent);
 
-	void AllocateDrawingImage();
+	//Allocates the depth buffer, which the geometry pass tests against and the depth pyramid is built from
+	void AllocateDepthImage();
 
 
 
@@ -223,14 +855,21 @@ private:
 
 	void AllocateMeshBuffers(BlitzenEngine::VulkanMesh* pMeshes, uint32_t meshCount);
 
-	//Fills the buffers in s GPUMeshBuffers struct
-	void AllocateGPUMeshBuffers(VulkanShaderData::GPUMeshBuffers& meshBuffers, 
-		std::vector<VulkanShaderData::Vertex>& vertices, std::vector<uint32_t>& indices);
-
 	//Allocates a AllocatedBuffer struct
 	void AllocateBuffer(VulkanShaderData::AllocatedBuffer& vertexBuffer, VkDeviceSize size,
 		VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
 
+	VkDeviceAddress GetBufferDeviceAddress(const VkBuffer& buffer);
+
+	//Returns the sphere around the vertices, with the center in xyz and the radius in w
+	glm::vec4 CalculateBoundingSphere(const std::vector<VulkanShaderData::Vertex>& vertices);
+
+	/*
+	Creates the buffers of the gpu driven draw path. Each mesh becomes one draw record with
+	its model matrix as the transform, and the records are uploaded with the mesh data
+	*/
+	void AllocateIndirectDrawBuffers(BlitzenEngine::VulkanMesh* pMeshes, uint32_t meshCount);
+
 
 
 
@@ -240,20 +879,50 @@ private:
 	//Allocates descriptors for shaders that handle background drawing
 	void BackgroundShadersDescriptorSetsInit();
 
+	//Allocates the set that the gradient writes the drawing image with
+	void AllocateBackgroundDescriptorSet();
+
 
 
 	
-	//Initializes all pipelines that will be used throughout the program
-	void InitPipelines();
+	/*
+	Creates the pipeline cache and starts the jobs that compile every pipeline used throughout
+	the program. Needs the descriptor set layouts and the image formats, but not the meshes
+	*/
+	void StartPipelineCompilation();
+
+	//Job functions of the pipeline compilation, pData is the renderer
+	static void CompileGradientPipelineJob(void* pData);
+	static void CompileCullingPipelinesJob(void* pData);
+	static void CompileGeometryPipelineJob(void* pData);
 
-	//Read a shader file into an array in byte format
-	void ReadShaderFile(const char* filepath, std::vector<char>& code);
+	//Calls the init function from a pipeline job and records how long it took and whether it succeeded
+	void TimePipelineCompile(VulkanStartupPipeline pipeline, const char* pipelineName,
+		bool (VulkanRenderer::*initFunction)());
+
+	/*
+	The pipeline init functions return false if their shader is not in the shader library
+	or the driver failed to create the pipeline
+	*/
+
+	//Creates a compute pipeline from a shader in the shader library, with the workgroup size as specialization constants
+	bool CreateComputePipeline(const char* shaderName, const VkPipelineLayout& pipelineLayout,
+		const VulkanWorkgroupSize& workgroupSize, VkPipeline& pipeline);
 
 	//Initializes the gradient compute pipeline
-	void InitGradientComputePipeline();
+	bool InitGradientComputePipeline();
+
+	bool InitDrawCullingComputePipeline();
+
+	//Creates the Hi-Z pyramid for the depth image and its build pipeline
+	bool InitDepthPyramid();
+
+	bool InitGeometryPipeline();
 
 private:
 
+	VulkanRendererSettings rendererSettings;
+
 	//The device interfaces with the GPU that was chosen at initialization
 	VkDevice device{ VK_NULL_HANDLE };
 
@@ -263,6 +932,26 @@ private:
 	VkBootstrapInitialized vkBootstrapObjects{};
 
 	VulkanWindowInterfaceObjects windowInterface{};
+	/*
+	The size that the swapchain is created with. Only DrawFrame changes it, from the window data or a 
+	render packet, so the renderer never asks glfw for it outside of the main thread
+	*/
+	VkExtent2D framebufferExtent{ 0, 0 };
+	bool bFramebufferResized = false;
+	//Set when acquire or present report that the swapchain no longer matches the surface
+	bool bSwapchainOutOfDate = false;
+	std::vector<VulkanRetiredSwapchainResources> retiredSwapchainResources;
+
+	VulkanFramePacer framePacer;
+	//Set by WaitForNextFrame and cleared by DrawFrame, the input time of the frame is taken with it
+	bool bFramePaced = false;
+	std::chrono::steady_clock::time_point frameInputTime;
+	/*
+	Every present has an id one higher than the last. Ids of a swapchain start where the last one stopped, 
+	so the pacer only waits for ids that the current swapchain presented
+	*/
+	uint64_t lastPresentId = 0;
+	uint64_t firstSwapchainPresentId = 1;
 
 	const char* staticObjectVertexShaderFilepath =
 		"VulkanShaders/StaticObjectVertexShader.spv";
@@ -270,29 +959,98 @@ private:
 		"VulkanShaders/StaticObjectFragmentShader.spv";
 
 	VulkanAllocatedImage drawingImage;
+	//The extent that the frame is drawn at, a corner of the drawing image and of the depth image
 	VkExtent2D drawExtent;
+	//The draw extent at full resolution, the swapchain extent when there is a window
+	VkExtent2D nativeDrawExtent;
+	VulkanResolutionScaler resolutionScaler;
+
+	//Built again for every frame, it records the passes in order with the barriers that the tracker finds for them
+	VulkanRenderGraph frameGraph;
+	VulkanResourceStateTracker resourceTracker;
+	//The swapchain image of the frame, its state starts again after every acquire
+	VulkanResourceState swapchainImageState;
+
+	VulkanAllocatedImage depthImage;
+
+	VulkanDepthPyramid depthPyramid;
 
 	//Holds how many frames have been rendered
 	uint64_t frameCount = 0;
 	uint8_t frameQueue = 0;
 
-	//These command objects are mostly used during setup, for operations like data copies
-	VkCommandPool immediateSubmitCommandPool{ VK_NULL_HANDLE };
-	VkCommandBuffer immediateSubmitCommandBuffer{ VK_NULL_HANDLE };
+	/*
+	Each frame signals it with its frame count plus 1 when the gpu is done with it. The cpu waits for 
+	it before reusing frame tools, which replaces a fence for each of them
+	*/
+	VkSemaphore frameTimelineSemaphore{ VK_NULL_HANDLE };
+
+	VulkanFrameStats lastFrameStats{};
+
+	VulkanStartupStats startupStats{};
+	std::chrono::high_resolution_clock::time_point pipelineStartTime;
+
+	//Counts the pipeline jobs that have not finished, WaitForPipelines joins them
+	BlitzenEngine::JobCounter pipelineCompileCounter;
+	bool bPipelinesPending = false;
+	bool bPipelinesReady = false;
+
+	glm::mat4 viewProjection = glm::mat4(1.f);
+
+	//The transforms of the last render packet that changed them, until a frame copies them
+	std::vector<glm::mat4> pendingTransforms;
+	bool bTransformsPending = false;
+
+	//Used to line up the gpu timestamps with the cpu timeline
+	VulkanGpuClockCalibration gpuClockCalibration;
+	std::vector<VulkanGpuZoneTiming> lastGpuZoneTimings;
 
-	//Holds a list frame tools for each frame in flight that Vulkan is allowed
-	std::array<VulkanFrameTools, BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT>
-		frameTools;
+	//Copies data to gpu only buffers through the transfer queue, used mostly during setup
+	VulkanUploadManager uploadManager;
+	//The upload timeline value that the frame being recorded has to wait for, 0 if there is none
+	uint64_t frameUploadWaitValue = 0;
 
-	std::vector<VulkanShaderData::GPUMeshBuffers> meshBuffersList;
+	//Holds the frame tools of each frame in flight, as many as the settings ask for
+	std::vector<VulkanFrameTools> frameTools;
+
+	//Each job thread has its own command pool for every frame in flight
+	VulkanParallelRecorder parallelRecorder;
+	//The secondaries recorded for the geometry pass that is being recorded
+	std::vector<VkCommandBuffer> geometrySecondaries;
+
+	VulkanGeometryArena geometryArena;
+	//The ranges of the geometry arena that each mesh was given
+	std::vector<VulkanShaderData::GPUMeshRange> meshRanges;
+
+	VulkanIndirectDrawData indirectDrawData;
 
 	//Holds a descriptor pool which will allocate descriptor sets
 	VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
 
 	VkDescriptorSet backgroundDrawingDescriptorSet{ VK_NULL_HANDLE };
+
+	VulkanPipelineCache pipelineCache;
+	//Mapped during startup, the pipeline jobs create their shader modules from it
+	VulkanShaderLibrary shaderLibrary;
 	std::array<VkDescriptorSetLayout, 1> backgroundDrawingDescriptorSetLayouts;
 
+	//Kept open after startup while hot reload watches the sources
+	BlitzenEngine::FileWatcher shaderWatcher;
+	std::vector<std::string> changedShaderFiles;
+	//Set when a source changed, the reload starts once nothing changed for BLITZEN_VULKAN_SHADER_RELOAD_DELAY_MS
+	bool bShaderChangesPending = false;
+	std::chrono::high_resolution_clock::time_point lastShaderChangeTime;
+	BlitzenEngine::JobCounter shaderReloadCounter;
+	bool bShaderReloadRunning = false;
+	VulkanPendingShaderReload pendingShaderReload;
+	std::vector<VulkanRetiredPipeline> retiredPipelines;
+	VulkanShaderReloadStats shaderReloadStats;
+
+	VulkanWorkgroupTuner workgroupTuner;
+
 	ComputePipelineData gradientComputePipeline;
 
+	ComputePipelineData drawCullingComputePipeline;
+
 	VulkanGraphicsPipeline simpleGeometryGraphicsPipeline;
 };
\ No newline at end of file
@@ -1,27 +1,127 @@
 #include "VulkanRenderer.h"
 #include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
 
-VulkanRenderer::VulkanRenderer(BlitzenEngine::VulkanMesh* pMeshes, uint32_t meshCount)
+#include <cstring>
+#include <algorithm>
+
+VulkanRenderer::VulkanRenderer(BlitzenEngine::VulkanMesh* pMeshes, uint32_t meshCount,
+	const VulkanRendererSettings& settings /* =VulkanRendererSettings() */)
+	:rendererSettings(settings)
 {
-	InitGlfwAndSetupWindow();
+	auto startupStart = std::chrono::high_resolution_clock::now();
+
+	rendererSettings.framesInFlight = std::clamp(rendererSettings.framesInFlight, 1u, 
+		BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT);
+
+	//The gpu times of the frames that are in flight when the scale changes still belong to the old scale
+	resolutionScaler.Init(rendererSettings.minResolutionScale, rendererSettings.maxResolutionScale,
+		rendererSettings.framesInFlight);
+	resolutionScaler.SetFrameBudget(rendererSettings.gpuFrameBudget);
+
+	if (rendererSettings.bHeadless)
+	{
+		//Without a window, the renderer only needs to know the size it is going to draw to
+		nativeDrawExtent.width = windowData.width;
+		nativeDrawExtent.height = windowData.height;
+	}
+	else
+	{
+		InitGlfwAndSetupWindow();
+	}
 
 	VulkanBootstrapHelpersInit();
+	drawExtent = resolutionScaler.GetScaledExtent(nativeDrawExtent);
+
+	//Every scale fits in the drawing image and the depth image, so they are only allocated again when the native extent grows
+	AllocateDrawingImage(nativeDrawExtent);
 
-	AllocateDrawingImage();
+	AllocateDepthImage();
 
 	VulkanFrameToolsInit();
 
+	DescriptorsInit();
+
+	//The pipelines only need the formats and the descriptor set layouts, so they compile while the meshes upload
+	StartPipelineCompilation();
+
 	AllocateMeshBuffers(pMeshes, meshCount);
 
-	DescriptorsInit();
+	auto startupEnd = std::chrono::high_resolution_clock::now();
 
-	InitPipelines();
+	//WaitForPipelines adds the time that the pipelines needed after this
+	startupStats.totalTime = std::chrono::duration<double, std::milli>(
+		startupEnd - startupStart).count();
+	startupStats.bPipelineCacheWarm = pipelineCache.WasLoadedFromFile();
+	startupStats.pipelineCacheLoadedSize = pipelineCache.GetLoadedDataSize();
+}
+
+bool VulkanRenderer::WaitForPipelines()
+{
+	if (!bPipelinesPending)
+	{
+		return bPipelinesReady;
+	}
+
+	BLITZEN_CPU_PROFILER_ZONE("WaitForPipelines");
+
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	BlitzenEngine::JobSystem::Wait(pipelineCompileCounter);
+	auto waitEnd = std::chrono::high_resolution_clock::now();
+	bPipelinesPending = false;
+
+	startupStats.pipelineWaitTime = std::chrono::duration<double, std::milli>(waitEnd - waitStart).count();
+	startupStats.pipelineTime = 0.0;
+	bPipelinesReady = true;
+	for (const VulkanPipelineCompileTiming& timing : startupStats.pipelineTimings)
+	{
+		startupStats.pipelineTime = std::max(startupStats.pipelineTime, timing.startTime + timing.compileTime);
+		bPipelinesReady = bPipelinesReady && timing.bCompiled;
+	}
+
+	startupStats.totalTime += startupStats.pipelineWaitTime;
+
+	//Nothing has been drawn yet, so the tuner can use the images that the kernels write
+	if (bPipelinesReady)
+	{
+		TuneWorkgroupSizes(rendererSettings.bRetuneWorkgroups);
+		startupStats.totalTime += startupStats.workgroupTuningTime;
+	}
+
+	//Every shader module has been created, so the code does not need to stay mapped, unless hot reload rebuilds pipelines from it
+	if (!shaderWatcher.IsWatching())
+	{
+		shaderLibrary.Cleanup();
+	}
+
+	return bPipelinesReady;
 }
 
 VulkanRenderer::~VulkanRenderer()
 {
+	//A renderer that never drew a frame can still have pipelines compiling
+	WaitForPipelines();
+
+	//The pipelines of a reload that was never applied are destroyed with the rest
+	BlitzenEngine::JobSystem::Wait(shaderReloadCounter);
+	shaderWatcher.Cleanup();
+
 	vkDeviceWaitIdle(device);
 
+	DestroyRetiredPipelines(true);
+	DestroyRetiredSwapchainResources(true);
+	for (VkPipeline& newPipeline : pendingShaderReload.newPipelines)
+	{
+		vkDestroyPipeline(device, newPipeline, nullptr);
+	}
+	shaderLibrary.Cleanup();
+
+	//The next run starts with every pipeline that this one compiled
+	pipelineCache.Save();
+	pipelineCache.Cleanup();
+
+	//The results were saved when the kernels were tuned
+	workgroupTuner.Cleanup();
+
 	simpleGeometryGraphicsPipeline.Cleanup(device);
 
 	vkDestroyPipeline(device, gradientComputePipeline.computePipeline, nullptr);
@@ -29,6 +129,11 @@ VulkanRenderer::~VulkanRenderer()
 	vkDestroyPipelineLayout(device, gradientComputePipeline.pipelineLayout,
 		nullptr);
 
+	vkDestroyPipeline(device, drawCullingComputePipeline.computePipeline, nullptr);
+
+	vkDestroyPipelineLayout(device, drawCullingComputePipeline.pipelineLayout,
+		nullptr);
+
 	for (size_t i = 0; i < backgroundDrawingDescriptorSetLayouts.
 		size(); ++i)
 	{
@@ -39,52 +144,92 @@ VulkanRenderer::~VulkanRenderer()
 
 	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
-	vmaDestroyBuffer(allocator, meshBuffersList[0].vertexBuffer.buffer, 
-		meshBuffersList[0].vertexBuffer.allocation);
-	vmaDestroyBuffer(allocator, meshBuffersList[0].indexBuffer.buffer,
-		meshBuffersList[0].indexBuffer.allocation);
+	depthPyramid.Cleanup(device, allocator);
+
+	geometryArena.Cleanup(allocator);
+
+	vmaDestroyBuffer(allocator, indirectDrawData.meshDrawDataBuffer.buffer,
+		indirectDrawData.meshDrawDataBuffer.allocation);
+	vmaDestroyBuffer(allocator, indirectDrawData.drawRecordBuffer.buffer,
+		indirectDrawData.drawRecordBuffer.allocation);
+	vmaDestroyBuffer(allocator, indirectDrawData.transformBuffer.buffer,
+		indirectDrawData.transformBuffer.allocation);
+	vmaDestroyBuffer(allocator, indirectDrawData.indirectDrawBuffer.buffer,
+		indirectDrawData.indirectDrawBuffer.allocation);
+	vmaDestroyBuffer(allocator, indirectDrawData.drawCountBuffer.buffer,
+		indirectDrawData.drawCountBuffer.allocation);
+	vmaDestroyBuffer(allocator, indirectDrawData.visibilityBuffer.buffer,
+		indirectDrawData.visibilityBuffer.allocation);
 
 	//Destroying the objects in the frame tools array
 	for (size_t i = 0; i < frameTools.size(); ++i)
 	{
 		//Destroy synchronization structs in array
 		vkDestroySemaphore(device, frameTools[i].imageAvailableSeamphore, nullptr);
-		vkDestroySemaphore(device, frameTools[i].renderFinishedSemahore, nullptr);
-		vkDestroyFence(device, frameTools[i].inFlightFence, nullptr);
+
+		frameTools[i].gpuProfiler.Cleanup(device);
+
+		vmaDestroyBuffer(allocator, frameTools[i].cameraBuffer.buffer,
+			frameTools[i].cameraBuffer.allocation);
+		vmaDestroyBuffer(allocator, frameTools[i].cullingStatsReadbackBuffer.buffer,
+			frameTools[i].cullingStatsReadbackBuffer.allocation);
+		vmaDestroyBuffer(allocator, frameTools[i].transformStagingBuffer.buffer,
+			frameTools[i].transformStagingBuffer.allocation);
 
 		//Destroying each command pool also deallocates the command buffers
 		vkDestroyCommandPool(device, frameTools[i].renderingCommandPool, 
 			nullptr);
 	}
 
-	vkDestroyCommandPool(device, immediateSubmitCommandPool, nullptr);
+	vkDestroySemaphore(device, frameTimelineSemaphore, nullptr);
+
+	uploadManager.Cleanup();
+
+	parallelRecorder.Cleanup();
 
 	vkDestroyImageView(device, drawingImage.imageView, nullptr);
 	vmaDestroyImage(allocator, drawingImage.image, drawingImage.allocation);
 
-	for (size_t i = 0; i < windowInterface.swapchainImageViews.size(); ++i)
+	vkDestroyImageView(device, depthImage.imageView, nullptr);
+	vmaDestroyImage(allocator, depthImage.image, depthImage.allocation);
+
+	//A headless renderer never created the swapchain and its image views
+	if (!rendererSettings.bHeadless)
 	{
-		vkDestroyImageView(device, windowInterface.swapchainImageViews[i], 
-			nullptr);
-	}
+		for (size_t i = 0; i < windowInterface.swapchainImageViews.size(); ++i)
+		{
+			vkDestroyImageView(device, windowInterface.swapchainImageViews[i], 
+				nullptr);
+		}
+		for (VkSemaphore& renderFinishedSemaphore : windowInterface.renderFinishedSemaphores)
+		{
+			vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
+		}
 	
-	vkDestroySwapchainKHR(device, windowInterface.swapchain, nullptr);
+		vkDestroySwapchainKHR(device, windowInterface.swapchain, nullptr);
+	}
 
 	vmaDestroyAllocator(allocator);
 
 	vkDestroyDevice(device, nullptr);
 
-	vkDestroySurfaceKHR(vkBootstrapObjects.vulkanInstance, 
-		windowInterface.windowSurface, nullptr);
+	if (!rendererSettings.bHeadless)
+	{
+		vkDestroySurfaceKHR(vkBootstrapObjects.vulkanInstance, 
+			windowInterface.windowSurface, nullptr);
+	}
 
 	vkb::destroy_debug_utils_messenger(vkBootstrapObjects.vulkanInstance,
 		vkBootstrapObjects.vulkanDebugMessenger, nullptr);
 
 	vkDestroyInstance(vkBootstrapObjects.vulkanInstance, nullptr);
 
-	glfwDestroyWindow(windowData.pWindow);
+	if (!rendererSettings.bHeadless)
+	{
+		glfwDestroyWindow(windowData.pWindow);
 
-	glfwTerminate();
+		glfwTerminate();
+	}
 }
 
 
@@ -102,71 +247,416 @@ correctly
 
 void VulkanRenderer::DrawFrame()
 {
+	//The window callbacks run on this thread, so the size that they saw can be used directly
+	if (windowData.bWindowResized)
+	{
+		framebufferExtent.width = static_cast<uint32_t>(windowData.width);
+		framebufferExtent.height = static_cast<uint32_t>(windowData.height);
+		bFramebufferResized = true;
+		windowData.bWindowResized = false;
+	}
+
 	if (windowData.bWindowShouldStopRendering)
 	{
 		vkDeviceWaitIdle(device);
 	}
+
+	RenderFrame();
+}
+
+void VulkanRenderer::DrawFrame(const VulkanRenderPacket& packet)
+{
+	viewProjection = packet.viewProjection;
+
+	//Kept until a frame records the copy, so that a skipped frame does not lose the transforms
+	if (!packet.transforms.empty() && packet.transforms.size() == indirectDrawData.drawRecordCount)
+	{
+		pendingTransforms.assign(packet.transforms.begin(), packet.transforms.end());
+		bTransformsPending = true;
+	}
+
+	if (packet.framebufferExtent.width != framebufferExtent.width || 
+		packet.framebufferExtent.height != framebufferExtent.height)
+	{
+		framebufferExtent = packet.framebufferExtent;
+		bFramebufferResized = true;
+	}
+
+	//The latency of the frame starts when the game thread read the input of the packet
+	if (!bFramePaced)
+	{
+		WaitForNextFrame();
+	}
+	frameInputTime = packet.inputTime;
+
+	RenderFrame();
+}
+
+void VulkanRenderer::RenderFrame()
+{
+	BLITZEN_CPU_PROFILER_ZONE("DrawFrame");
+
+	//A frame that returns before it is submitted reads nothing, so the results of the frame before it are not reported again
+	lastFrameStats.bSubmitted = false;
+	lastFrameStats.bGpuTimeValid = false;
+	lastFrameStats.bCullingStatsValid = false;
+	lastGpuZoneTimings.clear();
+
+	//An application that reads its input after WaitForNextFrame has paced the frame already
+	if (!bFramePaced)
+	{
+		WaitForNextFrame();
+	}
+	bFramePaced = false;
+
+	//The join point of the pipeline jobs, nothing before this records commands that use the pipelines
+	if (!WaitForPipelines())
+	{
+		//Nothing is in flight, so a reload can still fix the shaders that failed and start the drawing
+		UpdateShaderHotReload();
+		return;
+	}
+
+	//The swapchain is replaced between frames, while the window is minimized nothing is drawn
+	if (!rendererSettings.bHeadless && (bFramebufferResized || bSwapchainOutOfDate) && 
+		!RecreateSwapchain())
+	{
+		return;
+	}
+
 	/*
-	The cpu waits for the previous frame to signal the fence and resets it
-	when it gets the signal. We should not face a deadlock here as the fence
-	was initialized to be in the signaled state
+	The cpu waits until the gpu is done with the last frame that used these frame tools, which signalled 
+	the frame timeline with its frame count plus 1. The first frames in flight have nothing to wait for. 
+	Skipped frames are not counted, so nothing is waited for that was never submitted
 	*/
-	vkWaitForFences(device, 1, &(frameTools[frameQueue].inFlightFence),
-		VK_TRUE, 1000000000);
-	vkResetFences(device, 1, &(frameTools[frameQueue].inFlightFence));
+	auto frameWaitStart = std::chrono::high_resolution_clock::now();
+	if (frameCount >= rendererSettings.framesInFlight)
+	{
+		BLITZEN_CPU_PROFILER_ZONE("vkWaitSemaphores");
+		uint64_t waitValue = frameCount - rendererSettings.framesInFlight + 1;
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &frameTimelineSemaphore;
+		waitInfo.pValues = &waitValue;
+		//The frame is skipped after a timeout, since its tools are still in use
+		if (vkWaitSemaphores(device, &waitInfo, BLITZEN_VULKAN_FRAME_WAIT_TIMEOUT) != VK_SUCCESS)
+		{
+			return;
+		}
+	}
+	auto frameWaitEnd = std::chrono::high_resolution_clock::now();
+
+	DestroyRetiredSwapchainResources(false);
 
 	/*
 	The next image that can show rendering results is requested from the swapchain
 	When it is found the image available seamphore of this frame is signaled, to allow
-	for rendering to start
+	for rendering to start. A headless renderer has no swapchain and skips this
 	*/
-	uint32_t swapchainImageIndex;
-	vkAcquireNextImageKHR(device, windowInterface.swapchain, 1000000000,
-		frameTools[frameQueue].imageAvailableSeamphore, nullptr, &swapchainImageIndex);
+	uint32_t swapchainImageIndex = 0;
+	if (!rendererSettings.bHeadless)
+	{
+		BLITZEN_CPU_PROFILER_ZONE("vkAcquireNextImageKHR");
+		VkResult acquireResult = vkAcquireNextImageKHR(device, windowInterface.swapchain, BLITZEN_VULKAN_FRAME_WAIT_TIMEOUT,
+			frameTools[frameQueue].imageAvailableSeamphore, VK_NULL_HANDLE, &swapchainImageIndex);
+
+		//Nothing was acquired, so the semaphore is not signalled and the frame is tried again with a new swapchain
+		if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			bSwapchainOutOfDate = true;
+			return;
+		}
+		//A suboptimal image can still be drawn to and presented, the swapchain is replaced after this frame
+		if (acquireResult == VK_SUBOPTIMAL_KHR)
+		{
+			bSwapchainOutOfDate = true;
+		}
+		else if (acquireResult != VK_SUCCESS)
+		{
+			return;
+		}
+	}
+
+	//With the frame done, the timestamps and the draw count of the last frame that used these frame tools are available
+	ReadGpuProfilerResults();
+	ReadCullingStats();
+	frameTools[frameQueue].inputTime = frameInputTime;
+
+	//The gpu time that was just read can change the resolution scale of this frame
+	UpdateDrawExtent();
+
+	//The secondaries of the last frame that used these frame tools are done, so their pools can be reset
+	parallelRecorder.BeginFrame(frameQueue);
+
+	//Pipelines are only swapped between frames, so this frame records with one set of them
+	UpdateShaderHotReload();
 
 	//Records commands for drawing to the frame
-	RecordFrameCommandBuffer(frameTools[frameQueue].
-		renderingCommandBuffer, swapchainImageIndex, drawingImage.image);
+	auto recordStart = std::chrono::high_resolution_clock::now();
+	{
+		BLITZEN_CPU_PROFILER_ZONE("RecordFrameCommandBuffer");
+		resourceTracker.ResetCounters();
+		RecordFrameCommandBuffer(frameTools[frameQueue].
+			renderingCommandBuffer, swapchainImageIndex);
+		lastFrameStats.barrierCount = resourceTracker.GetBarrierCount();
+		lastFrameStats.barrierBatchCount = resourceTracker.GetFlushCount();
+		lastFrameStats.renderGraphPassCount = frameGraph.GetPassCount();
+		lastFrameStats.culledPassCount = frameGraph.GetCulledPassCount();
+		lastFrameStats.asyncComputePassCount = frameGraph.GetAsyncComputePassCount();
+	}
+	auto recordEnd = std::chrono::high_resolution_clock::now();
 
 
 	//With the command buffer recorded, it should now be submitted to the graphics queue
 	/*
 	The wait semaphore info specifies a pipeline stage that should be stopped.
-	Specifically the pipeline should stop before rendering the color attachment's
-	output
+	The swapchain image is first written by the blit that copies the drawing image to it,
+	so everything before it runs without waiting for the display. This also keeps the wait
+	out of the gpu frame time that dynamic resolution scales by
 	*/
 	VkSemaphoreSubmitInfo waitSemaphoreInfo{};
 	VulkanSDKobjects::SemaphoreSubmitInfoInit(waitSemaphoreInfo, 
 		frameTools[frameQueue].imageAvailableSeamphore, 
-		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR);
+		VK_PIPELINE_STAGE_2_BLIT_BIT);
 
-	//The signal seamaphore will stop all pipeline stages before being finished
-	VkSemaphoreSubmitInfo signalSemaphoreInfo{};
-	VulkanSDKobjects::SemaphoreSubmitInfoInit(signalSemaphoreInfo,
-		frameTools[frameQueue].renderFinishedSemahore,
+	//The present of the image waits until every pipeline stage of the frame is finished
+	std::array<VkSemaphoreSubmitInfo, 2> signalSemaphoreInfos{};
+	uint32_t signalSemaphoreCount = 0;
+	if (!rendererSettings.bHeadless)
+	{
+		VulkanSDKobjects::SemaphoreSubmitInfoInit(signalSemaphoreInfos[signalSemaphoreCount++],
+			windowInterface.renderFinishedSemaphores[swapchainImageIndex],
+			VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR);
+	}
+
+	//The frame timeline tells the cpu when these frame tools can be used again
+	VkSemaphoreSubmitInfo& timelineSignalInfo = signalSemaphoreInfos[signalSemaphoreCount++];
+	VulkanSDKobjects::SemaphoreSubmitInfoInit(timelineSignalInfo, frameTimelineSemaphore,
 		VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR);
+	timelineSignalInfo.value = frameCount + 1;
 
 	//Creating a command buffer submit struct as well
 	VkCommandBufferSubmitInfo commandBufferSubmit{};
 	VulkanSDKobjects::CommandBufferSubmitInfoInit(commandBufferSubmit,
 		frameTools[frameQueue].renderingCommandBuffer);
 
-	//The submit info will include the semaphores and command buffers
+	/*
+	The submit info will include the semaphores and command buffers.
+	When headless, there is no swapchain image to wait for or present, 
+	so the submission only waits for uploads, if there are any
+	*/
+	std::array<VkSemaphoreSubmitInfo, 2> waitSemaphoreInfos{};
+	uint32_t waitSemaphoreCount = 0;
+	if (!rendererSettings.bHeadless)
+	{
+		waitSemaphoreInfos[waitSemaphoreCount++] = waitSemaphoreInfo;
+	}
+	//Anything drawn this frame might read uploaded buffers, so every stage waits for the copies
+	if (frameUploadWaitValue != 0)
+	{
+		VkSemaphoreSubmitInfo& uploadWaitInfo = waitSemaphoreInfos[waitSemaphoreCount++];
+		VulkanSDKobjects::SemaphoreSubmitInfoInit(uploadWaitInfo, 
+			uploadManager.GetTimelineSemaphore(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+		uploadWaitInfo.value = frameUploadWaitValue;
+	}
+
 	VkSubmitInfo2 queueSubmitInfo{};
-	VulkanSDKobjects::SubmitInfo2Init(queueSubmitInfo, &waitSemaphoreInfo,
-		&signalSemaphoreInfo, &commandBufferSubmit);
+	VulkanSDKobjects::SubmitInfo2Init(queueSubmitInfo, 
+		waitSemaphoreCount ? waitSemaphoreInfos.data() : nullptr,
+		signalSemaphoreInfos.data(), &commandBufferSubmit,
+		waitSemaphoreCount, signalSemaphoreCount);
 
-	//When the command buffer is submitted the fence of this frame number is signalled
-	vkQueueSubmit2(vkBootstrapObjects.graphicsQueue, 1, &queueSubmitInfo, 
-		frameTools[frameQueue].inFlightFence);
+	//When the command buffer is done the frame timeline reaches the value of this frame
+	auto submitStart = std::chrono::high_resolution_clock::now();
+	{
+		BLITZEN_CPU_PROFILER_ZONE("vkQueueSubmit2");
+		vkQueueSubmit2(vkBootstrapObjects.graphicsQueue, 1, &queueSubmitInfo, VK_NULL_HANDLE);
+	}
+	auto submitEnd = std::chrono::high_resolution_clock::now();
 
 	//Finally the rendering results are presented to the swapchain
-	VkPresentInfoKHR presentInfo{};
-	VulkanSDKobjects::PresentInfoKHRInit(presentInfo, windowInterface.swapchain,
-		&swapchainImageIndex, &(frameTools[frameQueue].renderFinishedSemahore));
-	vkQueuePresentKHR(windowInterface.presentQueue, &presentInfo);
+	if (!rendererSettings.bHeadless)
+	{
+		BLITZEN_CPU_PROFILER_ZONE("vkQueuePresentKHR");
+		VkPresentInfoKHR presentInfo{};
+		VulkanSDKobjects::PresentInfoKHRInit(presentInfo, windowInterface.swapchain,
+			&swapchainImageIndex, &(windowInterface.renderFinishedSemaphores[swapchainImageIndex]));
+
+		//The pacer waits for the id before a later frame reads its input, and the latency is measured until then
+		uint64_t presentId = lastPresentId + 1;
+		VkPresentIdKHR presentIdInfo{};
+		presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+		presentIdInfo.swapchainCount = 1;
+		presentIdInfo.pPresentIds = &presentId;
+		if (vkBootstrapObjects.bPresentWaitEnabled)
+		{
+			presentInfo.pNext = &presentIdInfo;
+			framePacer.RecordInputTime(presentId, frameInputTime);
+			lastPresentId = presentId;
+		}
+
+		VkResult presentResult = vkQueuePresentKHR(windowInterface.presentQueue, &presentInfo);
+		if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR)
+		{
+			bSwapchainOutOfDate = true;
+		}
+	}
+
+	//Saving the cpu timings of this frame
+	lastFrameStats.bSubmitted = true;
+	lastFrameStats.frameWaitTime = std::chrono::duration<double, std::milli>(
+		frameWaitEnd - frameWaitStart).count();
+	lastFrameStats.recordTime = std::chrono::duration<double, std::milli>(
+		recordEnd - recordStart).count();
+	lastFrameStats.submitTime = std::chrono::duration<double, std::milli>(
+		submitEnd - submitStart).count();
 
 	//Add the new frame to the frame count and update the frame queue variable
 	++frameCount;
-	frameQueue = frameCount % BLITZEN_VULKAN_MAX_FRAMES_IN_FLIGHT;
+	frameQueue = static_cast<uint8_t>(frameCount % rendererSettings.framesInFlight);
+}
+
+void VulkanRenderer::ReadGpuProfilerResults()
+{
+	//The clocks drift apart over time, so they are calibrated again every few frames
+	if (frameCount % BLITZEN_VULKAN_GPU_PROFILER_CALIBRATION_INTERVAL == 0)
+	{
+		gpuClockCalibration.Calibrate(device);
+	}
+
+	VulkanGpuProfiler& gpuProfiler = frameTools[frameQueue].gpuProfiler;
+
+	//Nothing new to read for the first frames in flight, or if the results were not ready
+	if (!gpuProfiler.ReadResults(device, vkBootstrapObjects.timestampPeriod, gpuClockCalibration))
+	{
+		return;
+	}
+
+	lastGpuZoneTimings = gpuProfiler.zoneTimings;
+
+	//The first zone always covers the whole frame
+	if (!lastGpuZoneTimings.empty())
+	{
+		lastFrameStats.gpuTime = lastGpuZoneTimings[0].gpuTime;
+		lastFrameStats.bGpuTimeValid = true;
+
+		//Only the passes that scale with the draw extent, the copy to the swapchain can wait for the display
+		double scaledGpuTime = GetGpuZoneTime(BLITZEN_VULKAN_RESOLUTION_SCALE_ZONE);
+		resolutionScaler.AddGpuFrameTime(scaledGpuTime >= 0.0 ? scaledGpuTime : lastFrameStats.gpuTime);
+
+		ReadInputLatency();
+	}
+}
+
+void VulkanRenderer::UpdateDrawExtent()
+{
+	drawExtent = resolutionScaler.GetScaledExtent(nativeDrawExtent);
+
+	//Culling keeps mapping the screen onto the whole pyramid, so the pyramid is built from the drawn corner alone
+	depthPyramid.SetDrawnExtent(drawExtent);
+
+	lastFrameStats.drawExtent = drawExtent;
+	lastFrameStats.resolutionScale = resolutionScaler.GetScale();
+}
+
+void VulkanRenderer::ReadInputLatency()
+{
+	//Present wait measures until the frame is shown, which is closer to what the user sees
+	if (lastFrameStats.inputLatencySource == VulkanLatencySource::PresentWait || 
+		!gpuClockCalibration.bCalibrated)
+	{
+		return;
+	}
+
+	//Nothing used these frame tools before the first frames in flight
+	std::chrono::steady_clock::time_point inputTime = frameTools[frameQueue].inputTime;
+	if (inputTime.time_since_epoch().count() == 0)
+	{
+		return;
+	}
+
+	double inputTimeMs = std::chrono::duration<double, std::milli>(inputTime.time_since_epoch()).count();
+	lastFrameStats.inputLatency = lastGpuZoneTimings[0].cpuTimelineEnd - inputTimeMs;
+	lastFrameStats.inputLatencySource = VulkanLatencySource::GpuTimestamps;
+}
+
+void VulkanRenderer::WaitForNextFrame()
+{
+	BLITZEN_CPU_PROFILER_ZONE("WaitForNextFrame");
+
+	auto pacingStart = std::chrono::steady_clock::now();
+
+	/*
+	Waiting for an earlier present keeps the display queue short, so the input that is read next is 
+	shown sooner. Ids that the current swapchain did not present are never waited for, and neither is 
+	a swapchain that is about to be replaced, since its presents might never complete
+	*/
+	uint32_t maxQueuedPresents = rendererSettings.maxQueuedPresents;
+	if (!rendererSettings.bHeadless && framePacer.IsPresentWaitEnabled() && !bSwapchainOutOfDate &&
+		maxQueuedPresents != 0 && lastPresentId + 1 >= firstSwapchainPresentId + maxQueuedPresents)
+	{
+		BLITZEN_CPU_PROFILER_ZONE("vkWaitForPresentKHR");
+		uint64_t waitPresentId = lastPresentId + 1 - maxQueuedPresents;
+		if (framePacer.WaitForPresent(windowInterface.swapchain, waitPresentId, BLITZEN_VULKAN_FRAME_WAIT_TIMEOUT))
+		{
+			//The wait can return a little after the present, if it was already shown before the wait started
+			double latency = framePacer.GetLatency(waitPresentId, std::chrono::steady_clock::now());
+			if (latency >= 0.0)
+			{
+				lastFrameStats.inputLatency = latency;
+				lastFrameStats.inputLatencySource = VulkanLatencySource::PresentWait;
+			}
+		}
+	}
+
+	{
+		BLITZEN_CPU_PROFILER_ZONE("FrameLimiter");
+		framePacer.WaitForDeadline();
+	}
+
+	//Everything after this is input for the frame, its latency is measured from here
+	frameInputTime = std::chrono::steady_clock::now();
+	lastFrameStats.pacingWaitTime = std::chrono::duration<double, std::milli>(
+		frameInputTime - pacingStart).count();
+	bFramePaced = true;
+}
+
+void VulkanRenderer::ReadCullingStats()
+{
+	VulkanFrameTools& currentFrameTools = frameTools[frameQueue];
+	if (!currentFrameTools.bCullingStatsWritten)
+	{
+		return;
+	}
+
+	//Readback memory is not always coherent, so the cpu's view of it has to be invalidated first
+	vmaInvalidateAllocation(allocator, currentFrameTools.cullingStatsReadbackBuffer.allocation,
+		0, VK_WHOLE_SIZE);
+	//The early and the late phase each copied the draw count of every slice
+	uint32_t* pDrawCounts = reinterpret_cast<uint32_t*>(
+		currentFrameTools.cullingStatsReadbackBuffer.allocationInfo.pMappedData);
+	uint32_t drawnObjectCount = 0;
+	for (uint32_t i = 0; i < 2 * indirectDrawData.drawSliceCount; ++i)
+	{
+		drawnObjectCount += pDrawCounts[i];
+	}
+
+	//Records of meshes that did not fit in the geometry arena are counted as culled
+	lastFrameStats.drawnObjectCount = drawnObjectCount;
+	lastFrameStats.culledObjectCount = indirectDrawData.drawRecordCount - drawnObjectCount;
+	lastFrameStats.bCullingStatsValid = true;
+}
+
+double VulkanRenderer::GetGpuZoneTime(const char* zoneName) const
+{
+	for (const VulkanGpuZoneTiming& timing : lastGpuZoneTimings)
+	{
+		if (!strcmp(timing.name, zoneName))
+		{
+			return timing.gpuTime;
+		}
+	}
+
+	return -1.0;
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "VulkanResolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+void VulkanResolutionScaler::Init(float newMinScale, float newMaxScale, uint32_t newSettleFrameCount)
+{
+	maxScale = std::clamp(newMaxScale, BLITZEN_VULKAN_MIN_RESOLUTION_SCALE, 1.f);
+	minScale = std::clamp(newMinScale, BLITZEN_VULKAN_MIN_RESOLUTION_SCALE, maxScale);
+	scale = maxScale;
+	settleFrameCount = newSettleFrameCount;
+
+	ResetHistory();
+}
+
+void VulkanResolutionScaler::SetFrameBudget(double gpuFrameBudget)
+{
+	frameBudget = gpuFrameBudget > 0.0 ? gpuFrameBudget : 0.0;
+
+	//Without a budget there is nothing to scale for
+	if (frameBudget == 0.0)
+	{
+		scale = maxScale;
+	}
+
+	ResetHistory();
+}
+
+bool VulkanResolutionScaler::AddGpuFrameTime(double gpuTime)
+{
+	if (frameBudget == 0.0)
+	{
+		return false;
+	}
+
+	if (framesToSettle)
+	{
+		--framesToSettle;
+		return false;
+	}
+
+	gpuTimes[nextGpuTime] = gpuTime;
+	nextGpuTime = (nextGpuTime + 1) % BLITZEN_VULKAN_RESOLUTION_SCALE_HISTORY;
+	gpuTimeCount = std::min(gpuTimeCount + 1, static_cast<uint32_t>(BLITZEN_VULKAN_RESOLUTION_SCALE_HISTORY));
+	if (gpuTimeCount < BLITZEN_VULKAN_RESOLUTION_SCALE_HISTORY)
+	{
+		return false;
+	}
+
+	double averageGpuTime = 0.0;
+	for (double time : gpuTimes)
+	{
+		averageGpuTime += time;
+	}
+	averageGpuTime /= BLITZEN_VULKAN_RESOLUTION_SCALE_HISTORY;
+
+	//Inside of the band the scale is kept
+	double lowerThreshold = frameBudget * BLITZEN_VULKAN_RESOLUTION_SCALE_HEADROOM;
+	if (averageGpuTime <= frameBudget && averageGpuTime >= lowerThreshold)
+	{
+		return false;
+	}
+
+	//Aims for the middle of the band, so the next average lands inside of it
+	double targetGpuTime = (frameBudget + lowerThreshold) * 0.5;
+	float targetScale = scale * static_cast<float>(std::sqrt(targetGpuTime / std::max(averageGpuTime, 0.001)));
+	targetScale = std::clamp(targetScale, scale - BLITZEN_VULKAN_RESOLUTION_SCALE_MAX_STEP,
+		scale + BLITZEN_VULKAN_RESOLUTION_SCALE_MAX_STEP);
+	targetScale = std::clamp(targetScale, minScale, maxScale);
+
+	//At one of the bounds, the window keeps sliding until the frames get back inside of the band
+	if (std::abs(targetScale - scale) < 0.01f)
+	{
+		return false;
+	}
+
+	scale = targetScale;
+	ResetHistory();
+	framesToSettle = settleFrameCount;
+	return true;
+}
+
+VkExtent2D VulkanResolutionScaler::GetScaledExtent(VkExtent2D nativeExtent) const
+{
+	auto scaleSide = [this](uint32_t nativeSide)
+	{
+		uint32_t scaledSide = static_cast<uint32_t>(static_cast<float>(nativeSide) * scale);
+		scaledSide -= scaledSide % BLITZEN_VULKAN_RESOLUTION_SCALE_ALIGNMENT;
+		return std::clamp(scaledSide, std::min(nativeSide, BLITZEN_VULKAN_RESOLUTION_SCALE_ALIGNMENT), nativeSide);
+	};
+
+	//The full scale is kept exact, rounding it down would blit a native extent that is not a multiple of the alignment
+	if (scale >= 1.f)
+	{
+		return nativeExtent;
+	}
+
+	return { scaleSide(nativeExtent.width), scaleSide(nativeExtent.height) };
+}
+
+void VulkanResolutionScaler::ResetHistory()
+{
+	gpuTimeCount = 0;
+	nextGpuTime = 0;
+	framesToSettle = 0;
+}
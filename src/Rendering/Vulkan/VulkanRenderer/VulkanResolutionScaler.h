@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+//The resolution scaler is a standalone class, it only needs the Vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+
+
+
+//How many gpu frame times are averaged before the scale is changed
+#define BLITZEN_VULKAN_RESOLUTION_SCALE_HISTORY			8
+
+//The scale only goes up once the average gpu time is below this part of the budget
+#define BLITZEN_VULKAN_RESOLUTION_SCALE_HEADROOM		0.85
+
+//The most that one change moves the scale, so that one slow frame does not drop the resolution all at once
+#define BLITZEN_VULKAN_RESOLUTION_SCALE_MAX_STEP		0.1f
+
+//Scaled extents are rounded down to a multiple of this, so that small changes in the scale do not resize every frame
+#define BLITZEN_VULKAN_RESOLUTION_SCALE_ALIGNMENT		8u
+
+//No scale goes below this, the depth pyramid and the upscale blit need something to work with
+#define BLITZEN_VULKAN_MIN_RESOLUTION_SCALE				0.25f
+
+
+
+
+/*-------------------------------------------------------------------------------------
+Picks the resolution scale of the draw extent from the gpu time of recent frames, so
+that the gpu stays within a frame budget. The cost of a frame grows with its pixel count,
+which is the square of the scale, so the scale moves by the square root of how far the
+average is from the budget. Two thresholds leave a band where the scale is kept, and
+after a change the frames that were already in flight with the old scale are not
+counted, so the scale does not swing back and forth
+---------------------------------------------------------------------------------------*/
+class VulkanResolutionScaler
+{
+public:
+
+	/*
+	The scale stays between the bounds, which are clamped from BLITZEN_VULKAN_MIN_RESOLUTION_SCALE to 1.
+	The settle frame count is how many gpu times after a change still belong to frames with the old scale
+	*/
+	void Init(float minScale, float maxScale, uint32_t settleFrameCount);
+
+	//The gpu time of a frame in milliseconds that the scale aims for, 0 keeps the scale at the upper bound
+	void SetFrameBudget(double gpuFrameBudget);
+
+	inline double GetFrameBudget() const { return frameBudget; }
+
+	inline float GetScale() const { return scale; }
+
+	//Adds the gpu time of a finished frame, returns true if the scale changed
+	bool AddGpuFrameTime(double gpuTime);
+
+	//The native extent at the current scale, never larger than the native extent and never 0
+	VkExtent2D GetScaledExtent(VkExtent2D nativeExtent) const;
+
+private:
+
+	//Forgets the gpu times of the old scale
+	void ResetHistory();
+
+private:
+
+	float minScale = 1.f;
+	float maxScale = 1.f;
+	float scale = 1.f;
+
+	double frameBudget = 0.0;
+
+	std::array<double, BLITZEN_VULKAN_RESOLUTION_SCALE_HISTORY> gpuTimes{};
+	uint32_t gpuTimeCount = 0;
+	uint32_t nextGpuTime = 0;
+
+	uint32_t settleFrameCount = 0;
+	uint32_t framesToSettle = 0;
+};
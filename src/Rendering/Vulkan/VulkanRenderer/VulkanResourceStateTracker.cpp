@@ -0,0 +1,172 @@
+#include "VulkanResourceStateTracker.h"
+
+//Every access that changes the memory of a resource, a use with any of them is a write
+#define BLITZEN_VULKAN_WRITE_ACCESS_MASK	(VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | \
+	VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | \
+	VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT)
+
+void VulkanResourceStateTracker::UseImage(const VkImage& image, VkImageAspectFlags aspectMask,
+	VulkanResourceState& state, VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask,
+	VkImageLayout layout, bool bDiscard /* =false */)
+{
+	VkPipelineStageFlags2 srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 srcAccessMask = VK_ACCESS_2_NONE;
+	VkImageLayout oldLayout = state.layout;
+	if (!TransitionState(state, stageMask, accessMask, layout, bDiscard, srcStageMask, srcAccessMask, oldLayout))
+	{
+		return;
+	}
+
+	/*
+	The pass uses the image more than once. The barrier that is already there waits for everything
+	before the pass, so only the stages that the pass uses it in are added
+	*/
+	if (state.pendingBarrier != UINT32_MAX)
+	{
+		VkImageMemoryBarrier2& pendingBarrier = imageBarriers[state.pendingBarrier];
+		pendingBarrier.dstStageMask |= stageMask;
+		pendingBarrier.dstAccessMask |= accessMask;
+		return;
+	}
+
+	VkImageMemoryBarrier2 imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	imageBarrier.srcStageMask = srcStageMask;
+	imageBarrier.srcAccessMask = srcAccessMask;
+	imageBarrier.dstStageMask = stageMask;
+	imageBarrier.dstAccessMask = accessMask;
+	imageBarrier.oldLayout = oldLayout;
+	imageBarrier.newLayout = layout;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = image;
+	imageBarrier.subresourceRange.aspectMask = aspectMask;
+	imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+	state.pendingBarrier = static_cast<uint32_t>(imageBarriers.size());
+	imageBarriers.push_back(imageBarrier);
+	pendingStates.push_back(&state);
+}
+
+void VulkanResourceStateTracker::UseBuffer(const VkBuffer& buffer, VulkanResourceState& state,
+	VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask)
+{
+	VkPipelineStageFlags2 srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 srcAccessMask = VK_ACCESS_2_NONE;
+	VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (!TransitionState(state, stageMask, accessMask, VK_IMAGE_LAYOUT_UNDEFINED, false,
+		srcStageMask, srcAccessMask, oldLayout))
+	{
+		return;
+	}
+
+	if (state.pendingBarrier != UINT32_MAX)
+	{
+		VkBufferMemoryBarrier2& pendingBarrier = bufferBarriers[state.pendingBarrier];
+		pendingBarrier.dstStageMask |= stageMask;
+		pendingBarrier.dstAccessMask |= accessMask;
+		return;
+	}
+
+	VkBufferMemoryBarrier2 bufferBarrier{};
+	bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	bufferBarrier.srcStageMask = srcStageMask;
+	bufferBarrier.srcAccessMask = srcAccessMask;
+	bufferBarrier.dstStageMask = stageMask;
+	bufferBarrier.dstAccessMask = accessMask;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = buffer;
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+
+	state.pendingBarrier = static_cast<uint32_t>(bufferBarriers.size());
+	bufferBarriers.push_back(bufferBarrier);
+	pendingStates.push_back(&state);
+}
+
+void VulkanResourceStateTracker::FlushBarriers(const VkCommandBuffer& commandBuffer)
+{
+	if (imageBarriers.empty() && bufferBarriers.empty())
+	{
+		return;
+	}
+
+	VkDependencyInfo barrierDependency{};
+	barrierDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	barrierDependency.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+	barrierDependency.pImageMemoryBarriers = imageBarriers.data();
+	barrierDependency.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+	barrierDependency.pBufferMemoryBarriers = bufferBarriers.data();
+	vkCmdPipelineBarrier2(commandBuffer, &barrierDependency);
+
+	barrierCount += static_cast<uint32_t>(imageBarriers.size() + bufferBarriers.size());
+	++flushCount;
+
+	for (VulkanResourceState* pState : pendingStates)
+	{
+		pState->pendingBarrier = UINT32_MAX;
+	}
+	pendingStates.clear();
+	imageBarriers.clear();
+	bufferBarriers.clear();
+}
+
+void VulkanResourceStateTracker::ResetState(VulkanResourceState& state, VkPipelineStageFlags2 availableStages,
+	VkImageLayout layout /* =VK_IMAGE_LAYOUT_UNDEFINED */)
+{
+	state = VulkanResourceState();
+	state.layout = layout;
+	state.writeStages = availableStages;
+}
+
+bool VulkanResourceStateTracker::TransitionState(VulkanResourceState& state, VkPipelineStageFlags2 stageMask,
+	VkAccessFlags2 accessMask, VkImageLayout layout, bool bDiscard,
+	VkPipelineStageFlags2& srcStageMask, VkAccessFlags2& srcAccessMask, VkImageLayout& oldLayout)
+{
+	bool bWrite = (accessMask & BLITZEN_VULKAN_WRITE_ACCESS_MASK) != 0;
+	bool bTransition = layout != state.layout || (bDiscard && layout != VK_IMAGE_LAYOUT_UNDEFINED);
+	oldLayout = bDiscard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+
+	/*
+	Writes and transitions wait for every earlier use, since an earlier read must not see what they change.
+	Only the earlier writes have to be made available, the reads need an execution dependency alone
+	*/
+	if (bWrite || bTransition)
+	{
+		srcStageMask = state.writeStages | state.readStages;
+		srcAccessMask = state.writeAccess;
+
+		state.layout = layout;
+		state.writeStages = stageMask;
+		state.writeAccess = accessMask & BLITZEN_VULKAN_WRITE_ACCESS_MASK;
+		state.readStages = VK_PIPELINE_STAGE_2_NONE;
+
+		//A transition alone is visible to the stages that waited for it, a write is not visible anywhere yet
+		state.visibleStages = bWrite ? VK_PIPELINE_STAGE_2_NONE : stageMask;
+		state.visibleAccess = bWrite ? VK_ACCESS_2_NONE : accessMask;
+		if (!bWrite)
+		{
+			state.readStages = stageMask;
+		}
+
+		//The first write to a resource that nothing used yet needs no barrier
+		return bTransition || srcStageMask != VK_PIPELINE_STAGE_2_NONE;
+	}
+
+	state.readStages |= stageMask;
+
+	//Reads after reads, or of something that was already made visible to them, do not wait
+	if (state.writeStages == VK_PIPELINE_STAGE_2_NONE ||
+		((state.visibleStages & stageMask) == stageMask && (state.visibleAccess & accessMask) == accessMask))
+	{
+		return false;
+	}
+
+	srcStageMask = state.writeStages;
+	srcAccessMask = state.writeAccess;
+	state.visibleStages |= stageMask;
+	state.visibleAccess |= accessMask;
+	return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//The state tracker is a standalone class, it only needs the Vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+
+
+
+//What the passes so far did with one image or buffer, kept by the owner of the resource
+struct VulkanResourceState
+{
+	//Buffers stay undefined
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	//The stages of the last write or layout transition, and the writes that are not available yet
+	VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+
+	//Where the last write was made visible, reads there need no other barrier
+	VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+
+	//Stages that read since the last write, the next write or transition waits for them
+	VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+
+	//The barrier in the tracker's batch that this resource already has, merged with later uses until the flush
+	uint32_t pendingBarrier = UINT32_MAX;
+};
+
+
+/*-------------------------------------------------------------------------------------
+Turns how each pass uses its images and buffers into the barriers that it needs. A use
+only waits for the stages that last wrote or read the resource, and only makes writes
+visible to the stages and accesses that are going to read them, so passes that share
+nothing can overlap on the gpu. The barriers are collected until FlushBarriers records
+all of them with one vkCmdPipelineBarrier2, which is called once before each pass.
+
+The states outlive the command buffer, so the first use of a frame waits for the last
+use of the frame before it, which the same queue ran earlier
+---------------------------------------------------------------------------------------*/
+class VulkanResourceStateTracker
+{
+public:
+
+	/*
+	Declares that the next pass uses the whole image in these stages, with these accesses and in this layout.
+	A discarded image is transitioned from undefined, the contents it had are not needed. An image can only
+	be used in one layout between two flushes
+	*/
+	void UseImage(const VkImage& image, VkImageAspectFlags aspectMask, VulkanResourceState& state,
+		VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask, VkImageLayout layout, bool bDiscard = false);
+
+	//Declares that the next pass uses the whole buffer in these stages and with these accesses
+	void UseBuffer(const VkBuffer& buffer, VulkanResourceState& state,
+		VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask);
+
+	//Records every barrier that the uses since the last flush need, does nothing if there are none
+	void FlushBarriers(const VkCommandBuffer& commandBuffer);
+
+	/*
+	Starts the state of a resource that something else synchronized, like a swapchain image whose
+	acquire semaphore was waited for in the stages. The next use chains its barrier to those stages
+	*/
+	static void ResetState(VulkanResourceState& state, VkPipelineStageFlags2 availableStages,
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	//How many barriers the last flushes recorded, since the counter was reset
+	inline uint32_t GetBarrierCount() const { return barrierCount; }
+	inline uint32_t GetFlushCount() const { return flushCount; }
+	inline void ResetCounters() { barrierCount = 0; flushCount = 0; }
+
+private:
+
+	/*
+	Updates the state for the use and returns the stages and accesses that the barrier has to wait for,
+	false if the use needs no barrier
+	*/
+	static bool TransitionState(VulkanResourceState& state, VkPipelineStageFlags2 stageMask,
+		VkAccessFlags2 accessMask, VkImageLayout layout, bool bDiscard,
+		VkPipelineStageFlags2& srcStageMask, VkAccessFlags2& srcAccessMask, VkImageLayout& oldLayout);
+
+private:
+
+	std::vector<VkImageMemoryBarrier2> imageBarriers;
+	std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+
+	//The states with a pending barrier, which forget it after the flush
+	std::vector<VulkanResourceState*> pendingStates;
+
+	uint32_t barrierCount = 0;
+	uint32_t flushCount = 0;
+};
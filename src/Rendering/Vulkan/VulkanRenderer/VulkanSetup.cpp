@@ -1,6 +1,8 @@
 #include "VulkanRenderer.h"
 #include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
 
+#include <algorithm>
+
 //Includes the Vulkan Memory Allocator with definitions
 #define VMA_IMPLEMENTATION
 #include "vk_mem_alloc.h"
@@ -25,9 +27,13 @@ void VulkanRenderer::InitGlfwAndSetupWindow()
 	glfwSetWindowUserPointer(windowData.pWindow,
 		reinterpret_cast<void*>(&windowData));
 
+	//The framebuffer can be larger than the window on high dpi monitors, and it is what the swapchain matches
+	glfwGetFramebufferSize(windowData.pWindow, &windowData.width, &windowData.height);
+
 	//The size we're going to render to is the same as the window's size
-	drawExtent.width = windowData.width;
-	drawExtent.height = windowData.height;
+	nativeDrawExtent.width = static_cast<uint32_t>(windowData.width);
+	nativeDrawExtent.height = static_cast<uint32_t>(windowData.height);
+	framebufferExtent = nativeDrawExtent;
 }
 
 
@@ -39,12 +45,17 @@ Objects that use vkBootstrap for initialization to avoid boilerplate code
 
 void VulkanRenderer::VulkanBootstrapHelpersInit()
 {
+	BLITZEN_CPU_PROFILER_ZONE("VulkanBootstrapHelpersInit");
+
 	//Initializing the instance and debug messenger
 	vkb::Instance vkbInstance = CreateInstanceAndDebugMessenger();
 
-	//Initializing the window surface with glfw
-	glfwCreateWindowSurface(vkBootstrapObjects.vulkanInstance,
-		windowData.pWindow, nullptr, &(windowInterface.windowSurface));
+	//Initializing the window surface with glfw, a headless renderer has no window to draw to
+	if (!rendererSettings.bHeadless)
+	{
+		glfwCreateWindowSurface(vkBootstrapObjects.vulkanInstance,
+			windowData.pWindow, nullptr, &(windowInterface.windowSurface));
+	}
 
 	//Picking a physical device and creating a vulkan device based on it
 	vkb::Device vkbDevice = ChoosePhysicalDeviceAndCreateVkDevice(vkbInstance);
@@ -55,7 +66,13 @@ void VulkanRenderer::VulkanBootstrapHelpersInit()
 	GetDeviceQueues(vkbDevice);
 
 	//Initializing the swapchain and retrieving its data
-	SetupSwapchain();
+	if (!rendererSettings.bHeadless)
+	{
+		SetupSwapchain(VK_NULL_HANDLE);
+
+		//The surface can clamp the extent that was asked for, and the copy to the swapchain scales to it
+		nativeDrawExtent = windowInterface.swapchainExtent;
+	}
 }
 
 vkb::Instance VulkanRenderer::CreateInstanceAndDebugMessenger()
@@ -65,7 +82,8 @@ vkb::Instance VulkanRenderer::CreateInstanceAndDebugMessenger()
 	vkbInstanceBuilder.set_app_name("Blitzen Vulkan Renderer")
 		.request_validation_layers(vkBootstrapObjects.bUseValidationLayers) //Validation layers active for debug mode only
 		.use_default_debug_messenger()
-		.require_api_version(1, 3, 0);
+		.require_api_version(1, 3, 0)
+		.set_headless(rendererSettings.bHeadless);//Headless instances do not enable the surface extensions
 
 	//VkbInstance built to initialize instance and debug messenger
 	auto vkbInstanceBuilderResult = vkbInstanceBuilder.build();
@@ -97,6 +115,18 @@ vkb::Device VulkanRenderer::ChoosePhysicalDeviceAndCreateVkDevice(
 		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 	vulkan12Features.bufferDeviceAddress = true;
 	vulkan12Features.descriptorIndexing = true;
+	//Uploads on the transfer queue signal a timeline semaphore that the frames wait on
+	vulkan12Features.timelineSemaphore = true;
+	//The number of draws is written by a compute pass, so the draw call reads it from a buffer
+	vulkan12Features.drawIndirectCount = true;
+	//The depth pyramid is built and sampled with a max reduction sampler
+	vulkan12Features.samplerFilterMinmax = true;
+
+	//Setting desired vulkan 1.1 features, gl_DrawID is used to find the object of an indirect draw
+	VkPhysicalDeviceVulkan11Features vulkan11Features{};
+	vulkan11Features.sType =
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+	vulkan11Features.shaderDrawParameters = true;
 
 	//vkbDeviceSelector built with reference to vkbInstance built earlier
 	vkb::PhysicalDeviceSelector vkbDeviceSelector{ rVkbInstance };
@@ -106,13 +136,38 @@ vkb::Device VulkanRenderer::ChoosePhysicalDeviceAndCreateVkDevice(
 		vkbDeviceSelector.set_minimum_version(1, 3)
 		.set_required_features_13(vulkan13Features)
 		.set_required_features_12(vulkan12Features)
-		.set_surface(windowInterface.windowSurface)//Surface set with reference to VulkanData window surface
+		.set_required_features_11(vulkan11Features)
+		.set_surface(windowInterface.windowSurface)//Surface set with reference to VulkanData window surface (null when headless)
 		.select()
 		.value();
 
 	//Physical device reference from Vulkan data initialized
 	vkBootstrapObjects.gpuHandle = vkbPhysicalDevice.physical_device;
 
+	//Saving the timestamp period to be able to turn timestamp queries to time
+	vkBootstrapObjects.timestampPeriod = vkbPhysicalDevice.properties.limits.timestampPeriod;
+
+	//Calibrated timestamps are optional, they are only used to line up gpu profiler zones with the cpu
+	vkBootstrapObjects.bCalibratedTimestampsEnabled = 
+		vkbPhysicalDevice.enable_extension_if_present(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+
+	//Present wait is optional too, the frame pacer uses it to read input after the last frame is shown
+	if (!rendererSettings.bHeadless)
+	{
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+		presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+		presentIdFeatures.presentId = true;
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+		presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+		presentWaitFeatures.presentWait = true;
+
+		vkBootstrapObjects.bPresentWaitEnabled = 
+			vkbPhysicalDevice.enable_extensions_if_present({ VK_KHR_PRESENT_ID_EXTENSION_NAME, 
+			VK_KHR_PRESENT_WAIT_EXTENSION_NAME }) &&
+			vkbPhysicalDevice.enable_extension_features_if_present(presentIdFeatures) &&
+			vkbPhysicalDevice.enable_extension_features_if_present(presentWaitFeatures);
+	}
+
 	//vkbDeviceBuilder built using previously selected vkbPhysicalDevice
 	vkb::DeviceBuilder vkbDeviceBuilder{ vkbPhysicalDevice };
 	vkb::Device vkbDevice = vkbDeviceBuilder.build().value();
@@ -143,14 +198,39 @@ void VulkanRenderer::GetDeviceQueues(vkb::Device& vkbDevice)
 	vkBootstrapObjects.graphicsQueueFamilyIndex = 
 		vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 
-	//Initializing the present queue family index and the present queue
-	windowInterface.presentQueue = vkbDevice.get_queue(
-		vkb::QueueType::present).value();
-	windowInterface.presentQueueIndex = vkbDevice.get_queue_index(
-		vkb::QueueType::present).value();
+	//Timestamps can only be written if the graphics queue has valid timestamp bits
+	vkBootstrapObjects.timestampValidBits = vkbDevice.queue_families[
+		vkBootstrapObjects.graphicsQueueFamilyIndex].timestampValidBits;
+	vkBootstrapObjects.bTimestampsSupported = vkBootstrapObjects.timestampValidBits > 0;
+
+	/*
+	Uploads go to a queue of a separate transfer family, so that they can run next to rendering.
+	If the device does not have one, the graphics queue is used for uploads as well
+	*/
+	auto transferQueue = vkbDevice.get_queue(vkb::QueueType::transfer);
+	auto transferQueueIndex = vkbDevice.get_queue_index(vkb::QueueType::transfer);
+	if (transferQueue.has_value() && transferQueueIndex.has_value())
+	{
+		vkBootstrapObjects.transferQueue = transferQueue.value();
+		vkBootstrapObjects.transferQueueFamilyIndex = transferQueueIndex.value();
+	}
+	else
+	{
+		vkBootstrapObjects.transferQueue = vkBootstrapObjects.graphicsQueue;
+		vkBootstrapObjects.transferQueueFamilyIndex = vkBootstrapObjects.graphicsQueueFamilyIndex;
+	}
+
+	//Initializing the present queue family index and the present queue, a headless renderer never presents
+	if (!rendererSettings.bHeadless)
+	{
+		windowInterface.presentQueue = vkbDevice.get_queue(
+			vkb::QueueType::present).value();
+		windowInterface.presentQueueIndex = vkbDevice.get_queue_index(
+			vkb::QueueType::present).value();
+	}
 }
 
-void VulkanRenderer::SetupSwapchain()
+bool VulkanRenderer::SetupSwapchain(const VkSwapchainKHR& oldSwapchain)
 {
 	vkb::SwapchainBuilder vkSwapBuilder{ vkBootstrapObjects.gpuHandle,
 		device, windowInterface.windowSurface };
@@ -158,29 +238,61 @@ void VulkanRenderer::SetupSwapchain()
 	//Setting the desired image format
 	windowInterface.swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
 
+	/*
+	Mailbox and immediate both present without waiting for a full queue of frames, so each is the 
+	fallback of the other. Fifo is the last fallback, since every surface has to support it
+	*/
+	vkSwapBuilder.set_desired_present_mode(rendererSettings.presentMode);
+	if (rendererSettings.presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+	{
+		vkSwapBuilder.add_fallback_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR);
+	}
+	else if (rendererSettings.presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+	{
+		vkSwapBuilder.add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR);
+	}
+	vkSwapBuilder.add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+
 	//Building the vkb swapchain so that the swapchain data can be retrieved
-	vkb::Swapchain vkbSwapchain =
+	auto vkbSwapchainResult =
 		vkSwapBuilder.set_desired_format(VkSurfaceFormatKHR{ 
 		windowInterface.swapchainImageFormat,
 		VK_COLOR_SPACE_SRGB_NONLINEAR_KHR }) //Setting the desrired surface format
-		//Setting the present mode to be limited to the speed of the monitor
-		.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
 		//Setting the extent to our window's width and height
-		.set_desired_extent(windowData.width, windowData.height)
+		.set_desired_extent(framebufferExtent.width, framebufferExtent.height)
 		.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-		.build().value();
+		//The images of the old swapchain that are not being presented can be reused by the new one
+		.set_old_swapchain(oldSwapchain)
+		.build();
+	if (!vkbSwapchainResult)
+	{
+		return false;
+	}
+	vkb::Swapchain& vkbSwapchain = vkbSwapchainResult.value();
 
 	//VkSwapchain reference from VulkanData initialized
 	windowInterface.swapchain = vkbSwapchain.swapchain;
 
 	//SwapchainExtent reference from VulkanData initialized
 	windowInterface.swapchainExtent = vkbSwapchain.extent;
+	windowInterface.presentMode = vkbSwapchain.present_mode;
 
 	//SwapchainImageViews reference from VulkanData initialized
 	windowInterface.swapchainImageViews = vkbSwapchain.get_image_views().value();
 
 	//SwapchainImages reference from VulkanData initialized
 	windowInterface.swapchainImages = vkbSwapchain.get_images().value();
+
+	//The semaphores of the old swapchain are retired with it, so every image gets a new one
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	VulkanSDKobjects::SemaphoreCreateInfoInit(semaphoreInfo);
+	windowInterface.renderFinishedSemaphores.resize(windowInterface.swapchainImages.size());
+	for (VkSemaphore& renderFinishedSemaphore : windowInterface.renderFinishedSemaphores)
+	{
+		vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore);
+	}
+
+	return true;
 }
 
 
@@ -190,14 +302,12 @@ The setup functions after this do not use VkBootstrap
 -------------------------------------------------------*/
 
 
-void VulkanRenderer::AllocateDrawingImage()
+void VulkanRenderer::AllocateDrawingImage(VkExtent2D extent)
 {
-	drawingImage.extent =
-	{
-		static_cast<uint32_t>(windowData.width),
-		static_cast<uint32_t>(windowData.height),
-		1
-	};
+	BLITZEN_CPU_PROFILER_ZONE("AllocateDrawingImage");
+
+	drawingImage.extent = { extent.width, extent.height, 1 };
+	drawingImage.state = VulkanResourceState();
 
 	//Draw data in 64bit format
 	drawingImage.format = VK_FORMAT_R16G16B16A16_SFLOAT;
@@ -231,23 +341,47 @@ void VulkanRenderer::AllocateDrawingImage()
 	vkCreateImageView(device, &imageViewInfo, nullptr, &drawingImage.imageView);
 }
 
+void VulkanRenderer::AllocateDepthImage()
+{
+	BLITZEN_CPU_PROFILER_ZONE("AllocateDepthImage");
+
+	//Dynamic resolution draws to a corner of it, which the depth pyramid is built from
+	depthImage.extent = { nativeDrawExtent.width, nativeDrawExtent.height, 1 };
+	depthImage.state = VulkanResourceState();
+	depthImage.format = VK_FORMAT_D32_SFLOAT;
+
+	//The depth pyramid samples the depth image after the early geometry pass
+	VkImageCreateInfo imageInfo{};
+	VulkanSDKobjects::ImageCreateInfoInit(imageInfo, depthImage.extent, depthImage.format,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
+	VmaAllocationCreateInfo vmaAllocationInfo{};
+	vmaAllocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	vmaAllocationInfo.requiredFlags = VkMemoryPropertyFlags(
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	vmaCreateImage(allocator, &imageInfo, &vmaAllocationInfo, &(depthImage.image),
+		&(depthImage.allocation), nullptr);
+
+	VkImageViewCreateInfo imageViewInfo{};
+	VulkanSDKobjects::ImageViewCreateInfoInit(imageViewInfo, depthImage.image,
+		VK_IMAGE_ASPECT_DEPTH_BIT, depthImage.format);
+	vkCreateImageView(device, &imageViewInfo, nullptr, &depthImage.imageView);
+}
+
 
 
 
 
 void VulkanRenderer::VulkanFrameToolsInit()
 {
-	//Creates the command pool for immediate submit commands
-	VkCommandPoolCreateInfo immediateCommandPoolInfo{};
-	VulkanSDKobjects::CommandPoolCreateInfoInit(immediateCommandPoolInfo,
-		vkBootstrapObjects.graphicsQueueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-	vkCreateCommandPool(device, &immediateCommandPoolInfo, nullptr, &immediateSubmitCommandPool);
-
-	//Creates the command buffer for immediate submit commands
-	VkCommandBufferAllocateInfo immediateCommandBufferInfo{};
-	VulkanSDKobjects::CommandBufferAllocInfoInit(immediateCommandBufferInfo, immediateSubmitCommandPool,
-		VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-	vkAllocateCommandBuffers(device, &immediateCommandBufferInfo, &immediateSubmitCommandBuffer);
+	//The upload manager creates its own staging ring and command objects for data copies
+	uploadManager.Init(device, allocator, vkBootstrapObjects.transferQueue,
+		vkBootstrapObjects.transferQueueFamilyIndex, vkBootstrapObjects.graphicsQueueFamilyIndex);
+
+	//The recorder creates a command pool for every job thread and frame in flight
+	parallelRecorder.Init(device, vkBootstrapObjects.graphicsQueueFamilyIndex,
+		rendererSettings.framesInFlight, rendererSettings.recordingSliceCount);
+	frameTools.resize(rendererSettings.framesInFlight);
 
 	/*
 		The command pool in the array have the same functionality,
@@ -264,12 +398,19 @@ void VulkanRenderer::VulkanFrameToolsInit()
 	*/
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	VulkanSDKobjects::SemaphoreCreateInfoInit(semaphoreInfo);
+
 	/*
-	All fence infos will have similar funcionality so we only need one
-	create info struct for their creation
+	One timeline semaphore tells the cpu which frames the graphics queue is done with. 
+	It starts at 0, so the first frames in flight find their frame tools free
 	*/
-	VkFenceCreateInfo fenceInfo{};
-	VulkanSDKobjects::FenceCreateInfoInit(fenceInfo, VK_FENCE_CREATE_SIGNALED_BIT);
+	VkSemaphoreTypeCreateInfo timelineTypeInfo{};
+	timelineTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineTypeInfo.initialValue = 0;
+	VkSemaphoreCreateInfo timelineInfo{};
+	VulkanSDKobjects::SemaphoreCreateInfoInit(timelineInfo);
+	timelineInfo.pNext = &timelineTypeInfo;
+	vkCreateSemaphore(device, &timelineInfo, nullptr, &frameTimelineSemaphore);
 
 	for (size_t i = 0; i < frameTools.size(); ++i)
 	{
@@ -287,14 +428,30 @@ void VulkanRenderer::VulkanFrameToolsInit()
 		vkAllocateCommandBuffers(device, &commandBufferInfo, 
 			&(frameTools[i].renderingCommandBuffer));
 		
-		//Creating the semaphore and the fence
+		//Only a headless renderer never acquires, but the semaphore is cheap enough to always create
 		vkCreateSemaphore(device, &semaphoreInfo, nullptr, 
 			&(frameTools[i].imageAvailableSeamphore));
-		vkCreateSemaphore(device, &semaphoreInfo, nullptr,
-			&(frameTools[i].renderFinishedSemahore));
-		vkCreateFence(device, &fenceInfo, nullptr,
-			&(frameTools[i].inFlightFence));
+
+		frameTools[i].gpuProfiler.Init(device, vkBootstrapObjects.timestampValidBits);
+
+		//The camera is written every frame, so it stays in host visible memory
+		AllocateBuffer(frameTools[i].cameraBuffer, sizeof(VulkanShaderData::GPUCameraData),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			VMA_MEMORY_USAGE_CPU_TO_GPU);
+		frameTools[i].cameraBufferAddress = GetBufferDeviceAddress(frameTools[i].cameraBuffer.buffer);
+
+		//One count for each slice in each of the two culling phases
+		AllocateBuffer(frameTools[i].cullingStatsReadbackBuffer, sizeof(uint32_t) * 2 *
+			parallelRecorder.GetSliceCount(),
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
 	}
+
+	//The profilers share the clock calibration, so that all their zones are on the same timeline
+	gpuClockCalibration.Init(vkBootstrapObjects.vulkanInstance, vkBootstrapObjects.gpuHandle,
+		device, vkBootstrapObjects.bCalibratedTimestampsEnabled);
+
+	framePacer.Init(device, vkBootstrapObjects.bPresentWaitEnabled);
+	framePacer.SetTargetFrameRate(rendererSettings.targetFrameRate);
 }
 
 
@@ -303,93 +460,180 @@ void VulkanRenderer::VulkanFrameToolsInit()
 void VulkanRenderer::AllocateMeshBuffers(BlitzenEngine::VulkanMesh* pMeshes,
 	uint32_t meshCount)
 {
+	BLITZEN_CPU_PROFILER_ZONE("AllocateMeshBuffers");
+
+	/*
+	The arena is made big enough for the meshes that the renderer starts with,
+	with the default capacity left for meshes that might be added later
+	*/
+	uint32_t totalVertexCount = 0;
+	uint32_t totalIndexCount = 0;
+	for (size_t i = 0; i < static_cast<size_t>(meshCount); ++i)
+	{
+		totalVertexCount += static_cast<uint32_t>(pMeshes[i].vertices.size());
+		totalIndexCount += static_cast<uint32_t>(pMeshes[i].indices.size());
+	}
+	geometryArena.Init(device, allocator,
+		std::max(totalVertexCount, BLITZEN_VULKAN_GEOMETRY_ARENA_VERTEX_CAPACITY),
+		std::max(totalIndexCount, BLITZEN_VULKAN_GEOMETRY_ARENA_INDEX_CAPACITY),
+		std::max(meshCount, BLITZEN_VULKAN_GEOMETRY_ARENA_MAX_MESHES));
+
+	//Make space in the mesh ranges array
+	meshRanges.resize(static_cast<size_t>(meshCount));
+
 	//Iterate through all the meshes
 	for (size_t i = 0; i < static_cast<size_t>(meshCount); ++i)
 	{
-		//Make space in the mesh buffers list array
-		meshBuffersList.resize(i + 1);
-		//Allocate the buffers in the current element in the mesh buffers list
-		AllocateGPUMeshBuffers(meshBuffersList[i], pMeshes[i].vertices, pMeshes[i].indices);
+		//Sub-allocate the mesh's vertices and indices and queue their copies to the arena
+		geometryArena.AllocateMesh(pMeshes[i].vertices, pMeshes[i].indices, uploadManager,
+			meshRanges[i]);
+
+		//Saving the data that the draw call is going to need
+		meshRanges[i].instanceCount = pMeshes[i].instanceCount;
 	}
-}
 
-void VulkanRenderer::AllocateGPUMeshBuffers(VulkanShaderData::GPUMeshBuffers& meshBuffers,
-	std::vector<VulkanShaderData::Vertex>& vertices, std::vector<uint32_t>& indices)
-{
-	//Find the size needed for the vertices that the buffer is going to hold
-	VkDeviceSize vertexBufferSize = sizeof(VulkanShaderData::Vertex) * vertices.size();
+	AllocateIndirectDrawBuffers(pMeshes, meshCount);
+
 	/*
-	Allocate a vertex buffer for those vertices using the vma allocator. The buffer is an SSBO, 
-	that will have a staging buffer transfer memory to it at the end of this function. It will also 
-	allow us to get its address in the vertex shader and vma will allocate as a GPU only buffer
+	The copies of all the meshes are submitted together (or in a few batches if the 
+	staging ring fills up). The cpu does not wait for them, the first frame waits on the gpu
 	*/
-	AllocateBuffer(meshBuffers.vertexBuffer, vertexBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY);
+	uploadManager.Flush();
+}
 
-	VkBufferDeviceAddressInfo bufferAddressInfo{};
-	bufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
-	bufferAddressInfo.buffer = meshBuffers.vertexBuffer.buffer;
-	meshBuffers.vertexBufferAddress = vkGetBufferDeviceAddress(device, &bufferAddressInfo);
+void VulkanRenderer::AllocateIndirectDrawBuffers(BlitzenEngine::VulkanMesh* pMeshes,
+	uint32_t meshCount)
+{
+	//The culling pass finds each mesh's part of the geometry arena and its bounds in this
+	std::vector<VulkanShaderData::GPUMeshDrawData> meshDrawData(meshRanges.size());
+	//Every mesh's vertices are walked for its bounds, so the meshes are spread over the job threads
+	BlitzenEngine::JobSystem::ParallelFor(static_cast<uint32_t>(meshRanges.size()), 
+		BLITZEN_VULKAN_MESH_DRAW_DATA_JOB_BATCH_SIZE, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				meshDrawData[i].indexCount = meshRanges[i].indexCount;
+				meshDrawData[i].instanceCount = meshRanges[i].instanceCount;
+				if (meshRanges[i].indexCount != 0)
+				{
+					meshDrawData[i].firstIndex = meshRanges[i].indexAllocation.offset;
+					meshDrawData[i].vertexOffset = static_cast<int32_t>(meshRanges[i].vertexAllocation.offset);
+				}
+
+				meshDrawData[i].boundingSphere = CalculateBoundingSphere(pMeshes[i].vertices);
+			}
+		});
+
+	//For now every mesh is drawn once as its own object, without materials
+	std::vector<VulkanShaderData::GPUDrawRecord> drawRecords(static_cast<size_t>(meshCount));
+	std::vector<glm::mat4> transforms(static_cast<size_t>(meshCount));
+	for (size_t i = 0; i < static_cast<size_t>(meshCount); ++i)
+	{
+		drawRecords[i].meshIndex = static_cast<uint32_t>(i);
+		drawRecords[i].transformIndex = static_cast<uint32_t>(i);
+		transforms[i] = pMeshes[i].modelMatrix;
+	}
+	indirectDrawData.drawRecordCount = meshCount;
+
+	//Every secondary of the geometry passes draws one slice of the records
+	indirectDrawData.drawSliceCount = parallelRecorder.GetSliceCount();
+	indirectDrawData.drawSliceSize = std::max((meshCount + indirectDrawData.drawSliceCount - 1) /
+		indirectDrawData.drawSliceCount, 1u);
+
+	//Buffers can not be empty, so each of them has room for at least one element
+	size_t elementCount = std::max<size_t>(meshCount, 1);
+
+	VkBufferUsageFlags sceneBufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	AllocateBuffer(indirectDrawData.meshDrawDataBuffer, sizeof(VulkanShaderData::GPUMeshDrawData) * 
+		elementCount, sceneBufferUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+	AllocateBuffer(indirectDrawData.drawRecordBuffer, sizeof(VulkanShaderData::GPUDrawRecord) *
+		elementCount, sceneBufferUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+	AllocateBuffer(indirectDrawData.transformBuffer, sizeof(glm::mat4) * elementCount,
+		sceneBufferUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	//Every slice has room for a command for each of its draw records, the last slice might not be full
+	AllocateBuffer(indirectDrawData.indirectDrawBuffer, sizeof(VulkanShaderData::GPUIndirectDrawCommand) *
+		indirectDrawData.drawSliceCount * indirectDrawData.drawSliceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	//The counts are cleared with vkCmdFillBuffer before every culling phase
+	AllocateBuffer(indirectDrawData.drawCountBuffer, sizeof(uint32_t) * indirectDrawData.drawSliceCount,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	indirectDrawData.meshDrawDataBufferAddress = GetBufferDeviceAddress(
+		indirectDrawData.meshDrawDataBuffer.buffer);
+	indirectDrawData.drawRecordBufferAddress = GetBufferDeviceAddress(
+		indirectDrawData.drawRecordBuffer.buffer);
+	indirectDrawData.transformBufferAddress = GetBufferDeviceAddress(
+		indirectDrawData.transformBuffer.buffer);
+	indirectDrawData.indirectDrawBufferAddress = GetBufferDeviceAddress(
+		indirectDrawData.indirectDrawBuffer.buffer);
+	indirectDrawData.drawCountBufferAddress = GetBufferDeviceAddress(
+		indirectDrawData.drawCountBuffer.buffer);
+
+	//Nothing was visible before the first frame, so its late phase is the one that draws everything
+	std::vector<uint32_t> visibility(elementCount, 0);
+	AllocateBuffer(indirectDrawData.visibilityBuffer, sizeof(uint32_t) * elementCount,
+		sceneBufferUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+	indirectDrawData.visibilityBufferAddress = GetBufferDeviceAddress(
+		indirectDrawData.visibilityBuffer.buffer);
+
+	//Copied together with the meshes when the upload manager is flushed
+	uploadManager.UploadToBuffer(meshDrawData.data(), sizeof(VulkanShaderData::GPUMeshDrawData) *
+		meshDrawData.size(), indirectDrawData.meshDrawDataBuffer.buffer);
+	uploadManager.UploadToBuffer(drawRecords.data(), sizeof(VulkanShaderData::GPUDrawRecord) *
+		drawRecords.size(), indirectDrawData.drawRecordBuffer.buffer);
+	uploadManager.UploadToBuffer(transforms.data(), sizeof(glm::mat4) * transforms.size(),
+		indirectDrawData.transformBuffer.buffer);
+	uploadManager.UploadToBuffer(visibility.data(), sizeof(uint32_t) * visibility.size(),
+		indirectDrawData.visibilityBuffer.buffer);
 
-	//Find the size needed for the indices that the buffers is going to hold
-	VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices.size();
 	/*
-	Allocate an index buffer for the indices using the vma allocator. The buffer has the index 
-	buffer bit and also the transfer as it will accept a data transfer at the end of this function
-	from a staging buffer. Vma will initialize it as GPU only
+	Transforms that a render packet changes are written to the staging buffer of the frame and copied 
+	to the transform buffer by its command buffer, after the frames before it are done reading it
 	*/
-	AllocateBuffer(meshBuffers.indexBuffer, indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	for (VulkanFrameTools& tools : frameTools)
+	{
+		AllocateBuffer(tools.transformStagingBuffer, sizeof(glm::mat4) * elementCount,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	}
+}
 
-	/* 
-	Create a staging buffer with enough space for the vertices and indices.
-	It will be used to transfer the data to the actual buffers
-	*/
-	VulkanShaderData::AllocatedBuffer stagingBuffer;
-	AllocateBuffer(stagingBuffer, vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY);
-
-	//Get the memory address of the staging buffer
-	void* data = stagingBuffer.allocation->GetMappedData();
-
-	//Copy the data of the vertices to the void pointer data that was initalized earlier
-	memcpy(data, vertices.data(), vertexBufferSize);
-	//Copy the data of the indices to the indices part of the void pointer
-	memcpy(reinterpret_cast<char*>(data) + vertexBufferSize, indices.data(), indexBufferSize);
-
-	//Begin recording the immediate submit command buffer to copy the data to the actual buffers
-	VkCommandBufferBeginInfo commandBufferBegin{};
-	VulkanSDKobjects::CommandBufferBeginInfoInit(commandBufferBegin, 
-		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-	vkBeginCommandBuffer(immediateSubmitCommandBuffer, &commandBufferBegin);
-
-	//Copy the first part of the staging buffer to the vertex buffer
-	VkBufferCopy vertexBufferCopy{0};
-	VulkanSDKobjects::BufferCopyInit(vertexBufferCopy, vertexBufferSize);
-	vkCmdCopyBuffer(immediateSubmitCommandBuffer, stagingBuffer.buffer, meshBuffers.vertexBuffer.buffer,
-		1, &vertexBufferCopy);
-	
-	//Copy the indices part of the staging buffer to the index buffer
-	VkBufferCopy indexBufferCopy{0};
-	VulkanSDKobjects::BufferCopyInit(indexBufferCopy, indexBufferSize, vertexBufferSize);
-	vkCmdCopyBuffer(immediateSubmitCommandBuffer, stagingBuffer.buffer, meshBuffers.indexBuffer.buffer,
-		1, &indexBufferCopy);
-
-	vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
-
-	vkEndCommandBuffer(immediateSubmitCommandBuffer);
-
-	VkCommandBufferSubmitInfo submitInfo{};
-	VulkanSDKobjects::CommandBufferSubmitInfoInit(submitInfo, immediateSubmitCommandBuffer);
-	VkSubmitInfo2 submitInfo2{};
-	submitInfo2.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-	submitInfo2.commandBufferInfoCount = 1;
-	submitInfo2.pCommandBufferInfos = &submitInfo;
-	vkQueueSubmit2(vkBootstrapObjects.graphicsQueue, 1, &submitInfo2, VK_NULL_HANDLE);
-	vkQueueWaitIdle(vkBootstrapObjects.graphicsQueue);
-
-	vkResetCommandBuffer(immediateSubmitCommandBuffer, 0);
+glm::vec4 VulkanRenderer::CalculateBoundingSphere(
+	const std::vector<VulkanShaderData::Vertex>& vertices)
+{
+	if (vertices.empty())
+	{
+		return glm::vec4(0.f);
+	}
+
+	//The sphere is centered on the bounding box, which is close enough for culling
+	glm::vec3 minPosition = vertices[0].position;
+	glm::vec3 maxPosition = vertices[0].position;
+	for (const VulkanShaderData::Vertex& vertex : vertices)
+	{
+		minPosition = glm::min(minPosition, vertex.position);
+		maxPosition = glm::max(maxPosition, vertex.position);
+	}
+	glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+
+	float radius = 0.f;
+	for (const VulkanShaderData::Vertex& vertex : vertices)
+	{
+		radius = std::max(radius, glm::length(vertex.position - center));
+	}
+
+	return glm::vec4(center, radius);
+}
+
+VkDeviceAddress VulkanRenderer::GetBufferDeviceAddress(const VkBuffer& buffer)
+{
+	VkBufferDeviceAddressInfo bufferAddressInfo{};
+	bufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	bufferAddressInfo.buffer = buffer;
+	return vkGetBufferDeviceAddress(device, &bufferAddressInfo);
 }
 
 void VulkanRenderer::AllocateBuffer(VulkanShaderData::AllocatedBuffer& vertexBuffer,
@@ -412,6 +656,8 @@ void VulkanRenderer::AllocateBuffer(VulkanShaderData::AllocatedBuffer& vertexBuf
 
 void VulkanRenderer::DescriptorsInit()
 {
+	BLITZEN_CPU_PROFILER_ZONE("DescriptorsInit");
+
 	BackgroundShadersDescriptorSetsInit();
 }
 
@@ -442,9 +688,16 @@ void VulkanRenderer::BackgroundShadersDescriptorSetsInit()
 	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 	poolSize.descriptorCount = 10;
 	VkDescriptorPoolCreateInfo poolInfo{};
-	VulkanSDKobjects::DescriptorPoolCreateInfoInit(poolInfo, 10, 1, &poolSize);
+	//The set is allocated again when the drawing image grows, and the old one is freed once its frames are done
+	VulkanSDKobjects::DescriptorPoolCreateInfoInit(poolInfo, 10, 1, &poolSize,
+		VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
 	vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool);
 
+	AllocateBackgroundDescriptorSet();
+}
+
+void VulkanRenderer::AllocateBackgroundDescriptorSet()
+{
 	VkDescriptorSetAllocateInfo descriptorSetInfo{};
 	VulkanSDKobjects::DescriptorSetAllocateInfoInit(descriptorSetInfo,
 		descriptorPool, backgroundDrawingDescriptorSetLayouts.data());
@@ -466,40 +719,142 @@ void VulkanRenderer::BackgroundShadersDescriptorSetsInit()
 
 
 
-void VulkanRenderer::InitPipelines()
+void VulkanRenderer::StartPipelineCompilation()
 {
-	InitGradientComputePipeline();
+	BLITZEN_CPU_PROFILER_ZONE("StartPipelineCompilation");
 
-	//Creates a pipeline that handles drawing basic geometry
-	simpleGeometryGraphicsPipeline.InitBasicGeometryPipeline(device, &(drawingImage.format));
+	//Every pipeline is created through the cache, which starts with what earlier runs compiled
+	pipelineCache.Init(device, vkBootstrapObjects.gpuHandle, rendererSettings.pipelineCacheFilepath);
+
+	//The pipeline jobs create the compute pipelines with the sizes that earlier runs found for this device
+	workgroupTuner.Init(device, vkBootstrapObjects.gpuHandle, vkBootstrapObjects.graphicsQueue,
+		vkBootstrapObjects.graphicsQueueFamilyIndex, vkBootstrapObjects.timestampPeriod,
+		vkBootstrapObjects.bTimestampsSupported, rendererSettings.workgroupTuningFilepath);
+
+	/*
+	If the library can not be opened or a shader fails to compile, the shaders are missing from it,
+	the pipelines that need them fail and WaitForPipelines reports it
+	*/
+	auto shaderStart = std::chrono::high_resolution_clock::now();
+
+	//Watching starts before the first compile, so that edits made while the renderer starts are not missed
+	if (rendererSettings.bCompileShadersAtRuntime && rendererSettings.bShaderHotReload)
+	{
+		shaderWatcher.Init(BLITZEN_VULKAN_SHADER_SOURCE_DIRECTORY);
+	}
+	OpenShaderLibrary();
+	auto shaderEnd = std::chrono::high_resolution_clock::now();
+
+	startupStats.shaderTime = std::chrono::duration<double, std::milli>(shaderEnd - shaderStart).count();
+	startupStats.bShadersCompiledAtRuntime = rendererSettings.bCompileShadersAtRuntime;
+	startupStats.shaderCacheHitCount = shaderLibrary.GetCacheHitCount();
+	startupStats.shaderCompileCount = shaderLibrary.GetCompiledCount();
+	startupStats.shaderErrorLog = shaderLibrary.GetErrorLog();
+
+	/*
+	The driver does most of its work in vkCreate*Pipelines, and pipelines that do not depend on each
+	other can be created on different threads. The cache is synchronized internally, so they all share it
+	*/
+	pipelineStartTime = std::chrono::high_resolution_clock::now();
+	bPipelinesPending = true;
+	BlitzenEngine::JobSystem::Run(CompileGradientPipelineJob, this, &pipelineCompileCounter);
+	BlitzenEngine::JobSystem::Run(CompileCullingPipelinesJob, this, &pipelineCompileCounter);
+	BlitzenEngine::JobSystem::Run(CompileGeometryPipelineJob, this, &pipelineCompileCounter);
 }
 
-void VulkanRenderer::ReadShaderFile(const char* filepath,
-	std::vector<char>& code)
+bool VulkanRenderer::OpenShaderLibrary()
 {
-	// open the file. With cursor at the end
-	std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+	if (rendererSettings.bCompileShadersAtRuntime)
+	{
+		//After startup every shader is in the shader cache, so this only compiles sources that changed since
+		return shaderLibrary.InitFromSources(BLITZEN_VULKAN_SHADER_SOURCE_DIRECTORY,
+			BLITZEN_VULKAN_SHADER_CACHE_DIRECTORY, rendererSettings.shaderDefines);
+	}
 
-	if (!file.is_open()) 
+	//The only file that startup opens for shaders
+	return shaderLibrary.Init(BLITZEN_VULKAN_SHADER_LIBRARY_FILEPATH);
+}
+
+void VulkanRenderer::CompileGradientPipelineJob(void* pData)
+{
+	VulkanRenderer* pRenderer = reinterpret_cast<VulkanRenderer*>(pData);
+	pRenderer->TimePipelineCompile(VulkanStartupPipeline::Gradient, "Gradient",
+		&VulkanRenderer::InitGradientComputePipeline);
+}
+
+void VulkanRenderer::CompileCullingPipelinesJob(void* pData)
+{
+	VulkanRenderer* pRenderer = reinterpret_cast<VulkanRenderer*>(pData);
+
+	//The culling pipeline samples the depth pyramid, so the pyramid is created first
+	pRenderer->TimePipelineCompile(VulkanStartupPipeline::DepthPyramid, "DepthPyramid",
+		&VulkanRenderer::InitDepthPyramid);
+
+	//Creates the compute pipeline that culls draw records and turns the visible ones into indirect draw commands
+	pRenderer->TimePipelineCompile(VulkanStartupPipeline::DrawCulling, "DrawCulling",
+		&VulkanRenderer::InitDrawCullingComputePipeline);
+}
+
+void VulkanRenderer::CompileGeometryPipelineJob(void* pData)
+{
+	VulkanRenderer* pRenderer = reinterpret_cast<VulkanRenderer*>(pData);
+	pRenderer->TimePipelineCompile(VulkanStartupPipeline::Geometry, "Geometry",
+		&VulkanRenderer::InitGeometryPipeline);
+}
+
+void VulkanRenderer::TimePipelineCompile(VulkanStartupPipeline pipeline, const char* pipelineName,
+	bool (VulkanRenderer::*initFunction)())
+{
+	BLITZEN_CPU_PROFILER_ZONE(pipelineName);
+
+	auto compileStart = std::chrono::high_resolution_clock::now();
+	bool bCompiled = (this->*initFunction)();
+	auto compileEnd = std::chrono::high_resolution_clock::now();
+
+	//Each pipeline has its own timing, and WaitForPipelines only reads them after the jobs are joined
+	VulkanPipelineCompileTiming& timing = startupStats.pipelineTimings[static_cast<size_t>(pipeline)];
+	timing.pipelineName = pipelineName;
+	timing.startTime = std::chrono::duration<double, std::milli>(compileStart - pipelineStartTime).count();
+	timing.compileTime = std::chrono::duration<double, std::milli>(compileEnd - compileStart).count();
+	timing.jobThreadIndex = BlitzenEngine::JobSystem::GetThreadIndex();
+	timing.bCompiled = bCompiled;
+}
+
+bool VulkanRenderer::CreateComputePipeline(const char* shaderName, const VkPipelineLayout& pipelineLayout,
+	const VulkanWorkgroupSize& workgroupSize, VkPipeline& pipeline)
+{
+	//Create the shader module from the code in the shader library
+	VkShaderModule shaderModule{};
+	if (shaderLibrary.CreateShaderModule(device, shaderName, shaderModule) != VK_SUCCESS)
 	{
-		__debugbreak();
+		return false;
 	}
 
-	
-	size_t filesize = static_cast<size_t>(file.tellg());
+	//The workgroup size is only known when the pipeline is created
+	VulkanWorkgroupSpecialization specialization;
+	specialization.Init(workgroupSize);
 
-	code.resize(filesize);
+	//Create a shader stage for the shader module
+	VkPipelineShaderStageCreateInfo shaderStage{};
+	VulkanSDKobjects::PipelineShaderStageInit(shaderStage, shaderModule, 
+		VK_SHADER_STAGE_COMPUTE_BIT);
+	shaderStage.pSpecializationInfo = &specialization.info;
 
-	// put file cursor at beginning
-	file.seekg(0);
+	//Create the compute pipeline with the shader stage and the layout
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStage;
+	pipelineInfo.layout = pipelineLayout;
+	VkResult pipelineResult = vkCreateComputePipelines(device, pipelineCache.GetCache(), 1, 
+		&pipelineInfo, nullptr, &pipeline);
 
-	// load the entire file into the buffer
-	file.read(code.data(), filesize);
+	//Get rid of the shader module
+	vkDestroyShaderModule(device, shaderModule, nullptr);
 
-	file.close();
+	return pipelineResult == VK_SUCCESS;
 }
 
-void VulkanRenderer::InitGradientComputePipeline()
+bool VulkanRenderer::InitGradientComputePipeline()
 {
 	//Create a push constant range to pass to the pipeline layout
 	VkPushConstantRange pushConstant{};
@@ -513,31 +868,54 @@ void VulkanRenderer::InitGradientComputePipeline()
 	vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, 
 		&(gradientComputePipeline.pipelineLayout));
 
-	//Read the shader code in byte form
-	std::vector<char> shaderCodeBuffer;
-	ReadShaderFile(BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER_FILEPATH,
-		shaderCodeBuffer);
+	VulkanWorkgroupSize defaultSize;
+	defaultSize.x = BLITZEN_VULKAN_GRADIENT_WORKGROUP_SIZE;
+	defaultSize.y = BLITZEN_VULKAN_GRADIENT_WORKGROUP_SIZE;
+	gradientComputePipeline.workgroupSize = FindTunedWorkgroupSize(BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER,
+		defaultSize);
 
-	//Pass the shader code to a shader module info and create the shader module
-	VkShaderModuleCreateInfo shaderModuleInfo{};
-	VulkanSDKobjects::ShaderModuleCreateInfoInit(shaderModuleInfo,
-		shaderCodeBuffer);
-	VkShaderModule shaderModule{};
-	vkCreateShaderModule(device, &shaderModuleInfo, nullptr, &shaderModule);
+	return CreateComputePipeline(BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER, gradientComputePipeline.pipelineLayout, 
+		gradientComputePipeline.workgroupSize, gradientComputePipeline.computePipeline);
+}
 
-	//Create a shader stage for the shader module
-	VkPipelineShaderStageCreateInfo shaderStage{};
-	VulkanSDKobjects::PipelineShaderStageInit(shaderStage, shaderModule, 
-		VK_SHADER_STAGE_COMPUTE_BIT);
+bool VulkanRenderer::InitDrawCullingComputePipeline()
+{
+	/*
+	All the buffers are passed with their addresses in the push constants, 
+	the only descriptor is the depth pyramid that the late phase samples
+	*/
+	VkPushConstantRange pushConstant{};
+	VulkanSDKobjects::PushConstantRangeInit(pushConstant,
+		sizeof(DrawCullingComputePushConstant), VK_SHADER_STAGE_COMPUTE_BIT);
 
-	//Create the compute pipeline with the shader stage and the layout we created 
-	VkComputePipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-	pipelineInfo.stage = shaderStage;
-	pipelineInfo.layout = gradientComputePipeline.pipelineLayout;
-	vkCreateComputePipelines(device, nullptr, 1, &pipelineInfo, nullptr,
-		&(gradientComputePipeline.computePipeline));
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	VulkanSDKobjects::PipelineLayoutCreateInfoInit(pipelineLayoutInfo,
+		&(depthPyramid.GetSampledDescriptorSetLayout()), 1, &pushConstant, 1);
+	vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr,
+		&(drawCullingComputePipeline.pipelineLayout));
 
-	//Get rid of the shader module
-	vkDestroyShaderModule(device, shaderModule, nullptr);
+	//Culling is not tuned, its cost depends on the scene more than on the workgroup size
+	drawCullingComputePipeline.workgroupSize.x = BLITZEN_VULKAN_DRAW_CULLING_WORKGROUP_SIZE;
+
+	return CreateComputePipeline(BLITZEN_VULKAN_DRAW_CULLING_COMPUTE_SHADER, drawCullingComputePipeline.pipelineLayout,
+		drawCullingComputePipeline.workgroupSize, drawCullingComputePipeline.computePipeline);
+}
+
+bool VulkanRenderer::InitDepthPyramid()
+{
+	VulkanWorkgroupSize defaultSize;
+	defaultSize.x = BLITZEN_VULKAN_DEPTH_PYRAMID_WORKGROUP_SIZE;
+	defaultSize.y = BLITZEN_VULKAN_DEPTH_PYRAMID_WORKGROUP_SIZE;
+
+	VkExtent2D depthExtent = { depthImage.extent.width, depthImage.extent.height };
+	return depthPyramid.Init(device, allocator, depthImage.imageView, depthExtent, shaderLibrary,
+		BLITZEN_VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER, pipelineCache.GetCache(),
+		FindTunedWorkgroupSize(BLITZEN_VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER, defaultSize));
+}
+
+bool VulkanRenderer::InitGeometryPipeline()
+{
+	//Creates a pipeline that handles drawing basic geometry
+	return simpleGeometryGraphicsPipeline.InitBasicGeometryPipeline(device, &(drawingImage.format),
+		depthImage.format, shaderLibrary, pipelineCache.GetCache());
 }
\ No newline at end of file
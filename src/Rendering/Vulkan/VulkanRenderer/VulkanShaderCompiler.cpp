@@ -0,0 +1,462 @@
+#include "VulkanShaderCompiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "VulkanShaderLibraryFormat.h"
+
+#if defined(BLITZEN_RUNTIME_SHADER_COMPILATION)
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+#endif
+
+//The suffixes that tell the stage of a source, in the same order as shaderStages below
+static const char* const shaderStageSuffixes[] = { ".vert.glsl", ".frag.glsl", ".comp.glsl" };
+
+//Returns the index of the stage suffix that the name ends with, or -1
+static int FindShaderStage(const std::string& name)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(shaderStageSuffixes) / sizeof(shaderStageSuffixes[0])); ++i)
+	{
+		size_t suffixLength = strlen(shaderStageSuffixes[i]);
+		if (name.size() > suffixLength &&
+			!name.compare(name.size() - suffixLength, suffixLength, shaderStageSuffixes[i]))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//FNV-1a, added to the hash one field at a time
+static void HashBytes(uint64_t& hash, const void* pData, size_t size)
+{
+	const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+//The length goes in first, so that two fields can never run into each other
+static void HashString(uint64_t& hash, const std::string& string)
+{
+	uint64_t length = string.size();
+	HashBytes(hash, &length, sizeof(length));
+	HashBytes(hash, string.data(), string.size());
+}
+
+static bool ReadTextFile(const std::string& path, std::string& text)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	text = stream.str();
+	return true;
+}
+
+/*
+The paths that an include is looked for at, in order: next to the file that includes it,
+and then in the source directory. The compiler and the cache key resolve includes the same way
+*/
+static void GetIncludeCandidates(const std::string& includerPath, const std::string& headerName,
+	const std::string& sourceDirectory, std::string (&candidates)[2])
+{
+	std::filesystem::path includerDirectory = std::filesystem::path(includerPath).parent_path();
+	candidates[0] = (includerDirectory / headerName).lexically_normal().generic_string();
+	candidates[1] = (std::filesystem::path(sourceDirectory) / headerName).lexically_normal().generic_string();
+}
+
+//Finds the name in every #include "name" or #include <name> line of the text
+static void FindIncludes(const std::string& text, std::vector<std::string>& headerNames)
+{
+	std::istringstream stream(text);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		size_t position = line.find_first_not_of(" \t");
+		if (position == std::string::npos || line[position] != '#')
+		{
+			continue;
+		}
+		position = line.find_first_not_of(" \t", position + 1);
+		if (position == std::string::npos || line.compare(position, 7, "include"))
+		{
+			continue;
+		}
+		position = line.find_first_of("\"<", position + 7);
+		if (position == std::string::npos)
+		{
+			continue;
+		}
+		size_t end = line.find(line[position] == '"' ? '"' : '>', position + 1);
+		if (end != std::string::npos)
+		{
+			headerNames.push_back(line.substr(position + 1, end - position - 1));
+		}
+	}
+}
+
+
+
+
+#if defined(BLITZEN_RUNTIME_SHADER_COMPILATION)
+
+//Serves includes from the files that the cache key was calculated from, so the compiler sees exactly those
+class VulkanShaderSourceIncluder : public glslang::TShader::Includer
+{
+public:
+
+	VulkanShaderSourceIncluder(const std::vector<VulkanShaderSourceFile>& sourceFiles,
+		const std::string& directory)
+		:files(sourceFiles), sourceDirectory(directory) {}
+
+	IncludeResult* includeLocal(const char* headerName, const char* includerName, size_t) override
+	{
+		std::string candidates[2];
+		GetIncludeCandidates(includerName, headerName, sourceDirectory, candidates);
+		for (const std::string& candidate : candidates)
+		{
+			for (const VulkanShaderSourceFile& file : files)
+			{
+				if (file.path == candidate)
+				{
+					return new IncludeResult(file.path, file.text.data(), file.text.size(), nullptr);
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	IncludeResult* includeSystem(const char* headerName, const char* includerName, size_t depth) override
+	{
+		return includeLocal(headerName, includerName, depth);
+	}
+
+	void releaseInclude(IncludeResult* pResult) override
+	{
+		delete pResult;
+	}
+
+private:
+
+	const std::vector<VulkanShaderSourceFile>& files;
+	const std::string& sourceDirectory;
+};
+
+static const EShLanguage shaderStages[] = { EShLangVertex, EShLangFragment, EShLangCompute };
+
+#endif
+
+
+
+
+bool VulkanShaderCompiler::Init(const char* newSourceDirectory, const char* newCacheDirectory,
+	const std::vector<std::string>& newDefines)
+{
+	if (!IsAvailable())
+	{
+		return false;
+	}
+
+#if defined(BLITZEN_RUNTIME_SHADER_COMPILATION)
+	glslang::InitializeProcess();
+#endif
+
+	sourceDirectory = newSourceDirectory;
+	cacheDirectory = newCacheDirectory;
+	defines = newDefines;
+
+	//A define is either NAME or NAME=VALUE
+	preamble.clear();
+	for (const std::string& define : defines)
+	{
+		size_t separator = define.find('=');
+		preamble += "#define " + (separator == std::string::npos ? define :
+			define.substr(0, separator) + " " + define.substr(separator + 1)) + "\n";
+	}
+
+	//If the directory can not be created, every shader is compiled and the cache writes fail quietly
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+
+	bInitialized = true;
+	return true;
+}
+
+void VulkanShaderCompiler::Cleanup()
+{
+#if defined(BLITZEN_RUNTIME_SHADER_COMPILATION)
+	if (bInitialized)
+	{
+		glslang::FinalizeProcess();
+	}
+#endif
+	bInitialized = false;
+}
+
+bool VulkanShaderCompiler::IsAvailable()
+{
+#if defined(BLITZEN_RUNTIME_SHADER_COMPILATION)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void VulkanShaderCompiler::FindShaderSources(std::vector<std::string>& names) const
+{
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry :
+		std::filesystem::directory_iterator(sourceDirectory, error))
+	{
+		std::string name = entry.path().filename().string();
+		if (entry.is_regular_file(error) && FindShaderStage(name) >= 0)
+		{
+			names.push_back(name);
+		}
+	}
+}
+
+bool VulkanShaderCompiler::CompileShader(const std::string& name, VulkanCompiledShader& shader,
+	std::string& errorLog) const
+{
+	if (!bInitialized)
+	{
+		errorLog = name + ": the shader compiler is not available in this build";
+		return false;
+	}
+	if (FindShaderStage(name) < 0)
+	{
+		errorLog = name + ": the name does not end in a known shader stage";
+		return false;
+	}
+
+	std::vector<VulkanShaderSourceFile> files;
+	if (!ReadSourceFiles(name, files, errorLog))
+	{
+		return false;
+	}
+
+	shader.name = name;
+	uint64_t key = CalculateCacheKey(name, files);
+	shader.cacheKey = key;
+	if (LoadCachedShader(key, shader))
+	{
+		return true;
+	}
+
+	if (!RunCompiler(name, files, shader.code, errorLog))
+	{
+		return false;
+	}
+	WriteCachedShader(key, shader.code);
+
+	shader.pCode = shader.code.data();
+	shader.codeSize = shader.code.size() * sizeof(uint32_t);
+	shader.bFromCache = false;
+	return true;
+}
+
+bool VulkanShaderCompiler::ReadSourceFiles(const std::string& name, std::vector<VulkanShaderSourceFile>& files,
+	std::string& errorLog) const
+{
+	VulkanShaderSourceFile source;
+	source.path = (std::filesystem::path(sourceDirectory) / name).lexically_normal().generic_string();
+	if (!ReadTextFile(source.path, source.text))
+	{
+		errorLog = name + ": failed to read " + source.path;
+		return false;
+	}
+	files.push_back(source);
+
+	/*
+	Includes that are not found are left out, they might be behind an #if that is never taken.
+	If the compiler does need one, it reports it
+	*/
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		std::vector<std::string> headerNames;
+		FindIncludes(files[i].text, headerNames);
+		for (const std::string& headerName : headerNames)
+		{
+			std::string candidates[2];
+			GetIncludeCandidates(files[i].path, headerName, sourceDirectory, candidates);
+			for (const std::string& candidate : candidates)
+			{
+				bool bKnown = false;
+				for (const VulkanShaderSourceFile& file : files)
+				{
+					bKnown = bKnown || file.path == candidate;
+				}
+				if (bKnown)
+				{
+					break;
+				}
+
+				VulkanShaderSourceFile include;
+				include.path = candidate;
+				if (ReadTextFile(candidate, include.text))
+				{
+					files.push_back(include);
+					break;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+uint64_t VulkanShaderCompiler::CalculateCacheKey(const std::string& name,
+	const std::vector<VulkanShaderSourceFile>& files) const
+{
+	uint64_t key = 14695981039346656037ull;
+
+	uint32_t fileVersion = BLITZEN_VULKAN_SHADER_CACHE_FILE_VERSION;
+	HashBytes(key, &fileVersion, sizeof(fileVersion));
+#if defined(BLITZEN_RUNTIME_SHADER_COMPILATION)
+	//A new compiler can generate different code from the same source
+	int generatorVersion = glslang::GetSpirvGeneratorVersion();
+	HashBytes(key, &generatorVersion, sizeof(generatorVersion));
+#endif
+
+	//The name decides the stage
+	HashString(key, name);
+
+	uint64_t defineCount = defines.size();
+	HashBytes(key, &defineCount, sizeof(defineCount));
+	for (const std::string& define : defines)
+	{
+		HashString(key, define);
+	}
+
+	//The includes are hashed with the path they were found at, since that is how the compiler finds them
+	for (const VulkanShaderSourceFile& file : files)
+	{
+		HashString(key, file.path);
+		HashString(key, file.text);
+	}
+
+	return key;
+}
+
+std::string VulkanShaderCompiler::GetCacheFilepath(uint64_t key) const
+{
+	char keyString[17];
+	snprintf(keyString, sizeof(keyString), "%016llx", static_cast<unsigned long long>(key));
+	return cacheDirectory + "/" + keyString + ".spv";
+}
+
+bool VulkanShaderCompiler::LoadCachedShader(uint64_t key, VulkanCompiledShader& shader) const
+{
+	if (!shader.cacheFile.Open(GetCacheFilepath(key).c_str()))
+	{
+		return false;
+	}
+
+	const uint8_t* pData = shader.cacheFile.GetData();
+	size_t fileSize = shader.cacheFile.GetSize();
+	const VulkanShaderCacheFileHeader* pHeader = reinterpret_cast<const VulkanShaderCacheFileHeader*>(pData);
+	if (fileSize < sizeof(VulkanShaderCacheFileHeader) + sizeof(uint32_t) ||
+		pHeader->magic != BLITZEN_VULKAN_SHADER_CACHE_FILE_MAGIC ||
+		pHeader->fileVersion != BLITZEN_VULKAN_SHADER_CACHE_FILE_VERSION ||
+		pHeader->key != key || pHeader->codeSize != fileSize - sizeof(VulkanShaderCacheFileHeader) ||
+		pHeader->codeSize % sizeof(uint32_t) ||
+		*reinterpret_cast<const uint32_t*>(pData + sizeof(VulkanShaderCacheFileHeader)) != BLITZEN_SPIRV_MAGIC)
+	{
+		//Compiling again overwrites the broken file
+		shader.cacheFile.Close();
+		return false;
+	}
+
+	shader.pCode = reinterpret_cast<const uint32_t*>(pData + sizeof(VulkanShaderCacheFileHeader));
+	shader.codeSize = static_cast<size_t>(pHeader->codeSize);
+	shader.bFromCache = true;
+	return true;
+}
+
+void VulkanShaderCompiler::WriteCachedShader(uint64_t key, const std::vector<uint32_t>& code) const
+{
+	VulkanShaderCacheFileHeader header{};
+	header.magic = BLITZEN_VULKAN_SHADER_CACHE_FILE_MAGIC;
+	header.fileVersion = BLITZEN_VULKAN_SHADER_CACHE_FILE_VERSION;
+	header.key = key;
+	header.codeSize = code.size() * sizeof(uint32_t);
+
+	//Written to a temporary file first, so that a run that stops in the middle never leaves a broken file behind
+	std::string filepath = GetCacheFilepath(key);
+	std::string temporaryFilepath = filepath + ".tmp";
+	{
+		std::ofstream file(temporaryFilepath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(code.data()), header.codeSize);
+		if (!file.good())
+		{
+			file.close();
+			std::remove(temporaryFilepath.c_str());
+			return;
+		}
+	}
+	std::remove(filepath.c_str());
+	std::rename(temporaryFilepath.c_str(), filepath.c_str());
+}
+
+bool VulkanShaderCompiler::RunCompiler(const std::string& name, const std::vector<VulkanShaderSourceFile>& files,
+	std::vector<uint32_t>& code, std::string& errorLog) const
+{
+#if defined(BLITZEN_RUNTIME_SHADER_COMPILATION)
+	EShLanguage stage = shaderStages[FindShaderStage(name)];
+
+	glslang::TShader shader(stage);
+	const char* pSource = files[0].text.c_str();
+	int sourceLength = static_cast<int>(files[0].text.size());
+	const char* pSourceName = files[0].path.c_str();
+	shader.setStringsWithLengthsAndNames(&pSource, &sourceLength, &pSourceName, 1);
+	shader.setPreamble(preamble.c_str());
+
+	//The same target as the build's glslangValidator --target-env vulkan1.3
+	shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
+	shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+	shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+	VulkanShaderSourceIncluder includer(files, sourceDirectory);
+
+	EShMessages messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+	if (!shader.parse(GetDefaultResources(), 100, false, messages, includer))
+	{
+		errorLog = name + ": " + shader.getInfoLog();
+		return false;
+	}
+
+	glslang::TProgram program;
+	program.addShader(&shader);
+	if (!program.link(messages))
+	{
+		errorLog = name + ": " + program.getInfoLog();
+		return false;
+	}
+
+	glslang::GlslangToSpv(*program.getIntermediate(stage), code);
+	return !code.empty();
+#else
+	//Only the compiler reads the sources and writes the code
+	(void)files;
+	(void)code;
+	errorLog = name + ": the shader compiler is not available in this build";
+	return false;
+#endif
+}
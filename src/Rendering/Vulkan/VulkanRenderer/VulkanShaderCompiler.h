@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "Engine/Files/MappedFile.h"
+
+
+
+
+//Where the GLSL sources are read from at runtime, the build points it at the source tree
+#ifndef BLITZEN_VULKAN_SHADER_SOURCE_DIRECTORY
+	#define BLITZEN_VULKAN_SHADER_SOURCE_DIRECTORY		"VulkanShaders"
+#endif
+
+//Where compiled shaders are kept between runs
+#define BLITZEN_VULKAN_SHADER_CACHE_DIRECTORY			"ShaderCache"
+
+//Written at the start of every cache file
+#define BLITZEN_VULKAN_SHADER_CACHE_FILE_MAGIC			0x43535A42u
+//Part of every cache key, so changing it makes every cached shader compile again
+#define BLITZEN_VULKAN_SHADER_CACHE_FILE_VERSION		1u
+
+
+
+
+//Written in front of the SPIR-V in each cache file, its size keeps the code aligned
+struct VulkanShaderCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t fileVersion;
+
+	//Has to match the key that the file is named after
+	uint64_t key;
+	uint64_t codeSize;
+	uint64_t padding;
+};
+
+
+//A source or a file that it includes, by the path that it was found at
+struct VulkanShaderSourceFile
+{
+	std::string path;
+	std::string text;
+};
+
+/*
+The SPIR-V of one shader. A shader that was found in the cache stays in its mapped
+cache file, one that had to be compiled keeps the code that the compiler returned
+*/
+struct VulkanCompiledShader
+{
+	std::string name;
+
+	//Changes whenever the source, its includes or the defines change
+	uint64_t cacheKey = 0;
+
+	const uint32_t* pCode = nullptr;
+	size_t codeSize = 0;
+
+	bool bFromCache = false;
+
+	BlitzenEngine::MappedFile cacheFile;
+	std::vector<uint32_t> code;
+};
+
+
+/*-----------------------------------------------------------------------------------
+Compiles GLSL to SPIR-V in the process through glslang. The result of each compile is
+written to the cache directory, in a file named after a hash of everything that
+decides the output: the source, the name and content of every file it includes, the
+defines, the shader stage and the compiler version. A shader whose key has a file in
+the cache is mapped from it and never reaches the compiler.
+
+The stage comes from the name of the source, which has to end in .comp.glsl, .vert.glsl
+or .frag.glsl. Includes need GL_GOOGLE_include_directive and are looked up next to the
+file that includes them, and then in the source directory.
+
+The compiler is only available when the build found glslang, which defines
+BLITZEN_RUNTIME_SHADER_COMPILATION. After Init, any thread can compile
+------------------------------------------------------------------------------------*/
+class VulkanShaderCompiler
+{
+public:
+
+	//Returns false if the build has no compiler
+	bool Init(const char* sourceDirectory, const char* cacheDirectory,
+		const std::vector<std::string>& defines);
+
+	void Cleanup();
+
+	//True if the build links glslang
+	static bool IsAvailable();
+
+	//The names of every source in the source directory with a stage that the compiler knows
+	void FindShaderSources(std::vector<std::string>& names) const;
+
+	//Loads the shader from the cache or compiles it. On failure the error log says why
+	bool CompileShader(const std::string& name, VulkanCompiledShader& shader, std::string& errorLog) const;
+
+private:
+
+	//Reads the source and everything it includes, in the order that they are first included
+	bool ReadSourceFiles(const std::string& name, std::vector<VulkanShaderSourceFile>& files, std::string& errorLog) const;
+
+	uint64_t CalculateCacheKey(const std::string& name, const std::vector<VulkanShaderSourceFile>& files) const;
+
+	std::string GetCacheFilepath(uint64_t key) const;
+
+	bool LoadCachedShader(uint64_t key, VulkanCompiledShader& shader) const;
+
+	void WriteCachedShader(uint64_t key, const std::vector<uint32_t>& code) const;
+
+	bool RunCompiler(const std::string& name, const std::vector<VulkanShaderSourceFile>& files,
+		std::vector<uint32_t>& code, std::string& errorLog) const;
+
+private:
+
+	std::string sourceDirectory;
+	std::string cacheDirectory;
+
+	std::vector<std::string> defines;
+	//The defines as lines of #define, given to the compiler before the source
+	std::string preamble;
+
+	bool bInitialized = false;
+};
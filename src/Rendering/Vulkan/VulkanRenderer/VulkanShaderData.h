@@ -19,6 +19,9 @@ renderer to pass data to the shaders
 #include <vector>
 #include <array>
 
+//Meshes hold the ranges that the geometry arena's allocators gave them
+#include "Engine/Memory/OffsetAllocator.h"
+
 
 
 namespace VulkanShaderData
@@ -39,17 +42,74 @@ namespace VulkanShaderData
 		glm::vec4 color;
 	};
 
-	struct GPUMeshBuffers
+	/*
+	The part of the geometry arena that a mesh uses. The offsets of the allocations are the 
+	first vertex and first index of the mesh, in elements and not in bytes
+	*/
+	struct GPUMeshRange
+	{
+		BlitzenEngine::OffsetAllocation vertexAllocation;
+		BlitzenEngine::OffsetAllocation indexAllocation;
+		uint32_t vertexCount = 0;
+
+		//Saved so that the draw call knows how many indices and instances to draw
+		uint32_t indexCount = 0;
+		uint32_t instanceCount = 1;
+	};
+
+	//What a draw command needs to know about a mesh, the culling pass reads these by mesh index
+	struct GPUMeshDrawData
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		int32_t vertexOffset = 0;
+		uint32_t instanceCount = 1;
+
+		//Center in xyz and radius in w, in the mesh's own space
+		glm::vec4 boundingSphere = glm::vec4(0.f);
+	};
+
+	//One object in the scene. Each record becomes at most one indirect draw command
+	struct GPUDrawRecord
+	{
+		uint32_t meshIndex = 0;
+		uint32_t transformIndex = 0;
+		uint32_t materialIndex = 0;
+		uint32_t padding = 0;
+	};
+
+	/*
+	Written by the culling pass. The vertex shader finds its draw record with
+	gl_DrawID, so the record index comes before the command that the gpu reads
+	*/
+	struct GPUIndirectDrawCommand
+	{
+		uint32_t drawRecordIndex;
+		VkDrawIndexedIndirectCommand command;
+	};
+
+	/*
+	The camera of a frame. The frustum planes are taken from the view projection matrix 
+	on the cpu, in the order left, right, bottom, top, near, far, with their normals 
+	pointing inside the frustum
+	*/
+	struct GPUCameraData
 	{
-		AllocatedBuffer vertexBuffer;
-		AllocatedBuffer indexBuffer;
-		VkDeviceAddress vertexBufferAddress;
+		glm::mat4 viewProjection;
+		glm::vec4 frustumPlanes[6];
 	};
 
+	//The vertex shader reads everything through device addresses
 	struct GPUPushConstants
 	{
-		glm::mat4 modelMatrix;
 		VkDeviceAddress vertexBuffer;
+		VkDeviceAddress drawRecordBuffer;
+		VkDeviceAddress transformBuffer;
+		VkDeviceAddress indirectDrawBuffer;
+		VkDeviceAddress cameraBuffer;
+		//Where the slice that is drawn starts in the indirect draw buffer, since gl_DrawID starts at 0 for every draw
+		uint32_t drawCommandOffset;
+		uint32_t padding;
 	};
 
 }
\ No newline at end of file
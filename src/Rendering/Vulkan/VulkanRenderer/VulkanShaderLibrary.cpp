@@ -0,0 +1,295 @@
+#include "VulkanShaderLibrary.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Engine/Profiling/CpuProfiler.h"
+#include "Engine/Jobs/JobSystem.h"
+
+bool VulkanShaderLibrary::Init(const char* filepath)
+{
+	BLITZEN_CPU_PROFILER_ZONE("VulkanShaderLibrary::Init");
+
+	if (!file.Open(filepath))
+	{
+		errorLog = std::string("Failed to open ") + filepath;
+		return false;
+	}
+
+	if (!ValidateLibrary())
+	{
+		errorLog = std::string(filepath) + " is not a valid shader library";
+		file.Close();
+		return false;
+	}
+
+	const ShaderLibraryHeader* pHeader = reinterpret_cast<const ShaderLibraryHeader*>(file.GetData());
+	pEntries = reinterpret_cast<const ShaderLibraryEntry*>(file.GetData() + sizeof(ShaderLibraryHeader));
+	shaderCount = pHeader->shaderCount;
+	return true;
+}
+
+bool VulkanShaderLibrary::InitFromSources(const char* sourceDirectory, const char* cacheDirectory,
+	const std::vector<std::string>& defines)
+{
+	BLITZEN_CPU_PROFILER_ZONE("VulkanShaderLibrary::InitFromSources");
+
+	if (!compiler.Init(sourceDirectory, cacheDirectory, defines))
+	{
+		errorLog = "The shader compiler is not available in this build";
+		return false;
+	}
+
+	std::vector<std::string> names;
+	compiler.FindShaderSources(names);
+	if (names.empty())
+	{
+		errorLog = std::string("No shaders were found in ") + sourceDirectory;
+		return false;
+	}
+
+	std::vector<std::unique_ptr<VulkanCompiledShader>> shaders;
+	bool bSuccess = CompileShaders(names, shaders);
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		if (!shaders[i])
+		{
+			continue;
+		}
+
+		if (shaders[i]->bFromCache)
+		{
+			++cacheHitCount;
+		}
+		else
+		{
+			++compiledCount;
+		}
+		CompiledShaderEntry entry;
+		entry.nameHash = HashShaderName(names[i].data(), names[i].size());
+		entry.pShader = std::move(shaders[i]);
+		compiledShaders.push_back(std::move(entry));
+	}
+	SortCompiledShaders();
+
+	bCompiledFromSources = true;
+	return bSuccess;
+}
+
+bool VulkanShaderLibrary::ReloadShaders(std::vector<std::string>& changedShaders)
+{
+	BLITZEN_CPU_PROFILER_ZONE("VulkanShaderLibrary::ReloadShaders");
+
+	errorLog.clear();
+	if (!bCompiledFromSources)
+	{
+		errorLog = "Only shaders that were compiled from their sources can be reloaded";
+		return false;
+	}
+
+	//Shaders that did not change are cache hits, so compiling all of them again costs little
+	std::vector<std::string> names;
+	compiler.FindShaderSources(names);
+	std::vector<std::unique_ptr<VulkanCompiledShader>> shaders;
+	bool bSuccess = CompileShaders(names, shaders);
+
+	bool bAdded = false;
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		if (!shaders[i])
+		{
+			continue;
+		}
+
+		uint64_t nameHash = HashShaderName(names[i].data(), names[i].size());
+		size_t index = FindCompiledShader(names[i].c_str(), nameHash);
+		if (index != compiledShaders.size())
+		{
+			if (compiledShaders[index].pShader->cacheKey == shaders[i]->cacheKey)
+			{
+				continue;
+			}
+			compiledShaders[index].pShader = std::move(shaders[i]);
+		}
+		else
+		{
+			CompiledShaderEntry entry;
+			entry.nameHash = nameHash;
+			entry.pShader = std::move(shaders[i]);
+			compiledShaders.push_back(std::move(entry));
+			bAdded = true;
+		}
+		changedShaders.push_back(names[i]);
+	}
+	if (bAdded)
+	{
+		SortCompiledShaders();
+	}
+
+	return bSuccess;
+}
+
+bool VulkanShaderLibrary::CompileShaders(const std::vector<std::string>& names,
+	std::vector<std::unique_ptr<VulkanCompiledShader>>& shaders)
+{
+	//Each shader is compiled by its own job, since a miss can take a lot longer than a cache hit
+	shaders.resize(names.size());
+	std::vector<std::string> errorLogs(names.size());
+	BlitzenEngine::JobSystem::ParallelFor(static_cast<uint32_t>(names.size()), 1,
+		[&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				BLITZEN_CPU_PROFILER_ZONE("CompileShader");
+				shaders[i] = std::make_unique<VulkanCompiledShader>();
+				if (!compiler.CompileShader(names[i], *shaders[i], errorLogs[i]))
+				{
+					shaders[i].reset();
+				}
+			}
+		});
+
+	bool bSuccess = true;
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		if (!shaders[i])
+		{
+			errorLog += errorLogs[i] + "\n";
+			bSuccess = false;
+		}
+	}
+	return bSuccess;
+}
+
+size_t VulkanShaderLibrary::FindCompiledShader(const char* name, uint64_t nameHash) const
+{
+	auto compiledEntry = std::lower_bound(compiledShaders.begin(), compiledShaders.end(), nameHash,
+		[](const CompiledShaderEntry& entry, uint64_t hash) { return entry.nameHash < hash; });
+	for (; compiledEntry != compiledShaders.end() && compiledEntry->nameHash == nameHash; ++compiledEntry)
+	{
+		if (compiledEntry->pShader->name == name)
+		{
+			return static_cast<size_t>(compiledEntry - compiledShaders.begin());
+		}
+	}
+	return compiledShaders.size();
+}
+
+void VulkanShaderLibrary::SortCompiledShaders()
+{
+	std::sort(compiledShaders.begin(), compiledShaders.end(),
+		[](const CompiledShaderEntry& a, const CompiledShaderEntry& b) { return a.nameHash < b.nameHash; });
+}
+
+void VulkanShaderLibrary::Cleanup()
+{
+	file.Close();
+	pEntries = nullptr;
+	shaderCount = 0;
+
+	compiledShaders.clear();
+	compiler.Cleanup();
+	bCompiledFromSources = false;
+}
+
+bool VulkanShaderLibrary::FindShader(const char* name, const uint32_t*& pCode, size_t& codeSize) const
+{
+	size_t nameLength = strlen(name);
+	uint64_t nameHash = HashShaderName(name, nameLength);
+
+	const ShaderLibraryEntry* pEnd = pEntries + shaderCount;
+	const ShaderLibraryEntry* pEntry = std::lower_bound(pEntries, pEnd, nameHash,
+		[](const ShaderLibraryEntry& entry, uint64_t hash) { return entry.nameHash < hash; });
+
+	for (; pEntry != pEnd && pEntry->nameHash == nameHash; ++pEntry)
+	{
+		if (pEntry->nameLength == nameLength &&
+			!memcmp(file.GetData() + pEntry->nameOffset, name, nameLength))
+		{
+			pCode = reinterpret_cast<const uint32_t*>(file.GetData() + pEntry->codeOffset);
+			codeSize = static_cast<size_t>(pEntry->codeSize);
+			return true;
+		}
+	}
+
+	size_t index = FindCompiledShader(name, nameHash);
+	if (index != compiledShaders.size())
+	{
+		pCode = compiledShaders[index].pShader->pCode;
+		codeSize = compiledShaders[index].pShader->codeSize;
+		return true;
+	}
+
+	return false;
+}
+
+VkResult VulkanShaderLibrary::CreateShaderModule(const VkDevice& device, const char* name,
+	VkShaderModule& shaderModule) const
+{
+	const uint32_t* pCode = nullptr;
+	size_t codeSize = 0;
+	if (!FindShader(name, pCode, codeSize))
+	{
+		shaderModule = VK_NULL_HANDLE;
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+	//The driver reads the code straight from the mapped file
+	VkShaderModuleCreateInfo shaderModuleInfo{};
+	shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleInfo.codeSize = codeSize;
+	shaderModuleInfo.pCode = pCode;
+	VkResult result = vkCreateShaderModule(device, &shaderModuleInfo, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		shaderModule = VK_NULL_HANDLE;
+	}
+	return result;
+}
+
+bool VulkanShaderLibrary::ValidateLibrary() const
+{
+	const uint8_t* pData = file.GetData();
+	uint64_t fileSize = file.GetSize();
+	if (fileSize < sizeof(ShaderLibraryHeader))
+	{
+		return false;
+	}
+
+	const ShaderLibraryHeader* pHeader = reinterpret_cast<const ShaderLibraryHeader*>(pData);
+	uint64_t tableEnd = sizeof(ShaderLibraryHeader) +
+		static_cast<uint64_t>(pHeader->shaderCount) * sizeof(ShaderLibraryEntry);
+	if (pHeader->magic != BLITZEN_SHADER_LIBRARY_MAGIC ||
+		pHeader->version != BLITZEN_SHADER_LIBRARY_VERSION ||
+		pHeader->fileSize != fileSize || tableEnd > fileSize)
+	{
+		return false;
+	}
+
+	const ShaderLibraryEntry* pTable = reinterpret_cast<const ShaderLibraryEntry*>(pData + sizeof(ShaderLibraryHeader));
+	for (uint32_t i = 0; i < pHeader->shaderCount; ++i)
+	{
+		const ShaderLibraryEntry& entry = pTable[i];
+
+		//Lookups binary search the table
+		if (i > 0 && pTable[i - 1].nameHash > entry.nameHash)
+		{
+			return false;
+		}
+
+		if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > fileSize ||
+			entry.nameHash != HashShaderName(reinterpret_cast<const char*>(pData + entry.nameOffset), entry.nameLength))
+		{
+			return false;
+		}
+
+		if (entry.codeOffset % BLITZEN_SHADER_LIBRARY_CODE_ALIGNMENT || entry.codeSize < sizeof(uint32_t) ||
+			entry.codeSize % sizeof(uint32_t) || entry.codeOffset > fileSize || entry.codeSize > fileSize - entry.codeOffset ||
+			*reinterpret_cast<const uint32_t*>(pData + entry.codeOffset) != BLITZEN_SPIRV_MAGIC)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+//The shader library is a standalone class, it only needs the Vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "VulkanShaderLibraryFormat.h"
+
+//Compiles the GLSL sources when the library is not read from the packed file
+#include "VulkanShaderCompiler.h"
+
+#include "Engine/Files/MappedFile.h"
+
+
+
+
+//The build packs every compiled shader into this file
+#define BLITZEN_VULKAN_SHADER_LIBRARY_FILEPATH		"VulkanShaders/BlitzenShaders.pack"
+
+
+
+
+/*-----------------------------------------------------------------------------------
+Every SPIR-V shader of the renderer, read from the one file that the ShaderPacker tool
+writes at build time. The file is mapped once and shader modules are created straight
+from the mapping, so no shader code is copied. Every entry is checked when the library
+is opened, so a shader that was found can always be handed to the driver.
+
+Builds without glslangValidator have no packed file, the library can compile the GLSL
+sources instead with InitFromSources, through the shader cache. Shaders are found by
+the same names either way. After Init the library is only read, so any thread can 
+create shader modules from it
+------------------------------------------------------------------------------------*/
+class VulkanShaderLibrary
+{
+public:
+
+	//Returns false if the file can not be mapped, or if it is not a valid library
+	bool Init(const char* filepath);
+
+	/*
+	Compiles every shader in the source directory on the job system, or loads it from the cache.
+	Returns false if the build has no compiler or any shader failed, the error log says which
+	*/
+	bool InitFromSources(const char* sourceDirectory, const char* cacheDirectory,
+		const std::vector<std::string>& defines);
+
+	/*
+	Compiles the sources again after they were changed on disk, and replaces the shaders whose cache key 
+	changed or that were not in the library. Shaders that fail keep their last version, and the error log
+	says why. The names of the replaced shaders are added to the list. Only libraries from InitFromSources 
+	can be reloaded, and no other thread may use the library while it is
+	*/
+	bool ReloadShaders(std::vector<std::string>& changedShaders);
+
+	void Cleanup();
+
+	inline bool IsCompiledFromSources() const { return bCompiledFromSources; }
+
+	//Returns false if the library has no shader with that name
+	bool FindShader(const char* name, const uint32_t*& pCode, size_t& codeSize) const;
+
+	/*
+	Creates a shader module for the shader with that name. Returns VK_ERROR_INITIALIZATION_FAILED
+	if the library has no such shader, or the error of vkCreateShaderModule. The module is null on failure
+	*/
+	VkResult CreateShaderModule(const VkDevice& device, const char* name, VkShaderModule& shaderModule) const;
+
+	inline uint32_t GetShaderCount() const 
+	{ return shaderCount + static_cast<uint32_t>(compiledShaders.size()); }
+
+	//How many of the shaders from InitFromSources were loaded from the cache and how many were compiled
+	inline uint32_t GetCacheHitCount() const { return cacheHitCount; }
+	inline uint32_t GetCompiledCount() const { return compiledCount; }
+
+	inline const std::string& GetErrorLog() const { return errorLog; }
+
+private:
+
+	//Checks the header and every entry against the size of the file
+	bool ValidateLibrary() const;
+
+	//Compiles the shaders on the job system, a shader that failed is left null and its error is added to the log
+	bool CompileShaders(const std::vector<std::string>& names,
+		std::vector<std::unique_ptr<VulkanCompiledShader>>& shaders);
+
+	//Returns the size of compiledShaders if no compiled shader has that name
+	size_t FindCompiledShader(const char* name, uint64_t nameHash) const;
+
+	void SortCompiledShaders();
+
+private:
+
+	BlitzenEngine::MappedFile file;
+
+	//Point into the mapped file
+	const ShaderLibraryEntry* pEntries = nullptr;
+	uint32_t shaderCount = 0;
+
+	//Shaders from InitFromSources, sorted by the hash of their name like the entries of the file
+	struct CompiledShaderEntry
+	{
+		uint64_t nameHash;
+		std::unique_ptr<VulkanCompiledShader> pShader;
+	};
+	std::vector<CompiledShaderEntry> compiledShaders;
+	VulkanShaderCompiler compiler;
+	bool bCompiledFromSources = false;
+	uint32_t cacheHitCount = 0;
+	uint32_t compiledCount = 0;
+
+	std::string errorLog;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+The layout of the shader library file. It is shared by the renderer, which reads it,
+and the ShaderPacker tool, which writes it, so it does not include the Vulkan headers
+*/
+
+
+
+
+//Written at the start of the file, so that files of other formats are never read as a library
+#define BLITZEN_SHADER_LIBRARY_MAGIC				0x4C535A42u
+//Needs to change whenever the layout of the header or the entries changes
+#define BLITZEN_SHADER_LIBRARY_VERSION				1u
+
+//The code of each shader starts at a multiple of this, vkCreateShaderModule needs at least 4
+#define BLITZEN_SHADER_LIBRARY_CODE_ALIGNMENT		16u
+
+//The first word of every SPIR-V module
+#define BLITZEN_SPIRV_MAGIC							0x07230203u
+
+
+
+
+/*-------------------------------------------------------------------------------
+The file starts with the header, followed by the table of contents, which has one
+entry for each shader, sorted by the hash of its name. The names and the SPIR-V
+code come after the table, with the code of each shader aligned to
+BLITZEN_SHADER_LIBRARY_CODE_ALIGNMENT. All offsets are from the start of the file
+--------------------------------------------------------------------------------*/
+struct ShaderLibraryHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t shaderCount;
+	uint32_t padding;
+
+	//Has to match the size of the file, a file that was cut short is never read
+	uint64_t fileSize;
+};
+
+struct ShaderLibraryEntry
+{
+	uint64_t nameHash;
+
+	uint64_t codeOffset;
+	uint64_t codeSize;
+
+	//The name is kept too, so that a lookup can tell a shader apart from another one with the same hash
+	uint32_t nameOffset;
+	uint32_t nameLength;
+};
+
+//FNV-1a of a shader's name, which is the name of its .spv file without the directory and the extension
+inline uint64_t HashShaderName(const char* name, size_t nameLength)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < nameLength; ++i)
+	{
+		hash ^= static_cast<uint8_t>(name[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,200 @@
+#include "VulkanRenderer.h"
+
+#include <algorithm>
+
+//The shaders that each pipeline is created from, a pipeline is rebuilt when any of them changes
+struct VulkanPipelineShaders
+{
+	const char* pipelineName;
+	std::array<const char*, 2> shaderNames;
+};
+
+static const std::array<VulkanPipelineShaders, static_cast<size_t>(VulkanStartupPipeline::Count)>
+	pipelineShaders =
+{{
+	{ "Gradient", { BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER, nullptr } },
+	{ "DepthPyramid", { BLITZEN_VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER, nullptr } },
+	{ "DrawCulling", { BLITZEN_VULKAN_DRAW_CULLING_COMPUTE_SHADER, nullptr } },
+	{ "Geometry", { SIMPLE_GEOMETRY_VERTEX_SHADER, SIMPLE_GEOMETRY_FRAGMENT_SHADER } }
+}};
+
+void VulkanRenderer::UpdateShaderHotReload()
+{
+	if (!shaderWatcher.IsWatching())
+	{
+		return;
+	}
+
+	BLITZEN_CPU_PROFILER_ZONE("UpdateShaderHotReload");
+
+	DestroyRetiredPipelines(false);
+
+	if (bShaderReloadRunning)
+	{
+		//The job is never waited for, the frame keeps the old pipelines until it is done
+		if (shaderReloadCounter.pendingJobCount.load(std::memory_order_acquire) != 0)
+		{
+			return;
+		}
+		bShaderReloadRunning = false;
+		ApplyShaderReload();
+	}
+
+	auto now = std::chrono::high_resolution_clock::now();
+	changedShaderFiles.clear();
+	if (shaderWatcher.PollChanges(changedShaderFiles))
+	{
+		bShaderChangesPending = true;
+		lastShaderChangeTime = now;
+	}
+
+	/*
+	Editors often write a file more than once when it is saved, and includes can be saved together
+	with the shaders that use them, so the reload waits for the sources to settle
+	*/
+	if (bShaderChangesPending && std::chrono::duration<double, std::milli>(now - lastShaderChangeTime).count() >=
+		BLITZEN_VULKAN_SHADER_RELOAD_DELAY_MS)
+	{
+		bShaderChangesPending = false;
+		bShaderReloadRunning = true;
+		//Run would queue it on this thread's deque, where the waits of the frame's own jobs could take it
+		BlitzenEngine::JobSystem::RunInBackground(ReloadShadersJob, this, &shaderReloadCounter);
+	}
+}
+
+void VulkanRenderer::ReloadShadersJob(void* pData)
+{
+	VulkanRenderer* pRenderer = reinterpret_cast<VulkanRenderer*>(pData);
+	BLITZEN_CPU_PROFILER_ZONE("ReloadShaders");
+
+	/*
+	Only this job uses the shader library while it runs. The render thread keeps drawing with the old
+	pipelines, and only reads the pending reload after the job is done
+	*/
+	auto reloadStart = std::chrono::high_resolution_clock::now();
+	VulkanPendingShaderReload& reload = pRenderer->pendingShaderReload;
+	std::vector<std::string> changedShaders;
+	pRenderer->shaderLibrary.ReloadShaders(changedShaders);
+	reload.errorLog = pRenderer->shaderLibrary.GetErrorLog();
+
+	for (size_t i = 0; i < pipelineShaders.size(); ++i)
+	{
+		VulkanStartupPipeline pipeline = static_cast<VulkanStartupPipeline>(i);
+
+		//A pipeline that failed at startup is tried again with every reload, the fix might have been outside its shaders
+		bool bRebuild = pRenderer->GetPipelineHandle(pipeline) == VK_NULL_HANDLE;
+		for (const char* shaderName : pipelineShaders[i].shaderNames)
+		{
+			bRebuild = bRebuild || (shaderName &&
+				std::find(changedShaders.begin(), changedShaders.end(), shaderName) != changedShaders.end());
+		}
+		if (!bRebuild)
+		{
+			continue;
+		}
+
+		BLITZEN_CPU_PROFILER_ZONE(pipelineShaders[i].pipelineName);
+		if (!pRenderer->RebuildPipeline(pipeline, reload.newPipelines[i]))
+		{
+			reload.newPipelines[i] = VK_NULL_HANDLE;
+			reload.errorLog += std::string("Pipeline ") + pipelineShaders[i].pipelineName + " failed to rebuild\n";
+		}
+	}
+
+	auto reloadEnd = std::chrono::high_resolution_clock::now();
+	reload.reloadTime = std::chrono::duration<double, std::milli>(reloadEnd - reloadStart).count();
+}
+
+void VulkanRenderer::ApplyShaderReload()
+{
+	/*
+	Frames are recorded from the start of DrawFrame, so every frame from this one on binds the new
+	pipelines. The last frame that could bind an old pipeline is the one before this, and it is done
+	once the frame that reuses its frame tools has waited for it
+	*/
+	uint32_t rebuiltPipelineCount = 0;
+	for (size_t i = 0; i < pendingShaderReload.newPipelines.size(); ++i)
+	{
+		VkPipeline& newPipeline = pendingShaderReload.newPipelines[i];
+		if (newPipeline == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		VkPipeline& pipeline = GetPipelineHandle(static_cast<VulkanStartupPipeline>(i));
+		if (pipeline != VK_NULL_HANDLE)
+		{
+			VulkanRetiredPipeline retiredPipeline;
+			retiredPipeline.pipeline = pipeline;
+			retiredPipeline.destroyFrame = frameCount + rendererSettings.framesInFlight - 1;
+			retiredPipelines.push_back(retiredPipeline);
+		}
+		pipeline = newPipeline;
+		newPipeline = VK_NULL_HANDLE;
+		++rebuiltPipelineCount;
+	}
+
+	++shaderReloadStats.reloadCount;
+	shaderReloadStats.lastReloadTime = pendingShaderReload.reloadTime;
+	shaderReloadStats.lastRebuiltPipelineCount = rebuiltPipelineCount;
+	shaderReloadStats.lastErrorLog = pendingShaderReload.errorLog;
+
+	//A renderer whose pipelines failed at startup starts drawing once every one of them has been rebuilt
+	bPipelinesReady = true;
+	for (size_t i = 0; i < pipelineShaders.size(); ++i)
+	{
+		bPipelinesReady = bPipelinesReady &&
+			GetPipelineHandle(static_cast<VulkanStartupPipeline>(i)) != VK_NULL_HANDLE;
+	}
+}
+
+void VulkanRenderer::DestroyRetiredPipelines(bool bDeviceIdle)
+{
+	auto retiredEnd = std::remove_if(retiredPipelines.begin(), retiredPipelines.end(),
+		[&](const VulkanRetiredPipeline& retiredPipeline)
+		{
+			if (!bDeviceIdle && frameCount < retiredPipeline.destroyFrame)
+			{
+				return false;
+			}
+			vkDestroyPipeline(device, retiredPipeline.pipeline, nullptr);
+			return true;
+		});
+	retiredPipelines.erase(retiredEnd, retiredPipelines.end());
+}
+
+bool VulkanRenderer::RebuildPipeline(VulkanStartupPipeline pipeline, VkPipeline& newPipeline)
+{
+	switch (pipeline)
+	{
+	case VulkanStartupPipeline::Gradient:
+		return CreateComputePipeline(BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER, gradientComputePipeline.pipelineLayout,
+			gradientComputePipeline.workgroupSize, newPipeline);
+	case VulkanStartupPipeline::DepthPyramid:
+		return depthPyramid.CreateBuildPipeline(device, shaderLibrary, BLITZEN_VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER,
+			pipelineCache.GetCache(), depthPyramid.GetWorkgroupSize(), newPipeline);
+	case VulkanStartupPipeline::DrawCulling:
+		return CreateComputePipeline(BLITZEN_VULKAN_DRAW_CULLING_COMPUTE_SHADER, 
+			drawCullingComputePipeline.pipelineLayout, drawCullingComputePipeline.workgroupSize, newPipeline);
+	case VulkanStartupPipeline::Geometry:
+		return simpleGeometryGraphicsPipeline.RebuildBasicGeometryPipeline(device, shaderLibrary,
+			pipelineCache.GetCache(), newPipeline);
+	default:
+		return false;
+	}
+}
+
+VkPipeline& VulkanRenderer::GetPipelineHandle(VulkanStartupPipeline pipeline)
+{
+	switch (pipeline)
+	{
+	case VulkanStartupPipeline::Gradient:
+		return gradientComputePipeline.computePipeline;
+	case VulkanStartupPipeline::DepthPyramid:
+		return depthPyramid.GetPipeline();
+	case VulkanStartupPipeline::DrawCulling:
+		return drawCullingComputePipeline.computePipeline;
+	default:
+		return simpleGeometryGraphicsPipeline.graphicsPipeline;
+	}
+}
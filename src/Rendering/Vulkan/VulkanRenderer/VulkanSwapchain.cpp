@@ -0,0 +1,116 @@
+#include "VulkanRenderer.h"
+
+#include <algorithm>
+
+bool VulkanRenderer::RecreateSwapchain()
+{
+	BLITZEN_CPU_PROFILER_ZONE("RecreateSwapchain");
+
+	/*
+	A minimized window has a framebuffer of size 0, and no swapchain can be created for it. The size comes 
+	from the window callbacks or from a render packet, since glfw can only be asked on the main thread
+	*/
+	if (!framebufferExtent.width || !framebufferExtent.height)
+	{
+		return false;
+	}
+
+	/*
+	The frames in flight might still be using the old swapchain and its images, so nothing is destroyed here. 
+	They are retired like the pipelines that hot reload replaces, instead of waiting for the device
+	*/
+	VulkanRetiredSwapchainResources retiredResources;
+	retiredResources.swapchain = windowInterface.swapchain;
+	retiredResources.swapchainImageViews = windowInterface.swapchainImageViews;
+	retiredResources.renderFinishedSemaphores = windowInterface.renderFinishedSemaphores;
+	retiredResources.destroyFrame = frameCount + rendererSettings.framesInFlight - 1;
+	if (!SetupSwapchain(retiredResources.swapchain))
+	{
+		//The old swapchain is kept, it is tried again next frame
+		return false;
+	}
+
+	VkExtent2D oldNativeDrawExtent = nativeDrawExtent;
+	nativeDrawExtent = windowInterface.swapchainExtent;
+
+	/*
+	Dragging a window edge resizes it every frame, so the drawing image is only allocated again when the 
+	new extent does not fit. Every pass only touches the draw extent of it
+	*/
+	if (nativeDrawExtent.width > drawingImage.extent.width || nativeDrawExtent.height > drawingImage.extent.height)
+	{
+		retiredResources.drawingImage = drawingImage;
+		retiredResources.backgroundDrawingDescriptorSet = backgroundDrawingDescriptorSet;
+
+		VkExtent2D grownExtent = { std::max(nativeDrawExtent.width, drawingImage.extent.width),
+			std::max(nativeDrawExtent.height, drawingImage.extent.height) };
+		AllocateDrawingImage(grownExtent);
+		AllocateBackgroundDescriptorSet();
+	}
+
+	//The depth pyramid's levels follow the depth image, so it matches the native extent exactly
+	if (nativeDrawExtent.width != oldNativeDrawExtent.width || nativeDrawExtent.height != oldNativeDrawExtent.height)
+	{
+		retiredResources.depthImage = depthImage;
+		AllocateDepthImage();
+		depthPyramid.Resize(device, allocator, depthImage.imageView, nativeDrawExtent, 
+			retiredResources.depthPyramidTargets);
+	}
+
+	//Scaled from the new native extent
+	UpdateDrawExtent();
+
+	retiredSwapchainResources.push_back(std::move(retiredResources));
+	bFramebufferResized = false;
+	bSwapchainOutOfDate = false;
+
+	//The new swapchain presented none of the ids so far, so the pacer cannot wait for them on it
+	firstSwapchainPresentId = lastPresentId + 1;
+	return true;
+}
+
+void VulkanRenderer::SetPresentMode(VkPresentModeKHR presentMode)
+{
+	if (rendererSettings.presentMode == presentMode)
+	{
+		return;
+	}
+
+	rendererSettings.presentMode = presentMode;
+	bSwapchainOutOfDate = true;
+}
+
+void VulkanRenderer::DestroyRetiredSwapchainResources(bool bDeviceIdle)
+{
+	auto retiredEnd = std::remove_if(retiredSwapchainResources.begin(), retiredSwapchainResources.end(),
+		[&](VulkanRetiredSwapchainResources& retiredResources)
+		{
+			if (!bDeviceIdle && frameCount < retiredResources.destroyFrame)
+			{
+				return false;
+			}
+
+			for (VkImageView& imageView : retiredResources.swapchainImageViews)
+			{
+				vkDestroyImageView(device, imageView, nullptr);
+			}
+			for (VkSemaphore& renderFinishedSemaphore : retiredResources.renderFinishedSemaphores)
+			{
+				vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
+			}
+			vkDestroySwapchainKHR(device, retiredResources.swapchain, nullptr);
+
+			if (retiredResources.backgroundDrawingDescriptorSet != VK_NULL_HANDLE)
+			{
+				vkFreeDescriptorSets(device, descriptorPool, 1, &retiredResources.backgroundDrawingDescriptorSet);
+			}
+			vkDestroyImageView(device, retiredResources.drawingImage.imageView, nullptr);
+			vmaDestroyImage(allocator, retiredResources.drawingImage.image, retiredResources.drawingImage.allocation);
+
+			vkDestroyImageView(device, retiredResources.depthImage.imageView, nullptr);
+			vmaDestroyImage(allocator, retiredResources.depthImage.image, retiredResources.depthImage.allocation);
+			VulkanDepthPyramid::DestroyTargets(device, allocator, retiredResources.depthPyramidTargets);
+			return true;
+		});
+	retiredSwapchainResources.erase(retiredEnd, retiredSwapchainResources.end());
+}
@@ -0,0 +1,327 @@
+#include "VulkanUploadManager.h"
+#include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
+
+#include <algorithm>
+#include <cstring>
+
+void VulkanUploadManager::Init(const VkDevice& vulkanDevice, const VmaAllocator& vmaAllocator,
+	const VkQueue& transferQueue, uint32_t transferQueueFamilyIndex,
+	uint32_t graphicsQueueFamilyIndex)
+{
+	device = vulkanDevice;
+	allocator = vmaAllocator;
+	queue = transferQueue;
+	transferFamilyIndex = transferQueueFamilyIndex;
+	graphicsFamilyIndex = graphicsQueueFamilyIndex;
+	bSeparateQueueFamily = transferFamilyIndex != graphicsFamilyIndex;
+
+	//The staging ring is mapped once and stays mapped until cleanup
+	VkBufferCreateInfo stagingRingInfo{};
+	VulkanSDKobjects::BufferCreateInfoInit(stagingRingInfo, BLITZEN_VULKAN_UPLOAD_STAGING_RING_SIZE,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	VmaAllocationCreateInfo stagingAllocationInfo{};
+	stagingAllocationInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+	stagingAllocationInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+	vmaCreateBuffer(allocator, &stagingRingInfo, &stagingAllocationInfo, &(stagingRing.buffer),
+		&(stagingRing.allocation), &(stagingRing.allocationInfo));
+	pStagingRingData = reinterpret_cast<char*>(stagingRing.allocationInfo.pMappedData);
+
+	//Each batch resets its command buffer before recording
+	VkCommandPoolCreateInfo commandPoolInfo{};
+	VulkanSDKobjects::CommandPoolCreateInfoInit(commandPoolInfo, transferFamilyIndex,
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	vkCreateCommandPool(device, &commandPoolInfo, nullptr, &commandPool);
+
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo{};
+	semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeInfo.initialValue = 0;
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	VulkanSDKobjects::SemaphoreCreateInfoInit(semaphoreInfo);
+	semaphoreInfo.pNext = &semaphoreTypeInfo;
+	vkCreateSemaphore(device, &semaphoreInfo, nullptr, &uploadTimelineSemaphore);
+
+	for (UploadBatch& batch : batches)
+	{
+		VkCommandBufferAllocateInfo commandBufferInfo{};
+		VulkanSDKobjects::CommandBufferAllocInfoInit(commandBufferInfo, commandPool,
+			VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		vkAllocateCommandBuffers(device, &commandBufferInfo, &(batch.commandBuffer));
+	}
+}
+
+void VulkanUploadManager::Cleanup()
+{
+	//Staging memory can only be freed after every copy that reads it has finished
+	WaitForUploads();
+
+	vkDestroySemaphore(device, uploadTimelineSemaphore, nullptr);
+
+	//Destroying the command pool also frees the command buffers
+	vkDestroyCommandPool(device, commandPool, nullptr);
+
+	vmaDestroyBuffer(allocator, stagingRing.buffer, stagingRing.allocation);
+}
+
+void VulkanUploadManager::UploadToBuffer(const void* pData, VkDeviceSize size,
+	VkBuffer dstBuffer, VkDeviceSize dstOffset /* =0 */)
+{
+	const char* pSource = reinterpret_cast<const char*>(pData);
+
+	while (size > 0)
+	{
+		//Take as much of the data as the ring can hold, the rest is copied with the next region
+		VkDeviceSize chunkSize = std::min<VkDeviceSize>(size, BLITZEN_VULKAN_UPLOAD_STAGING_RING_SIZE);
+		VkDeviceSize ringOffset = 0;
+		while (!TryAllocateRingRegion(chunkSize, ringOffset))
+		{
+			/*
+			No space left, so the collected copies are submitted and the oldest batch is waited on.
+			When every batch is done the ring is empty, so the allocation will eventually succeed
+			*/
+			Flush();
+			RetireBatches(true);
+		}
+
+		memcpy(pStagingRingData + ringOffset, pSource, static_cast<size_t>(chunkSize));
+
+		PendingCopy copy;
+		copy.dstBuffer = dstBuffer;
+		VulkanSDKobjects::BufferCopyInit(copy.region, chunkSize, ringOffset, dstOffset);
+		pendingCopies.push_back(copy);
+
+		pSource += chunkSize;
+		dstOffset += chunkSize;
+		size -= chunkSize;
+	}
+}
+
+void VulkanUploadManager::Flush()
+{
+	if (pendingCopies.empty())
+	{
+		return;
+	}
+
+	//If the next batch is still in flight, it has to be done before it can be recorded again
+	UploadBatch& batch = batches[nextBatch];
+	while (batch.bInFlight)
+	{
+		RetireBatches(true);
+	}
+
+	vkResetCommandBuffer(batch.commandBuffer, 0);
+	VkCommandBufferBeginInfo commandBufferBegin{};
+	VulkanSDKobjects::CommandBufferBeginInfoInit(commandBufferBegin,
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	vkBeginCommandBuffer(batch.commandBuffer, &commandBufferBegin);
+
+	//Copies to the same buffer that were queued one after the other are recorded with one command
+	std::vector<VkBufferCopy> regions;
+	for (size_t i = 0; i < pendingCopies.size(); ++i)
+	{
+		regions.push_back(pendingCopies[i].region);
+		if (i + 1 == pendingCopies.size() || pendingCopies[i + 1].dstBuffer != pendingCopies[i].dstBuffer)
+		{
+			vkCmdCopyBuffer(batch.commandBuffer, stagingRing.buffer, pendingCopies[i].dstBuffer,
+				static_cast<uint32_t>(regions.size()), regions.data());
+			regions.clear();
+		}
+	}
+
+	VkDependencyInfo barrierDependency{};
+	barrierDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	VkMemoryBarrier2 memoryBarrier{};
+	std::vector<VkBufferMemoryBarrier2> releaseBarriers;
+	if (bSeparateQueueFamily)
+	{
+		/*
+		The copied ranges are released to the graphics family. The matching acquire barriers are saved,
+		so that the graphics queue can record them once it waits for this batch's semaphore value
+		*/
+		releaseBarriers.reserve(pendingCopies.size());
+		for (const PendingCopy& copy : pendingCopies)
+		{
+			VkBufferMemoryBarrier2 releaseBarrier{};
+			releaseBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+			releaseBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			releaseBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			releaseBarrier.srcQueueFamilyIndex = transferFamilyIndex;
+			releaseBarrier.dstQueueFamilyIndex = graphicsFamilyIndex;
+			releaseBarrier.buffer = copy.dstBuffer;
+			releaseBarrier.offset = copy.region.dstOffset;
+			releaseBarrier.size = copy.region.size;
+			releaseBarriers.push_back(releaseBarrier);
+
+			VkBufferMemoryBarrier2 acquireBarrier = releaseBarrier;
+			acquireBarrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			acquireBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+			acquireBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			acquireBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+			pendingAcquires.push_back(acquireBarrier);
+		}
+		barrierDependency.bufferMemoryBarrierCount = static_cast<uint32_t>(releaseBarriers.size());
+		barrierDependency.pBufferMemoryBarriers = releaseBarriers.data();
+	}
+	else
+	{
+		//On the graphics queue, the copied data only needs to be made visible to the commands after it
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		memoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+		barrierDependency.memoryBarrierCount = 1;
+		barrierDependency.pMemoryBarriers = &memoryBarrier;
+	}
+	vkCmdPipelineBarrier2(batch.commandBuffer, &barrierDependency);
+
+	vkEndCommandBuffer(batch.commandBuffer);
+
+	//The timeline semaphore tells both the graphics queue and the cpu when the copies are done
+	VkSemaphoreSubmitInfo signalSemaphoreInfo{};
+	VulkanSDKobjects::SemaphoreSubmitInfoInit(signalSemaphoreInfo, uploadTimelineSemaphore,
+		VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+	signalSemaphoreInfo.value = ++lastSignalledValue;
+
+	VkCommandBufferSubmitInfo commandBufferSubmit{};
+	VulkanSDKobjects::CommandBufferSubmitInfoInit(commandBufferSubmit, batch.commandBuffer);
+	VkSubmitInfo2 submitInfo{};
+	VulkanSDKobjects::SubmitInfo2Init(submitInfo, nullptr, &signalSemaphoreInfo, &commandBufferSubmit);
+	vkQueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE);
+
+	//The batch now owns the ring regions that were written since the last flush
+	batch.bInFlight = true;
+	batch.signalValue = lastSignalledValue;
+	batch.ringEnd = ringHead;
+	batch.ringBytes = pendingRingBytes;
+	pendingRingBytes = 0;
+	pendingCopies.clear();
+
+	nextBatch = (nextBatch + 1) % batches.size();
+}
+
+void VulkanUploadManager::WaitForUploads()
+{
+	Flush();
+
+	while (batches[oldestBatch].bInFlight)
+	{
+		RetireBatches(true);
+	}
+}
+
+uint64_t VulkanUploadManager::RecordPendingAcquires(const VkCommandBuffer& commandBuffer)
+{
+	if (!pendingAcquires.empty())
+	{
+		VkDependencyInfo barrierDependency{};
+		barrierDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		barrierDependency.bufferMemoryBarrierCount = static_cast<uint32_t>(pendingAcquires.size());
+		barrierDependency.pBufferMemoryBarriers = pendingAcquires.data();
+		vkCmdPipelineBarrier2(commandBuffer, &barrierDependency);
+
+		pendingAcquires.clear();
+	}
+
+	//Every batch signals a higher value, so waiting for the last one covers all of them
+	if (lastConsumedValue == lastSignalledValue)
+	{
+		return 0;
+	}
+	lastConsumedValue = lastSignalledValue;
+	return lastSignalledValue;
+}
+
+bool VulkanUploadManager::TryAllocateRingRegion(VkDeviceSize size, VkDeviceSize& offset)
+{
+	//An empty ring starts over, so that the whole buffer is available as one region
+	if (ringBytesInUse == 0)
+	{
+		ringHead = 0;
+		ringTail = 0;
+	}
+	//The head has caught up with the tail, so the ring is full
+	else if (ringHead == ringTail)
+	{
+		return false;
+	}
+
+	VkDeviceSize alignedHead = (ringHead + BLITZEN_VULKAN_UPLOAD_ALIGNMENT - 1) &
+		~(BLITZEN_VULKAN_UPLOAD_ALIGNMENT - 1);
+	VkDeviceSize consumedBytes = 0;
+
+	if (ringHead >= ringTail)
+	{
+		//The free space is the end of the ring and then the start of the ring up to the tail
+		if (alignedHead + size <= BLITZEN_VULKAN_UPLOAD_STAGING_RING_SIZE)
+		{
+			offset = alignedHead;
+			consumedBytes = alignedHead + size - ringHead;
+		}
+		//If the end is too small, it is skipped and the region wraps to the start
+		else if (size <= ringTail)
+		{
+			offset = 0;
+			consumedBytes = BLITZEN_VULKAN_UPLOAD_STAGING_RING_SIZE - ringHead + size;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		//The free space is between the head and the tail
+		if (alignedHead + size <= ringTail)
+		{
+			offset = alignedHead;
+			consumedBytes = alignedHead + size - ringHead;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	ringHead = (offset + size) % BLITZEN_VULKAN_UPLOAD_STAGING_RING_SIZE;
+	ringBytesInUse += consumedBytes;
+	pendingRingBytes += consumedBytes;
+	return true;
+}
+
+void VulkanUploadManager::RetireBatches(bool bWait)
+{
+	//Batches signal increasing values, so one read of the counter tells which of them are done
+	uint64_t completedValue = 0;
+	vkGetSemaphoreCounterValue(device, uploadTimelineSemaphore, &completedValue);
+
+	while (batches[oldestBatch].bInFlight)
+	{
+		UploadBatch& batch = batches[oldestBatch];
+
+		if (completedValue < batch.signalValue)
+		{
+			//Only the oldest batch is waited on, the ones after it are checked again in the next loop
+			if (!bWait)
+			{
+				return;
+			}
+			VkSemaphoreWaitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &uploadTimelineSemaphore;
+			waitInfo.pValues = &(batch.signalValue);
+			vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+			vkGetSemaphoreCounterValue(device, uploadTimelineSemaphore, &completedValue);
+			bWait = false;
+		}
+
+		//The copies of the batch are done, so its part of the ring can be reused
+		batch.bInFlight = false;
+		ringTail = batch.ringEnd;
+		ringBytesInUse -= batch.ringBytes;
+
+		oldestBatch = (oldestBatch + 1) % batches.size();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+//Includes the vulkan headers and the memory allocator
+#include "VulkanShaderData.h"
+
+
+
+
+//Size of the persistently mapped staging ring that all uploads go through
+#define BLITZEN_VULKAN_UPLOAD_STAGING_RING_SIZE		(32ull * 1024ull * 1024ull)
+
+//How many upload submissions can be in flight at the same time
+#define BLITZEN_VULKAN_UPLOAD_MAX_BATCHES				4
+
+//Every region of the staging ring starts at a multiple of this
+#define BLITZEN_VULKAN_UPLOAD_ALIGNMENT					16ull
+
+
+
+
+/*----------------------------------------------------------------------------------
+Copies data to gpu only buffers through one staging buffer that stays mapped for the
+lifetime of the renderer. Uploads are written to the ring and their copy commands are
+collected, until Flush records all of them in a single command buffer and submits it.
+Regions of the ring are only reused after the timeline semaphore has reached the value
+of the batch that read them, so staging memory stays alive until its copy has finished.
+
+Batches are submitted to the transfer queue, which is a separate family when the 
+device has one. Each submission signals a timeline semaphore, which the next frame
+waits on instead of the cpu waiting for the copies, and which the cpu checks to free
+the ring. If the transfer family is not the graphics family, the copied ranges are
+released by the transfer queue and have to be acquired by the graphics queue with
+RecordPendingAcquires
+-----------------------------------------------------------------------------------*/
+class VulkanUploadManager
+{
+public:
+
+	void Init(const VkDevice& device, const VmaAllocator& allocator,
+		const VkQueue& transferQueue, uint32_t transferQueueFamilyIndex,
+		uint32_t graphicsQueueFamilyIndex);
+
+	//Uses a manual cleanup function instead of the destructor since it needs the device
+	void Cleanup();
+
+	/*
+	Writes the data to the staging ring and queues a copy to dstBuffer at dstOffset. Data that
+	does not fit in the free part of the ring is split, and older batches are flushed or waited
+	on to make room. The copy only happens after the next Flush
+	*/
+	void UploadToBuffer(const void* pData, VkDeviceSize size, VkBuffer dstBuffer,
+		VkDeviceSize dstOffset = 0);
+
+	//Submits all queued copies with one command buffer, does nothing if there are none
+	void Flush();
+
+	//Flushes and then waits until every submitted copy has finished
+	void WaitForUploads();
+
+	/*
+	Records the ownership acquire barriers for everything that was flushed since the last call,
+	on a graphics queue command buffer. Returns the value of the timeline semaphore that the
+	submission of that command buffer has to wait for, or 0 if there is nothing to wait for
+	*/
+	uint64_t RecordPendingAcquires(const VkCommandBuffer& commandBuffer);
+
+	inline VkSemaphore& GetTimelineSemaphore() { return uploadTimelineSemaphore; }
+
+	//True if uploads go to a queue family other than the graphics one
+	inline bool UsesSeparateQueueFamily() const { return bSeparateQueueFamily; }
+
+private:
+
+	//Holds the objects for one submission and the part of the ring that it reads from
+	struct UploadBatch
+	{
+		VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+		//The timeline semaphore reaches this value when the copies of the batch are done
+		uint64_t signalValue = 0;
+		bool bInFlight = false;
+
+		//Where the ring's tail moves to when the batch is done and how many bytes are freed
+		VkDeviceSize ringEnd = 0;
+		VkDeviceSize ringBytes = 0;
+	};
+
+	struct PendingCopy
+	{
+		VkBuffer dstBuffer;
+		VkBufferCopy region;
+	};
+
+	/*
+	Tries to reserve size bytes of the ring for the batch that is being collected.
+	Returns false if there is no contiguous space left
+	*/
+	bool TryAllocateRingRegion(VkDeviceSize size, VkDeviceSize& offset);
+
+	//Frees the ring regions of batches that are done, waits for the oldest one if bWait is true
+	void RetireBatches(bool bWait);
+
+private:
+
+	VkDevice device{ VK_NULL_HANDLE };
+	VmaAllocator allocator{ VK_NULL_HANDLE };
+
+	VkQueue queue{ VK_NULL_HANDLE };
+	VkCommandPool commandPool{ VK_NULL_HANDLE };
+
+	uint32_t transferFamilyIndex = 0;
+	uint32_t graphicsFamilyIndex = 0;
+	bool bSeparateQueueFamily = false;
+
+	//Signalled with a new value by every batch, so that the graphics queue can wait for uploads on the gpu and the cpu on the ring
+	VkSemaphore uploadTimelineSemaphore{ VK_NULL_HANDLE };
+	uint64_t lastSignalledValue = 0;
+	//The last value that was handed to a graphics submission by RecordPendingAcquires
+	uint64_t lastConsumedValue = 0;
+
+	//Acquire barriers that match the release barriers of flushed batches, waiting to be recorded on the graphics queue
+	std::vector<VkBufferMemoryBarrier2> pendingAcquires;
+
+	VulkanShaderData::AllocatedBuffer stagingRing;
+	char* pStagingRingData = nullptr;
+
+	//New regions are taken from the head, regions are freed from the tail when their batch is done
+	VkDeviceSize ringHead = 0;
+	VkDeviceSize ringTail = 0;
+	VkDeviceSize ringBytesInUse = 0;
+	//Bytes of the ring that belong to the batch that has not been flushed yet
+	VkDeviceSize pendingRingBytes = 0;
+
+	std::vector<PendingCopy> pendingCopies;
+
+	std::array<UploadBatch, BLITZEN_VULKAN_UPLOAD_MAX_BATCHES> batches;
+	//The batch that the next flush will use, batches are submitted and retired in this order
+	size_t nextBatch = 0;
+	size_t oldestBatch = 0;
+};
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "VulkanWorkgroupTuner.h"
+#include "Rendering/Vulkan/SDKobjects/VulkanSDKobjects.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <fstream>
+
+#include "Engine/Profiling/CpuProfiler.h"
+
+void VulkanWorkgroupSpecialization::Init(const VulkanWorkgroupSize& size)
+{
+	workgroupSize = size;
+
+	mapEntries[0].constantID = BLITZEN_VULKAN_WORKGROUP_SIZE_X_CONSTANT_ID;
+	mapEntries[0].offset = offsetof(VulkanWorkgroupSize, x);
+	mapEntries[0].size = sizeof(uint32_t);
+	mapEntries[1].constantID = BLITZEN_VULKAN_WORKGROUP_SIZE_Y_CONSTANT_ID;
+	mapEntries[1].offset = offsetof(VulkanWorkgroupSize, y);
+	mapEntries[1].size = sizeof(uint32_t);
+	mapEntries[2].constantID = BLITZEN_VULKAN_WORKGROUP_SIZE_Z_CONSTANT_ID;
+	mapEntries[2].offset = offsetof(VulkanWorkgroupSize, z);
+	mapEntries[2].size = sizeof(uint32_t);
+
+	//Constants that a shader does not declare are ignored, so 1D kernels can be given all three
+	info.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+	info.pMapEntries = mapEntries.data();
+	info.dataSize = sizeof(VulkanWorkgroupSize);
+	info.pData = &workgroupSize;
+}
+
+void VulkanWorkgroupTuner::Init(const VkDevice& newDevice, const VkPhysicalDevice& physicalDevice,
+	const VkQueue& newQueue, uint32_t queueFamilyIndex, float newTimestampPeriod, bool bTimestampsSupported,
+	const char* resultsFilepath)
+{
+	BLITZEN_CPU_PROFILER_ZONE("VulkanWorkgroupTuner::Init");
+
+	device = newDevice;
+	queue = newQueue;
+	timestampPeriod = newTimestampPeriod;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	filepath = resultsFilepath ? resultsFilepath : "";
+
+	if (!filepath.empty())
+	{
+		ReadResultsFile();
+	}
+
+	//Without a query pool, CanTune is false and every kernel keeps its default
+	if (!bTimestampsSupported)
+	{
+		return;
+	}
+
+	VkCommandPoolCreateInfo commandPoolInfo{};
+	VulkanSDKobjects::CommandPoolCreateInfoInit(commandPoolInfo, queueFamilyIndex,
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	vkCreateCommandPool(device, &commandPoolInfo, nullptr, &commandPool);
+
+	VkCommandBufferAllocateInfo commandBufferInfo{};
+	VulkanSDKobjects::CommandBufferAllocInfoInit(commandBufferInfo, commandPool,
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	vkAllocateCommandBuffers(device, &commandBufferInfo, &commandBuffer);
+
+	VkFenceCreateInfo fenceInfo{};
+	VulkanSDKobjects::FenceCreateInfoInit(fenceInfo);
+	vkCreateFence(device, &fenceInfo, nullptr, &fence);
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	VulkanSDKobjects::QueryPoolCreateInfoInit(queryPoolInfo, VK_QUERY_TYPE_TIMESTAMP, 2);
+	vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool);
+}
+
+void VulkanWorkgroupTuner::Cleanup()
+{
+	vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	vkDestroyFence(device, fence, nullptr);
+	//Destroying the pool also frees the command buffer
+	vkDestroyCommandPool(device, commandPool, nullptr);
+
+	timestampQueryPool = VK_NULL_HANDLE;
+	fence = VK_NULL_HANDLE;
+	commandPool = VK_NULL_HANDLE;
+	commandBuffer = VK_NULL_HANDLE;
+}
+
+bool VulkanWorkgroupTuner::Save()
+{
+	if (filepath.empty())
+	{
+		return false;
+	}
+
+	VulkanWorkgroupTuningFileHeader header{};
+	header.magic = BLITZEN_VULKAN_WORKGROUP_TUNING_FILE_MAGIC;
+	header.fileVersion = BLITZEN_VULKAN_WORKGROUP_TUNING_FILE_VERSION;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	header.resultCount = static_cast<uint32_t>(results.size());
+
+	std::string temporaryFilepath = filepath + ".tmp";
+	{
+		std::ofstream file(temporaryFilepath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(results.data()),
+			results.size() * sizeof(VulkanWorkgroupTuningResult));
+		if (!file.good())
+		{
+			file.close();
+			std::remove(temporaryFilepath.c_str());
+			return false;
+		}
+	}
+
+	//Renaming over an existing file fails on some platforms, so the old one is removed first
+	std::remove(filepath.c_str());
+	return std::rename(temporaryFilepath.c_str(), filepath.c_str()) == 0;
+}
+
+uint64_t VulkanWorkgroupTuner::CalculateKernelKey(const char* kernelName, const uint32_t* pCode, size_t codeSize)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char* pCharacter = kernelName; *pCharacter; ++pCharacter)
+	{
+		hash ^= static_cast<uint8_t>(*pCharacter);
+		hash *= 1099511628211ull;
+	}
+	const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pCode);
+	for (size_t i = 0; i < codeSize; ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool VulkanWorkgroupTuner::FindWorkgroupSize(uint64_t kernelKey, VulkanWorkgroupSize& workgroupSize) const
+{
+	for (const VulkanWorkgroupTuningResult& result : results)
+	{
+		if (result.kernelKey == kernelKey)
+		{
+			workgroupSize = result.workgroupSize;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VulkanWorkgroupTuner::IsSupported(const VulkanWorkgroupSize& workgroupSize) const
+{
+	const VkPhysicalDeviceLimits& limits = deviceProperties.limits;
+	return workgroupSize.x && workgroupSize.y && workgroupSize.z &&
+		workgroupSize.x <= limits.maxComputeWorkGroupSize[0] &&
+		workgroupSize.y <= limits.maxComputeWorkGroupSize[1] &&
+		workgroupSize.z <= limits.maxComputeWorkGroupSize[2] &&
+		static_cast<uint64_t>(workgroupSize.x) * workgroupSize.y * workgroupSize.z <=
+		limits.maxComputeWorkGroupInvocations;
+}
+
+bool VulkanWorkgroupTuner::Tune(uint64_t kernelKey, const VulkanWorkgroupTuningKernel& kernel,
+	VulkanWorkgroupTuningResult& result)
+{
+	BLITZEN_CPU_PROFILER_ZONE(kernel.name);
+
+	if (!CanTune())
+	{
+		return false;
+	}
+
+	double bestTime = -1.0;
+	for (const VulkanWorkgroupSize& candidate : kernel.candidates)
+	{
+		if (!IsSupported(candidate))
+		{
+			continue;
+		}
+
+		double candidateTime = TimeCandidate(kernel, candidate);
+		if (candidateTime >= 0.0 && (bestTime < 0.0 || candidateTime < bestTime))
+		{
+			bestTime = candidateTime;
+			result.workgroupSize = candidate;
+		}
+	}
+	if (bestTime < 0.0)
+	{
+		return false;
+	}
+
+	result.kernelKey = kernelKey;
+	result.dispatchTime = static_cast<float>(bestTime);
+	for (VulkanWorkgroupTuningResult& oldResult : results)
+	{
+		if (oldResult.kernelKey == kernelKey)
+		{
+			oldResult = result;
+			return true;
+		}
+	}
+	results.push_back(result);
+	return true;
+}
+
+double VulkanWorkgroupTuner::TimeCandidate(const VulkanWorkgroupTuningKernel& kernel,
+	const VulkanWorkgroupSize& workgroupSize)
+{
+	VkPipeline pipeline{ VK_NULL_HANDLE };
+	if (!kernel.createPipeline(workgroupSize, pipeline))
+	{
+		vkDestroyPipeline(device, pipeline, nullptr);
+		return -1.0;
+	}
+
+	//Every dispatch writes what the one before it wrote, so they are kept from overlapping
+	VkMemoryBarrier2 memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	memoryBarrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+	memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+	VkDependencyInfo barrierDependency{};
+	barrierDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	barrierDependency.memoryBarrierCount = 1;
+	barrierDependency.pMemoryBarriers = &memoryBarrier;
+
+	double bestTime = -1.0;
+	for (uint32_t submission = 0; submission < BLITZEN_VULKAN_WORKGROUP_TUNING_SUBMISSIONS; ++submission)
+	{
+		vkResetCommandBuffer(commandBuffer, 0);
+		VkCommandBufferBeginInfo commandBufferBeginInfo{};
+		VulkanSDKobjects::CommandBufferBeginInfoInit(commandBufferBeginInfo,
+			VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0, 2);
+		if (kernel.recordSetup)
+		{
+			kernel.recordSetup(commandBuffer);
+		}
+
+		//The first dispatch is not timed, it brings the kernel's data into the caches
+		kernel.recordDispatch(commandBuffer, pipeline, workgroupSize);
+		vkCmdPipelineBarrier2(commandBuffer, &barrierDependency);
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, timestampQueryPool, 0);
+		for (uint32_t i = 0; i < BLITZEN_VULKAN_WORKGROUP_TUNING_DISPATCHES; ++i)
+		{
+			kernel.recordDispatch(commandBuffer, pipeline, workgroupSize);
+			vkCmdPipelineBarrier2(commandBuffer, &barrierDependency);
+		}
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, timestampQueryPool, 1);
+
+		vkEndCommandBuffer(commandBuffer);
+
+		VkCommandBufferSubmitInfo commandBufferSubmit{};
+		VulkanSDKobjects::CommandBufferSubmitInfoInit(commandBufferSubmit, commandBuffer);
+		VkSubmitInfo2 submitInfo{};
+		VulkanSDKobjects::SubmitInfo2Init(submitInfo, nullptr, nullptr, &commandBufferSubmit, 0, 0);
+		vkResetFences(device, 1, &fence);
+		if (vkQueueSubmit2(queue, 1, &submitInfo, fence) != VK_SUCCESS ||
+			vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		std::array<uint64_t, 2> timestamps{};
+		if (vkGetQueryPoolResults(device, timestampQueryPool, 0, 2, sizeof(timestamps), timestamps.data(),
+			sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+		{
+			continue;
+		}
+
+		double dispatchTime = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod /
+			1000000.0 / BLITZEN_VULKAN_WORKGROUP_TUNING_DISPATCHES;
+		if (bestTime < 0.0 || dispatchTime < bestTime)
+		{
+			bestTime = dispatchTime;
+		}
+	}
+
+	//The fence was waited for, so nothing uses the pipeline anymore
+	vkDestroyPipeline(device, pipeline, nullptr);
+	return bestTime;
+}
+
+void VulkanWorkgroupTuner::ReadResultsFile()
+{
+	std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(VulkanWorkgroupTuningFileHeader))
+	{
+		return;
+	}
+	file.seekg(0);
+
+	//Sizes that were fastest on another device or driver say nothing about this one
+	VulkanWorkgroupTuningFileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (header.magic != BLITZEN_VULKAN_WORKGROUP_TUNING_FILE_MAGIC ||
+		header.fileVersion != BLITZEN_VULKAN_WORKGROUP_TUNING_FILE_VERSION ||
+		header.vendorID != deviceProperties.vendorID ||
+		header.deviceID != deviceProperties.deviceID ||
+		header.driverVersion != deviceProperties.driverVersion ||
+		fileSize - sizeof(header) != static_cast<size_t>(header.resultCount) * sizeof(VulkanWorkgroupTuningResult))
+	{
+		return;
+	}
+
+	results.resize(header.resultCount);
+	file.read(reinterpret_cast<char*>(results.data()), results.size() * sizeof(VulkanWorkgroupTuningResult));
+	if (!file.good())
+	{
+		results.clear();
+		return;
+	}
+
+	//A size that the device does not allow would fail to create its pipeline
+	for (size_t i = 0; i < results.size();)
+	{
+		if (!IsSupported(results[i].workgroupSize))
+		{
+			results.erase(results.begin() + i);
+			continue;
+		}
+		++i;
+	}
+}
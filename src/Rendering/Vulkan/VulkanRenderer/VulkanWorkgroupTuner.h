@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <functional>
+
+//The workgroup tuner is a standalone class, it only needs the Vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+
+
+
+//Where the renderer keeps the tuned workgroup sizes between runs, unless its settings give another file
+#define BLITZEN_VULKAN_WORKGROUP_TUNING_DEFAULT_FILEPATH	"BlitzenWorkgroupSizes.bin"
+
+//Written at the start of the file, so that files of other programs and formats are never loaded
+#define BLITZEN_VULKAN_WORKGROUP_TUNING_FILE_MAGIC			0x47575A42u
+//Needs to change whenever the layout of the header or of VulkanWorkgroupTuningResult changes
+#define BLITZEN_VULKAN_WORKGROUP_TUNING_FILE_VERSION		1u
+
+/*
+The specialization constant ids of the workgroup size, every compute shader that can be tuned declares
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) in;
+*/
+#define BLITZEN_VULKAN_WORKGROUP_SIZE_X_CONSTANT_ID			0u
+#define BLITZEN_VULKAN_WORKGROUP_SIZE_Y_CONSTANT_ID			1u
+#define BLITZEN_VULKAN_WORKGROUP_SIZE_Z_CONSTANT_ID			2u
+
+//Each candidate is timed over this many submissions and the fastest one counts, which filters out stalls
+#define BLITZEN_VULKAN_WORKGROUP_TUNING_SUBMISSIONS			3
+//How many dispatches each submission times, after one that is not timed to warm up the caches
+#define BLITZEN_VULKAN_WORKGROUP_TUNING_DISPATCHES			8
+
+
+
+
+struct VulkanWorkgroupSize
+{
+	uint32_t x = 1;
+	uint32_t y = 1;
+	uint32_t z = 1;
+
+	inline bool operator==(const VulkanWorkgroupSize& other) const
+	{ return x == other.x && y == other.y && z == other.z; }
+	inline bool operator!=(const VulkanWorkgroupSize& other) const { return !(*this == other); }
+};
+
+//How many workgroups of the size cover the extent on one dimension
+inline uint32_t GetWorkgroupCount(uint32_t extent, uint32_t workgroupSize)
+{
+	return (extent + workgroupSize - 1) / workgroupSize;
+}
+
+/*
+Gives the workgroup size to a compute shader stage as specialization constants. The specialization
+info points into the struct itself, so it has to stay where it is until the pipeline is created
+*/
+struct VulkanWorkgroupSpecialization
+{
+	std::array<VkSpecializationMapEntry, 3> mapEntries{};
+	VulkanWorkgroupSize workgroupSize;
+	VkSpecializationInfo info{};
+
+	void Init(const VulkanWorkgroupSize& size);
+};
+
+
+//The fastest workgroup size of one kernel on the device that the file was written for
+struct VulkanWorkgroupTuningResult
+{
+	//Changes with the name and the code of the kernel, so a kernel that was changed is tuned again
+	uint64_t kernelKey = 0;
+	VulkanWorkgroupSize workgroupSize;
+	//Milliseconds for one dispatch with that size
+	float dispatchTime = 0.f;
+	uint32_t padding = 0;
+};
+
+struct VulkanWorkgroupTuningFileHeader
+{
+	uint32_t magic;
+	uint32_t fileVersion;
+
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+
+	uint32_t resultCount;
+};
+
+
+/*
+Everything the tuner needs to know about a kernel. The callbacks are called on the thread that calls
+Tune, between recording commands into the tuner's own command buffer
+*/
+struct VulkanWorkgroupTuningKernel
+{
+	const char* name = "";
+
+	//Sizes that the device does not support are skipped
+	std::vector<VulkanWorkgroupSize> candidates;
+
+	//Creates the pipeline of the kernel with the size in its specialization constants
+	std::function<bool(const VulkanWorkgroupSize& workgroupSize, VkPipeline& pipeline)> createPipeline;
+
+	//Records what the kernel needs before it can run, once for each submission. Can be empty
+	std::function<void(const VkCommandBuffer& commandBuffer)> recordSetup;
+
+	//Records one dispatch of a workload like the one the kernel has every frame, with the pipeline bound by it
+	std::function<void(const VkCommandBuffer& commandBuffer, const VkPipeline& pipeline,
+		const VulkanWorkgroupSize& workgroupSize)> recordDispatch;
+};
+
+
+/*-----------------------------------------------------------------------------------
+Finds the fastest workgroup size of compute kernels on the device. Each candidate gets
+a pipeline of its own, and its dispatches are timed with timestamp queries in a command
+buffer that the tuner submits and waits for itself, so the kernel's resources must not
+be in use by the frames in flight while it runs. The winners are kept in a file for the
+device and driver, next runs only tune kernels that were not tuned before or that
+changed. Tuning needs timestamps on the queue, without them every kernel keeps its default
+-------------------------------------------------------------------------------------*/
+class VulkanWorkgroupTuner
+{
+public:
+
+	/*
+	Reads the results of earlier runs from the file, if it was written for this device and driver.
+	A null filepath keeps the results in memory only
+	*/
+	void Init(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const VkQueue& queue,
+		uint32_t queueFamilyIndex, float timestampPeriod, bool bTimestampsSupported, const char* filepath);
+
+	//Uses a manual cleanup function instead of the destructor since it needs the device
+	void Cleanup();
+
+	//Writes every result to the file, through a temporary file like the pipeline cache
+	bool Save();
+
+	inline bool CanTune() const { return timestampQueryPool != VK_NULL_HANDLE; }
+
+	//FNV-1a of the kernel's name and its SPIR-V
+	static uint64_t CalculateKernelKey(const char* kernelName, const uint32_t* pCode, size_t codeSize);
+
+	//Returns false if the kernel was never tuned on this device
+	bool FindWorkgroupSize(uint64_t kernelKey, VulkanWorkgroupSize& workgroupSize) const;
+
+	//False if the size is larger than the device allows for one workgroup
+	bool IsSupported(const VulkanWorkgroupSize& workgroupSize) const;
+
+	/*
+	Times every candidate of the kernel and keeps the fastest as the result of the key. Blocks until the
+	gpu is done. Returns false if no candidate could be timed
+	*/
+	bool Tune(uint64_t kernelKey, const VulkanWorkgroupTuningKernel& kernel, VulkanWorkgroupTuningResult& result);
+
+private:
+
+	//Returns a negative time if the candidate could not be timed
+	double TimeCandidate(const VulkanWorkgroupTuningKernel& kernel, const VulkanWorkgroupSize& workgroupSize);
+
+	void ReadResultsFile();
+
+private:
+
+	VkDevice device{ VK_NULL_HANDLE };
+	VkQueue queue{ VK_NULL_HANDLE };
+
+	VkPhysicalDeviceProperties deviceProperties{};
+	float timestampPeriod = 1.f;
+
+	VkCommandPool commandPool{ VK_NULL_HANDLE };
+	VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+	VkFence fence{ VK_NULL_HANDLE };
+	VkQueryPool timestampQueryPool{ VK_NULL_HANDLE };
+
+	//Empty if the results are not kept between runs
+	std::string filepath;
+
+	std::vector<VulkanWorkgroupTuningResult> results;
+};
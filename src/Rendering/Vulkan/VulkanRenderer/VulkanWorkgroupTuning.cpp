@@ -0,0 +1,191 @@
+#include "VulkanRenderer.h"
+
+//Sizes of a 2D kernel that are timed, the ones larger than the device allows are skipped
+static const std::array<VulkanWorkgroupSize, 10> imageKernelCandidates =
+{{
+	{ 8, 8, 1 }, { 16, 8, 1 }, { 8, 16, 1 }, { 16, 16, 1 }, { 32, 4, 1 },
+	{ 32, 8, 1 }, { 64, 4, 1 }, { 32, 16, 1 }, { 64, 8, 1 }, { 32, 32, 1 }
+}};
+
+//A kernel that is tuned, and the pipeline that the renderer draws with
+struct VulkanTunedPipeline
+{
+	const char* shaderName;
+	VulkanWorkgroupTuningKernel kernel;
+
+	//Replaced together when the kernel is tuned to another size
+	VkPipeline* pPipeline;
+	VulkanWorkgroupSize* pWorkgroupSize;
+};
+
+VulkanWorkgroupSize VulkanRenderer::FindTunedWorkgroupSize(const char* shaderName, 
+	const VulkanWorkgroupSize& defaultSize)
+{
+	const uint32_t* pCode = nullptr;
+	size_t codeSize = 0;
+	if (!shaderLibrary.FindShader(shaderName, pCode, codeSize))
+	{
+		return defaultSize;
+	}
+
+	//The tuner is only read while the pipeline jobs run, so they can all look into it
+	VulkanWorkgroupSize workgroupSize;
+	if (!workgroupTuner.FindWorkgroupSize(VulkanWorkgroupTuner::CalculateKernelKey(shaderName, pCode, codeSize),
+		workgroupSize))
+	{
+		return defaultSize;
+	}
+	return workgroupSize;
+}
+
+void VulkanRenderer::TuneWorkgroupSizes(bool bRetune)
+{
+	BLITZEN_CPU_PROFILER_ZONE("TuneWorkgroupSizes");
+	auto tuningStart = std::chrono::high_resolution_clock::now();
+
+	std::array<VulkanTunedPipeline, 2> tunedPipelines;
+
+	//Fills the drawing image, the same amount of work as every frame
+	VulkanTunedPipeline& gradient = tunedPipelines[0];
+	gradient.shaderName = BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER;
+	gradient.kernel.name = "Gradient";
+	gradient.kernel.candidates.assign(imageKernelCandidates.begin(), imageKernelCandidates.end());
+	gradient.kernel.createPipeline = [this](const VulkanWorkgroupSize& workgroupSize, VkPipeline& pipeline)
+	{
+		return CreateComputePipeline(BLITZEN_VULKAN_GRADIENT_COMPUTE_SHADER, gradientComputePipeline.pipelineLayout,
+			workgroupSize, pipeline);
+	};
+	gradient.kernel.recordSetup = [this](const VkCommandBuffer& commandBuffer)
+	{
+		TransitionImageLayoutWhileDrawing(commandBuffer, drawingImage.image,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+	};
+	gradient.kernel.recordDispatch = [this](const VkCommandBuffer& commandBuffer, const VkPipeline& pipeline,
+		const VulkanWorkgroupSize& workgroupSize)
+	{
+		DrawBackground(commandBuffer, pipeline, workgroupSize);
+	};
+	gradient.pPipeline = &gradientComputePipeline.computePipeline;
+	gradient.pWorkgroupSize = &gradientComputePipeline.workgroupSize;
+
+	//A dispatch is a whole build of the pyramid, so the small levels count as much as they do in a frame
+	VulkanTunedPipeline& pyramid = tunedPipelines[1];
+	pyramid.shaderName = BLITZEN_VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER;
+	pyramid.kernel.name = "DepthPyramid";
+	pyramid.kernel.candidates.assign(imageKernelCandidates.begin(), imageKernelCandidates.end());
+	pyramid.kernel.createPipeline = [this](const VulkanWorkgroupSize& workgroupSize, VkPipeline& pipeline)
+	{
+		return depthPyramid.CreateBuildPipeline(device, shaderLibrary, BLITZEN_VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER,
+			pipelineCache.GetCache(), workgroupSize, pipeline);
+	};
+	pyramid.kernel.recordSetup = [this](const VkCommandBuffer& commandBuffer)
+	{
+		//The contents of the depth image do not change the cost, so it is only put in the layout that the build samples
+		TransitionImageLayoutWhileDrawing(commandBuffer, depthImage.image,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+		TransitionImageLayoutWhileDrawing(commandBuffer, depthImage.image,
+			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		//The frames transition the pyramid through its state, the build expects it in the general layout
+		VkImage pyramidImage = depthPyramid.GetImage();
+		TransitionImageLayoutWhileDrawing(commandBuffer, pyramidImage,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+	};
+	pyramid.kernel.recordDispatch = [this](const VkCommandBuffer& commandBuffer, const VkPipeline& pipeline,
+		const VulkanWorkgroupSize& workgroupSize)
+	{
+		depthPyramid.Build(commandBuffer, pipeline, workgroupSize);
+	};
+	pyramid.pPipeline = &depthPyramid.GetPipeline();
+	pyramid.pWorkgroupSize = &depthPyramid.GetWorkgroupSize();
+
+	bool bTunedAny = false;
+	startupStats.workgroupTuning.clear();
+	for (VulkanTunedPipeline& tunedPipeline : tunedPipelines)
+	{
+		VulkanWorkgroupTuningStats stats;
+		stats.kernelName = tunedPipeline.kernel.name;
+		stats.workgroupSize = *tunedPipeline.pWorkgroupSize;
+
+		const uint32_t* pCode = nullptr;
+		size_t codeSize = 0;
+		if (!shaderLibrary.FindShader(tunedPipeline.shaderName, pCode, codeSize))
+		{
+			startupStats.workgroupTuning.push_back(stats);
+			continue;
+		}
+		uint64_t kernelKey = VulkanWorkgroupTuner::CalculateKernelKey(tunedPipeline.shaderName, pCode, codeSize);
+
+		//The pipeline jobs already created the pipelines of the kernels that have a result
+		VulkanWorkgroupSize foundSize;
+		VulkanWorkgroupTuningResult result;
+		if ((!bRetune && workgroupTuner.FindWorkgroupSize(kernelKey, foundSize)) ||
+			!workgroupTuner.Tune(kernelKey, tunedPipeline.kernel, result))
+		{
+			startupStats.workgroupTuning.push_back(stats);
+			continue;
+		}
+
+		bTunedAny = true;
+		stats.bTuned = true;
+		stats.dispatchTime = result.dispatchTime;
+
+		//Nothing is in flight, so the old pipeline can be destroyed right away
+		VkPipeline newPipeline{ VK_NULL_HANDLE };
+		if (result.workgroupSize != *tunedPipeline.pWorkgroupSize &&
+			tunedPipeline.kernel.createPipeline(result.workgroupSize, newPipeline))
+		{
+			vkDestroyPipeline(device, *tunedPipeline.pPipeline, nullptr);
+			*tunedPipeline.pPipeline = newPipeline;
+			*tunedPipeline.pWorkgroupSize = result.workgroupSize;
+		}
+		stats.workgroupSize = *tunedPipeline.pWorkgroupSize;
+		startupStats.workgroupTuning.push_back(stats);
+	}
+
+	if (bTunedAny)
+	{
+		workgroupTuner.Save();
+	}
+
+	auto tuningEnd = std::chrono::high_resolution_clock::now();
+	startupStats.workgroupTuningTime = bTunedAny ? 
+		std::chrono::duration<double, std::milli>(tuningEnd - tuningStart).count() : 0.0;
+}
+
+bool VulkanRenderer::RetuneWorkgroupSizes()
+{
+	if (!WaitForPipelines() || !workgroupTuner.CanTune())
+	{
+		return false;
+	}
+
+	BLITZEN_CPU_PROFILER_ZONE("RetuneWorkgroupSizes");
+
+	//The reload job is the only user of the shader library while it runs, so its pipelines are taken first
+	if (bShaderReloadRunning)
+	{
+		BlitzenEngine::JobSystem::Wait(shaderReloadCounter);
+		bShaderReloadRunning = false;
+		ApplyShaderReload();
+	}
+
+	//The tuner uses the drawing image, the depth image and the pyramid that the frames in flight draw with
+	vkDeviceWaitIdle(device);
+	DestroyRetiredPipelines(true);
+
+	//Startup closes the shader library unless hot reload keeps it open
+	bool bLibraryOpen = shaderWatcher.IsWatching();
+	if (!bLibraryOpen && !OpenShaderLibrary())
+	{
+		return false;
+	}
+
+	TuneWorkgroupSizes(true);
+
+	if (!bLibraryOpen)
+	{
+		shaderLibrary.Cleanup();
+	}
+	return true;
+}
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+#include "Rendering/Vulkan/VulkanRenderer/VulkanShaderLibraryFormat.h"
+
+
+
+
+/*----------------------------------------------------------------------
+Packs compiled SPIR-V files into the shader library that the renderer
+maps at startup. The build runs it after the shaders are compiled.
+Usage:
+ShaderPacker <output filepath> <.spv filepath>...
+Each shader is named after its file, without the directory and the .spv
+-----------------------------------------------------------------------*/
+
+struct PackedShader
+{
+	std::string name;
+	uint64_t nameHash = 0;
+	std::vector<char> code;
+};
+
+//The name of the file without its directory and without the .spv extension
+std::string ShaderNameFromFilepath(const std::string& filepath)
+{
+	size_t nameStart = filepath.find_last_of("/\\");
+	std::string name = nameStart == std::string::npos ? filepath : filepath.substr(nameStart + 1);
+
+	const std::string extension = ".spv";
+	if (name.size() > extension.size() &&
+		!name.compare(name.size() - extension.size(), extension.size(), extension))
+	{
+		name.resize(name.size() - extension.size());
+	}
+	return name;
+}
+
+bool ReadShader(const char* filepath, PackedShader& shader)
+{
+	std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to open " << filepath << '\n';
+		return false;
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	shader.code.resize(fileSize);
+	file.seekg(0);
+	file.read(shader.code.data(), fileSize);
+
+	uint32_t magic = 0;
+	if (!file.good() || fileSize < sizeof(magic) || fileSize % sizeof(uint32_t))
+	{
+		std::cout << filepath << " is not a SPIR-V module\n";
+		return false;
+	}
+	std::copy(shader.code.data(), shader.code.data() + sizeof(magic), reinterpret_cast<char*>(&magic));
+	if (magic != BLITZEN_SPIRV_MAGIC)
+	{
+		std::cout << filepath << " is not a SPIR-V module\n";
+		return false;
+	}
+
+	shader.name = ShaderNameFromFilepath(filepath);
+	shader.nameHash = HashShaderName(shader.name.data(), shader.name.size());
+	return true;
+}
+
+uint64_t AlignOffset(uint64_t offset, uint64_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: ShaderPacker <output filepath> <.spv filepath>...\n";
+		return 1;
+	}
+
+	std::vector<PackedShader> shaders(argc - 2);
+	for (int i = 2; i < argc; ++i)
+	{
+		if (!ReadShader(argv[i], shaders[i - 2]))
+		{
+			return 1;
+		}
+	}
+
+	std::sort(shaders.begin(), shaders.end(), [](const PackedShader& a, const PackedShader& b)
+		{ return a.nameHash < b.nameHash; });
+	for (size_t i = 1; i < shaders.size(); ++i)
+	{
+		//Two shaders with the same name could never both be found
+		if (shaders[i].name == shaders[i - 1].name)
+		{
+			std::cout << "More than one shader is named " << shaders[i].name << '\n';
+			return 1;
+		}
+	}
+
+	//The table is followed by the names, and then by the code of each shader
+	std::vector<ShaderLibraryEntry> entries(shaders.size());
+	uint64_t offset = sizeof(ShaderLibraryHeader) + entries.size() * sizeof(ShaderLibraryEntry);
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		entries[i].nameHash = shaders[i].nameHash;
+		entries[i].nameOffset = static_cast<uint32_t>(offset);
+		entries[i].nameLength = static_cast<uint32_t>(shaders[i].name.size());
+		offset += shaders[i].name.size();
+	}
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		offset = AlignOffset(offset, BLITZEN_SHADER_LIBRARY_CODE_ALIGNMENT);
+		entries[i].codeOffset = offset;
+		entries[i].codeSize = shaders[i].code.size();
+		offset += shaders[i].code.size();
+	}
+
+	ShaderLibraryHeader header{};
+	header.magic = BLITZEN_SHADER_LIBRARY_MAGIC;
+	header.version = BLITZEN_SHADER_LIBRARY_VERSION;
+	header.shaderCount = static_cast<uint32_t>(shaders.size());
+	header.fileSize = offset;
+
+	std::vector<char> library(static_cast<size_t>(header.fileSize), 0);
+	std::copy(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1),
+		library.begin());
+	std::copy(reinterpret_cast<const char*>(entries.data()),
+		reinterpret_cast<const char*>(entries.data() + entries.size()),
+		library.begin() + sizeof(ShaderLibraryHeader));
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		std::copy(shaders[i].name.begin(), shaders[i].name.end(), library.begin() + entries[i].nameOffset);
+		std::copy(shaders[i].code.begin(), shaders[i].code.end(), library.begin() + entries[i].codeOffset);
+	}
+
+	//Written next to the output first, so that a failed write never leaves a broken library behind
+	std::string outputFilepath = argv[1];
+	std::string temporaryFilepath = outputFilepath + ".tmp";
+	{
+		std::ofstream file(temporaryFilepath, std::ios::binary | std::ios::trunc);
+		file.write(library.data(), library.size());
+		if (!file.good())
+		{
+			std::cout << "Failed to write " << temporaryFilepath << '\n';
+			file.close();
+			std::remove(temporaryFilepath.c_str());
+			return 1;
+		}
+	}
+	std::remove(outputFilepath.c_str());
+	if (std::rename(temporaryFilepath.c_str(), outputFilepath.c_str()) != 0)
+	{
+		std::cout << "Failed to write " << outputFilepath << '\n';
+		return 1;
+	}
+
+	std::cout << "Packed " << shaders.size() << " shaders into " << outputFilepath << " (" << header.fileSize
+		<< " bytes)\n";
+	return 0;
+}